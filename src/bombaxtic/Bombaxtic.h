@@ -3,13 +3,20 @@
 #import <Bombaxtic/BxClientLibAuthorizer.h>
 #import <Bombaxtic/BxClientLibHandler.h>
 #import <Bombaxtic/BxDatabaseConnection.h>
+#import <Bombaxtic/BxDatabasePool.h>
+#import <Bombaxtic/BxDatabaseQuery.h>
+#import <Bombaxtic/BxDatabaseRow.h>
 #import <Bombaxtic/BxDatabaseStatement.h>
 #import <Bombaxtic/BxFile.h>
 #import <Bombaxtic/BxHandler.h>
 #import <Bombaxtic/BxMailer.h>
 #import <Bombaxtic/BxMailerAttachment.h>
 #import <Bombaxtic/BxMessage.h>
+#import <Bombaxtic/BxMessageBus.h>
+#import <Bombaxtic/BxSQLiteSessionStore.h>
 #import <Bombaxtic/BxSession.h>
+#import <Bombaxtic/BxSessionCookieSigner.h>
+#import <Bombaxtic/BxSessionStore.h>
 #import <Bombaxtic/BxStaticFileHandler.h>
 #import <Bombaxtic/BxTransport.h>
 #import <Bombaxtic/BxUtil.h>
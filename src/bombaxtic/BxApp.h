@@ -346,7 +346,8 @@
  \c "BxApp Static Resource Path".  By default this folder is named "static".
   
  \note In debugging mode \ref BxStaticFileHandler is implicitly used to handle request coming
- into the \c "BxApp Static Web Path".
+ into the \c "BxApp Static Web Path".  When deployed through Bombax, requests for the
+ \c "BxApp Static Web Path" are served directly by the web server and never reach the BxApp.
  
  \code
  - (id)renderWithTransport:(BxTransport *)transport {
@@ -195,7 +195,7 @@ extern BOOL _BX_isDebugging;
         NSDictionary *info = [[NSBundle mainBundle] infoDictionary];
         _BX_staticWebPath  = [info objectForKey:@"BxApp Static Web Path"];
         if (_BX_staticWebPath == nil) {
-            _BX_staticWebPath = @"";
+            _BX_staticWebPath = @"static";
         }
         NSUserDefaults *defaults = [NSUserDefaults standardUserDefaults];
         NSString *urlRoot = [defaults stringForKey:@"root"];
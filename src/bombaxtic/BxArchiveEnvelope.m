@@ -1,4 +1,6 @@
 #import "BxArchiveEnvelope.h"
+#import "BxMessage.h"
+#import "BxWireFormat.h"
 
 
 @implementation BxArchiveEnvelope
@@ -33,6 +35,48 @@
                    forKey:@"messages"];
 }
 
+- (NSData *)_wireData {
+    NSMutableData *data = [NSMutableData dataWithCapacity:[_contents length] + [_messages count] * 64 + 16];
+    _BX_wireAppendHeader(data, BX_WIRE_TYPE_ENVELOPE);
+    _BX_wireAppendData(data, _contents);
+    if (_messages == nil) {
+        _BX_wireAppendUInt32(data, BX_WIRE_NIL);
+    } else {
+        _BX_wireAppendUInt32(data, [_messages count]);
+        for (BxMessage *message in _messages) {
+            [message _appendWireFormat:data];
+        }
+    }
+    return data;
+}
+
++ (BxArchiveEnvelope *)_envelopeWithWireData:(NSData *)data {
+    if (! _BX_wireHasHeader(data, BX_WIRE_TYPE_ENVELOPE)) {
+        return nil;
+    }
+    NSUInteger offset = BX_WIRE_HEADER_LENGTH;
+    NSData *contents;
+    uint32_t messageCount;
+    NSMutableArray *messages = nil;
+    if (! _BX_wireReadData(data, &offset, &contents) ||
+        ! _BX_wireReadUInt32(data, &offset, &messageCount)) {
+        return nil;
+    }
+    if (messageCount != BX_WIRE_NIL) {
+        messages = [NSMutableArray arrayWithCapacity:MIN(messageCount, 64)];
+        for (uint32_t i = 0; i < messageCount; i++) {
+            BxMessage *message = [BxMessage _messageWithWireData:data
+                                                          offset:&offset];
+            if (message == nil) {
+                return nil;
+            }
+            [messages addObject:message];
+        }
+    }
+    return [[[BxArchiveEnvelope alloc] initWithContents:contents
+                                               messages:messages] autorelease];
+}
+
 - (void)dealloc {
     if (_contents) {
         [_contents release];
@@ -0,0 +1,47 @@
+/**
+ \brief Append-only ring buffer of broadcast messages read through per-session cursors
+ \class BxBroadcastLog
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ Every broadcast message is stored once with an increasing sequence number.  A session
+ only remembers the sequence number of the next message it has not received, so a
+ broadcast costs the same regardless of how many sessions exist.  Messages are dropped
+ once the buffer holds \c capacity newer messages or they are older than \c maxAge;
+ a reader whose cursor points before the oldest retained message has overflowed.
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+
+@class BxMessage;
+
+@interface BxBroadcastLog : NSObject {
+    NSLock *_lock;
+    id *_messages;
+    NSTimeInterval *_appendedDates;
+    NSUInteger _capacity;
+    NSTimeInterval _maxAge;
+    unsigned long long _firstSequence; // oldest retained
+    unsigned long long _nextSequence;
+}
+
+- (id)initWithCapacity:(NSUInteger)capacity
+                maxAge:(NSTimeInterval)maxAge;
+
+- (unsigned long long)appendMessage:(BxMessage *)message;
+
+// keeps the newest messages that still fit and the sequence numbers, so cursors stay valid
+- (id)setCapacity:(NSUInteger)capacity
+           maxAge:(NSTimeInterval)maxAge;
+
+- (BOOL)hasMessagesFromCursor:(unsigned long long)cursor;
+
+// advances cursor past the returned messages; nil if there are none
+- (NSArray *)messagesFromCursor:(unsigned long long *)cursor
+                     overflowed:(BOOL *)overflowed;
+
+// the cursor of a reader that has seen everything so far
+@property (readonly) unsigned long long nextSequence;
+
+@end
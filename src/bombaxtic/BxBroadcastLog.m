@@ -0,0 +1,121 @@
+#import "BxBroadcastLog.h"
+
+@implementation BxBroadcastLog
+
+- (id)initWithCapacity:(NSUInteger)capacity
+                maxAge:(NSTimeInterval)maxAge {
+    [super init];
+    _lock = [[NSLock alloc] init];
+    _capacity = MAX(capacity, 1);
+    _messages = calloc(_capacity, sizeof(id));
+    _appendedDates = calloc(_capacity, sizeof(NSTimeInterval));
+    _maxAge = maxAge;
+    _firstSequence = 0;
+    _nextSequence = 0;
+    return self;
+}
+
+// must be called with _lock held
+- (void)_dropExpired:(NSTimeInterval)now {
+    if (_maxAge <= 0) {
+        return;
+    }
+    while (_firstSequence < _nextSequence &&
+           _appendedDates[_firstSequence % _capacity] + _maxAge < now) {
+        NSUInteger slot = _firstSequence % _capacity;
+        [_messages[slot] release];
+        _messages[slot] = nil;
+        _firstSequence++;
+    }
+}
+
+- (unsigned long long)appendMessage:(BxMessage *)message {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    [_lock lock];
+    [self _dropExpired:now];
+    NSUInteger slot = _nextSequence % _capacity;
+    if (_nextSequence - _firstSequence == _capacity) {
+        _firstSequence++;
+    }
+    [_messages[slot] release];
+    _messages[slot] = [message retain];
+    _appendedDates[slot] = now;
+    unsigned long long sequence = _nextSequence++;
+    [_lock unlock];
+    return sequence;
+}
+
+- (id)setCapacity:(NSUInteger)capacity
+           maxAge:(NSTimeInterval)maxAge {
+    capacity = MAX(capacity, 1);
+    id *messages = calloc(capacity, sizeof(id));
+    NSTimeInterval *appendedDates = calloc(capacity, sizeof(NSTimeInterval));
+    [_lock lock];
+    // the oldest messages that no longer fit are dropped, as if the buffer had wrapped
+    while (_nextSequence - _firstSequence > capacity) {
+        NSUInteger slot = _firstSequence % _capacity;
+        [_messages[slot] release];
+        _messages[slot] = nil;
+        _firstSequence++;
+    }
+    for (unsigned long long i = _firstSequence; i < _nextSequence; i++) {
+        messages[i % capacity] = _messages[i % _capacity];
+        appendedDates[i % capacity] = _appendedDates[i % _capacity];
+    }
+    free(_messages);
+    free(_appendedDates);
+    _messages = messages;
+    _appendedDates = appendedDates;
+    _capacity = capacity;
+    _maxAge = maxAge;
+    [self _dropExpired:[NSDate timeIntervalSinceReferenceDate]];
+    [_lock unlock];
+    return self;
+}
+
+- (BOOL)hasMessagesFromCursor:(unsigned long long)cursor {
+    [_lock lock];
+    BOOL hasMessages = cursor < _nextSequence;
+    [_lock unlock];
+    return hasMessages;
+}
+
+- (NSArray *)messagesFromCursor:(unsigned long long *)cursor
+                     overflowed:(BOOL *)overflowed {
+    NSMutableArray *messages = nil;
+    *overflowed = NO;
+    [_lock lock];
+    [self _dropExpired:[NSDate timeIntervalSinceReferenceDate]];
+    if (*cursor < _firstSequence) {
+        *overflowed = YES;
+        *cursor = _firstSequence;
+    }
+    if (*cursor < _nextSequence) {
+        messages = [NSMutableArray arrayWithCapacity:_nextSequence - *cursor];
+        for (unsigned long long i = *cursor; i < _nextSequence; i++) {
+            [messages addObject:_messages[i % _capacity]];
+        }
+        *cursor = _nextSequence;
+    }
+    [_lock unlock];
+    return messages;
+}
+
+- (unsigned long long)nextSequence {
+    [_lock lock];
+    unsigned long long nextSequence = _nextSequence;
+    [_lock unlock];
+    return nextSequence;
+}
+
+- (void)dealloc {
+    for (NSUInteger i = 0; i < _capacity; i++) {
+        [_messages[i] release];
+    }
+    free(_messages);
+    free(_appendedDates);
+    [_lock release];
+    [super dealloc];
+}
+
+@end
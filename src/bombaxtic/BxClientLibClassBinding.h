@@ -9,17 +9,27 @@
 #import <Cocoa/Cocoa.h>
 #import <Bombaxtic/BxClientLibAuthorizer.h>
 
+@class BxClientLibMethod;
+
 @interface BxClientLibClassBinding : NSObject {
     Class _cls;
     id <BxClientLibAuthorizer> _authorizer;
     id _instance;
+    NSDictionary *_methods; // selector name -> BxClientLibMethod, fixed once bound
+    NSDictionary *_signatures; // selector name -> type encoding
 }
 
 + (BxClientLibClassBinding *)classBindingWithClass:(Class)cls
                                           instance:(id)instance
                                         authorizer:(id <BxClientLibAuthorizer>)authorizer;
     
+// nil for selectors the bound class does not expose
+- (BxClientLibMethod *)methodForSelectorName:(NSString *)selectorName;
+
+@property (readonly, nonatomic) Class boundClass;
 @property (readonly, nonatomic) Class cls;
+// the class's own instance methods, excluding NSObject's and private or init methods
+@property (readonly, nonatomic) NSDictionary *signatures;
 @property (readonly, nonatomic) id <BxClientLibAuthorizer> authorizer;
 @property (readonly, nonatomic) id instance;
 
@@ -1,22 +1,61 @@
 #import "BxClientLibClassBinding.h"
+#import "BxClientLibMethod.h"
 
 @implementation BxClientLibClassBinding
 
 @synthesize cls = _cls;
 @synthesize authorizer = _authorizer;
 @synthesize instance = _instance;
+@synthesize signatures = _signatures;
 
 - (id)init {
     [super init];
     _cls = nil;
     _authorizer = nil;
     _instance = nil;
+    _methods = nil;
+    _signatures = nil;
     return self;
 }
 
+- (void)_resolveMethods {
+    NSMutableDictionary *methods = [NSMutableDictionary dictionaryWithCapacity:32];
+    NSMutableDictionary *signatures = [NSMutableDictionary dictionaryWithCapacity:32];
+    for (Class cls = self.boundClass; cls && cls != [NSObject class]; cls = class_getSuperclass(cls)) {
+        unsigned int count = 0;
+        Method *methodList = class_copyMethodList(cls, &count);
+        for (unsigned int i = 0; i < count; i++) {
+            NSString *selectorName = NSStringFromSelector(method_getName(methodList[i]));
+            if ([methods objectForKey:selectorName] ||  // overridden further down
+                [selectorName hasPrefix:@"_"] || [selectorName hasPrefix:@"."] ||
+                [selectorName hasPrefix:@"init"] || [selectorName isEqualToString:@"dealloc"]) {
+                continue;
+            }
+            BxClientLibMethod *method = [[BxClientLibMethod alloc] initWithMethod:methodList[i]];
+            [methods setObject:method
+                        forKey:selectorName];
+            [signatures setObject:method.types
+                           forKey:selectorName];
+            [method release];
+        }
+        free(methodList);
+    }
+    _methods = [methods copy];
+    _signatures = [signatures copy];
+}
+
+- (Class)boundClass {
+    return _cls ? _cls : [_instance class];
+}
+
+- (BxClientLibMethod *)methodForSelectorName:(NSString *)selectorName {
+    return [_methods objectForKey:selectorName];
+}
+
 - (id)initWithClass:(Class)cls {
     [self init];
     _cls = cls;
+    [self _resolveMethods];
     return self;
 }
 
@@ -25,12 +64,14 @@
     [self init];
     _cls = cls;
     _authorizer = [authorizer retain];
+    [self _resolveMethods];
     return self;    
 }
 
 - (id)initWithInstance:(id)instance {
     [self init];
     _instance = [instance retain];
+    [self _resolveMethods];
     return self;
 }
 
@@ -39,6 +80,7 @@
     [self init];
     _instance = [instance retain];
     _authorizer = [authorizer retain];
+    [self _resolveMethods];
     return self;
 }
 
@@ -65,6 +107,8 @@
 }
 
 - (void)dealloc {
+    [_methods release];
+    [_signatures release];
     if (_instance) {
         [_instance release];
     }
@@ -7,41 +7,88 @@
  */
 
 #import <Cocoa/Cocoa.h>
+#import <libkern/OSAtomic.h>
 #import <Bombaxtic/BxHandler.h>
 #import "BxClientLibAuthenticator.h"
 #import "BxClientLibAuthorizer.h"
+#import <Bombaxtic/BxSessionStore.h>
 
+@class BxBroadcastLog;
 @class BxHandler;
 @class BxMessage;
+@class BxMessageBus;
+@class BxMessageDispatcher;
+@class BxMessageObservers;
 @class BxSession;
+@class BxSessionCookieSigner;
+@class BxSessionTable;
+
+enum BxBroadcastOverflowPolicy_enum {
+    BxBroadcastOverflowPolicyDropOldest, // the session silently misses messages it fell behind on
+    BxBroadcastOverflowPolicyInvalidateSession // the session ends and the client has to start over
+} typedef BxBroadcastOverflowPolicy;
+
+// what happens to a message sent to a session that already has the maximum pending
+enum BxPendingMessagePolicy_enum {
+    BxPendingMessagePolicyDropOldest,
+    BxPendingMessagePolicyDropNewest, // the new message is dropped
+    BxPendingMessagePolicyCoalesceByKind, // the oldest message of the same kind is dropped, or else the oldest
+    BxPendingMessagePolicyInvalidateSession // the session ends and the client has to start over
+} typedef BxPendingMessagePolicy;
 
 @interface BxClientLibHandler : BxHandler {
     NSTimeInterval _sessionTimeout;
+    BxBroadcastLog *_broadcastLog;
+    BxBroadcastOverflowPolicy _broadcastOverflowPolicy;
     id <BxClientLibAuthenticator> _authenticator;
+    id <BxSessionStore> _sessionStore;
+    BxSessionCookieSigner *_sessionCookieSigner;
     NSLock *_classNameMapLock;
-    NSLock *_globalMessageObserversLock;
-    NSLock *_messageObserversLock;
-    NSLock *_pendingMessagesLock;
-    NSLock *_sessionsLock;
+    NSLock *_longPollSessionsLock;
+    NSCondition *_longPollCondition; // wakes the long poll thread when a broadcast arrives
+    NSLock *_globalMessageObserversLock; // serializes writers
+    OSSpinLock _globalMessageObserversSpinLock; // guards the pointer swap only
     NSLock *_sessionCallbacksLock;
-    NSMutableArray *_sessions; // sessions
+    BxSessionTable *_sessions; // cookie -> session
     NSMutableDictionary *_classNameMap;
-    NSMutableDictionary *_globalMessageObservers; // kind or NSNull -> BxCallback
-    NSMutableDictionary *_messageObservers; // session -> NSDictionary = (map via NSNull) kind -> BxCallback
-    NSMutableDictionary *_pendingMessages; // session ->
+    BxMessageObservers *_globalMessageObservers; // copy on write
+    BxMessageDispatcher *_messageDispatcher; // runs observers off the request threads
+    BxMessageBus *_messageBus; // forwards broadcasts and session messages to sibling processes
     NSMutableArray *_sessionCallbacks;
+    NSMutableSet *_longPollSessions; // sessions that may have a parked long poll
+    NSTimeInterval _maxLongPollInterval;
+    NSUInteger _compressionThreshold;
+    NSUInteger _maxPendingMessages;
+    BxPendingMessagePolicy _pendingMessagePolicy;
+    BOOL _isBroadcastPending; // guarded by _longPollCondition
+    volatile int64_t _droppedMessageCount;
+    volatile int64_t _invalidatedSessionCount;
 }
 
 + (BxClientLibHandler *)addGlobalMessageObserver:(id)observer
                                         selector:(SEL)selector
                                             kind:(NSString *)kind;
 
+/* A batched observer is called with an NSArray of the messages of its kind that queued up
+ since its last call, in the order they arrived, instead of once per message. */
++ (BxClientLibHandler *)addGlobalMessageObserver:(id)observer
+                                        selector:(SEL)selector
+                                            kind:(NSString *)kind
+                                         batched:(BOOL)isBatched;
+
 // message:session
 + (BxClientLibHandler *)addMessageObserver:(id)observer
                                   selector:(SEL)selector
                                    session:(BxSession *)session
                                       kind:(NSString *)kind;
 
+// messages:session when batched
++ (BxClientLibHandler *)addMessageObserver:(id)observer
+                                  selector:(SEL)selector
+                                   session:(BxSession *)session
+                                      kind:(NSString *)kind
+                                   batched:(BOOL)isBatched;
+
 + (BxClientLibHandler *)addNewSessionCallback:(SEL)selector
                                        target:(id)target;
 
@@ -87,6 +134,9 @@
 + (BxClientLibHandler *)sendMessage:(BxMessage *)message
                           toSession:(BxSession *)session;
 
+/* The callback is sent with the message and the session once the message has been written
+ to the client, e.g. - (void)messageDelivered:(BxMessage *)message session:(BxSession *)session.
+ It is not sent if the message is dropped or the session expires first. */
 + (BxClientLibHandler *)sendMessage:(BxMessage *)message
                           toSession:(BxSession *)session
                            callback:(SEL)selector
@@ -94,6 +144,48 @@
 
 + (BxClientLibHandler *)setAuthenticator:(id <BxClientLibAuthenticator>)authenticator;
 
+/* Broadcast messages are kept once for all sessions, up to capacity messages that are
+ no older than maxAge (0 for no limit).  Defaults to 1024 messages, no age limit and
+ BxBroadcastOverflowPolicyDropOldest.  Should be called from the BxApp setup method. */
++ (BxClientLibHandler *)setBroadcastCapacity:(NSUInteger)capacity
+                                      maxAge:(NSTimeInterval)maxAge
+                              overflowPolicy:(BxBroadcastOverflowPolicy)overflowPolicy;
+
+/* Messages sent to a session wait in a queue of at most maxPendingMessages until the client
+ polls, and messages received from the client wait in another such queue for the message
+ observers.  Defaults to 1000 messages and BxPendingMessagePolicyDropOldest. */
++ (BxClientLibHandler *)setMaxPendingMessages:(NSUInteger)maxPendingMessages
+                                       policy:(BxPendingMessagePolicy)policy;
+
+/* Totals over the live sessions: "sessions", "pendingMessages" and "maxPendingMessages" (the
+ deepest queue); and since startup: "droppedMessages" and "invalidatedSessions". */
++ (NSDictionary *)outboundQueueStatistics;
+
+/* Message observers run on a pool of at most maxConcurrentDispatches threads (defaults to 4)
+ after the request has been answered.  A session's messages are observed in the order they
+ arrived, so observers must be thread safe across sessions but not within one. */
++ (BxClientLibHandler *)setMaxConcurrentMessageDispatches:(NSUInteger)maxConcurrentDispatches;
+
+/* Keyed by observer method, e.g. "-[ChatRoom messageReceived:session:]": "invocations",
+ "totalTime" and "maxTime" in seconds, since startup. */
++ (NSDictionary *)messageObserverStatistics;
+
+// responses at least this long are deflated for clients that accept it, defaults to 512 bytes
++ (BxClientLibHandler *)setCompressionThreshold:(NSUInteger)compressionThreshold;
+
+// broadcasts and session messages also reach the sibling processes joined to the bus
++ (BxClientLibHandler *)setMessageBus:(BxMessageBus *)messageBus;
+
+// the longest a client's long poll is held open without messages, 0 disables long polling
++ (BxClientLibHandler *)setMaxLongPollInterval:(NSTimeInterval)maxLongPollInterval;
+
+// keeps session state in a signed cookie instead of a server side table; remote objects
+// need the table and answer every request with an error while a signer is set
++ (BxClientLibHandler *)setSessionCookieSigner:(BxSessionCookieSigner *)sessionCookieSigner;
+
+// sessions unknown to this process are looked up in the store, see BxSQLiteSessionStore
++ (BxClientLibHandler *)setSessionStore:(id <BxSessionStore>)sessionStore;
+
 + (BxClientLibHandler *)setSessionTimeout:(NSTimeInterval)sessionTimeout;
 
 + (BxClientLibHandler *)unbindClass:(Class)cls;
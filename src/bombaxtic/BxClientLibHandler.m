@@ -1,163 +1,501 @@
 #import <Bombaxtic/BxHandler.h>
 #import <Bombaxtic/BxApp.h>
-#import <Bombaxtic/BxTransport.h>
-#import <Bombaxtic/BxSession.h>
 #import <Bombaxtic/BxMessage.h>
 #import "BxArchiveEnvelope.h"
+#import "BxBroadcastLog.h"
 #import "BxClientLibClassBinding.h"
 #import "BxClientLibHandler.h"
+#import "BxClientLibMethod.h"
 #import "BxCallback.h"
+#import "BxMessageBus.h"
+#import "BxMessageDispatcher.h"
+#import "BxMessageObservers.h"
+#import "BxSessionCookieSigner.h"
+#import "BxSessionTable.h"
+#import "BxSession_Private.h"
+#import "BxTransport_Private.h"
+#import "BxWireFormat.h"
+#import <float.h>
+
+// must match BxRemoteObjectManager in BxClientLib
+enum BxRemoteObjectRequestType_enum {
+    BxRemoteObjectRequestTypeInit,
+    BxRemoteObjectRequestTypeInitWithSigs,
+    BxRemoteObjectRequestTypeInvoke,
+    BxRemoteObjectRequestTypeRelease,
+    BxRemoteObjectRequestTypeReleaseAll,
+    BxRemoteObjectRequestTypeBatch
+} typedef BxRemoteObjectRequestType;
 
 @implementation BxClientLibHandler
 
 extern BxApp * _BX_bxApp;
 
-NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
+// 2.0 adds the BxWireFormat encoding; older clients are answered with keyed archives
+NSString *_BX_CLIENTLIB_PROTOCOL = @"2.0";
 
 - (id)initWithApp:(BxApp *)app {
     [super initWithApp:app];
     _classNameMapLock = [[NSLock alloc] init];
     _globalMessageObserversLock = [[NSLock alloc] init];
-    _messageObserversLock = [[NSLock alloc] init];
-    _pendingMessagesLock = [[NSLock alloc] init];
-    _sessionsLock = [[NSLock alloc] init];
+    _globalMessageObserversSpinLock = OS_SPINLOCK_INIT;
     _sessionCallbacksLock = [[NSLock alloc] init];
-    _sessions = [[NSMutableArray alloc] initWithCapacity:64];
     _classNameMap = [[NSMutableDictionary alloc] initWithCapacity:16];
-    _globalMessageObservers = [[NSMutableDictionary alloc] initWithCapacity:16];
-    _messageObservers = [[NSMutableDictionary alloc] initWithCapacity:16];
-    _pendingMessages = [[NSMutableDictionary alloc] initWithCapacity:32];
+    _globalMessageObservers = [[BxMessageObservers alloc] init];
+    _messageDispatcher = [[BxMessageDispatcher alloc] initWithHandler:self
+                                              maxConcurrentDispatches:4];
     _sessionCallbacks = [[NSMutableArray alloc] initWithCapacity:4];
+    _longPollSessionsLock = [[NSLock alloc] init];
+    _longPollSessions = [[NSMutableSet alloc] initWithCapacity:64];
+    _longPollCondition = [[NSCondition alloc] init];
+    _isBroadcastPending = NO;
+    _maxLongPollInterval = 30;
+    _compressionThreshold = 512;
+    _maxPendingMessages = 1000;
+    _pendingMessagePolicy = BxPendingMessagePolicyDropOldest;
+    _droppedMessageCount = 0;
+    _invalidatedSessionCount = 0;
     _sessionTimeout = 1800;
+    _broadcastLog = [[BxBroadcastLog alloc] initWithCapacity:1024
+                                                      maxAge:0];
+    _broadcastOverflowPolicy = BxBroadcastOverflowPolicyDropOldest;
+    _sessions = [[BxSessionTable alloc] initWithTimeout:_sessionTimeout];
+    [_sessions setExpiryCallback:@selector(_sessionExpired:)
+                          target:self];
+    [NSThread detachNewThreadSelector:@selector(_longPollThreadMain:)
+                             toTarget:self
+                           withObject:nil];
     return self;
 }
 
+- (void)_sessionExpired:(BxSession *)session {
+    [self _completeLongPollForSession:session
+                                dueBy:DBL_MAX];
+    [session _removeAllMessageObservers];
+    // the application may hold on to the session, but nothing will collect these now
+    [session _removeAllPendingMessages];
+    [session _removeAllRemotedObjects];
+    [_sessionStore releaseSessionForCookie:session.cookie];
+}
+
+// the client gets a 409 on its next request
+- (void)_invalidateSession:(BxSession *)session {
+    [_sessions removeSession:session];
+    [_sessionStore removeSessionForCookie:session.cookie];
+    OSAtomicIncrement64(&_invalidatedSessionCount);
+    [self _sessionExpired:session];
+}
+
+// writes the session's pending messages as the response, along with contents for the client
+- (void)_writeMessagesForSession:(BxSession *)session
+                        contents:(NSData *)contents
+                       transport:(BxTransport *)transport
+                      wireFormat:(BOOL)useWireFormat {
+    BOOL overflowed;
+    NSArray *callbacks;
+    NSArray *messages = [session _dequeueMessagesWithBroadcastLog:_broadcastLog
+                                                       overflowed:&overflowed
+                                                        callbacks:&callbacks];
+    if (overflowed && _broadcastOverflowPolicy == BxBroadcastOverflowPolicyInvalidateSession) {
+        [self _invalidateSession:session];
+        [transport setPersistentCookie:@"BxClientLib-SessionCookie"
+                                 value:@""
+                                maxAge:0];
+        [transport setHttpStatusCode:409];
+        return;
+    }
+    BxArchiveEnvelope *envelope = [[BxArchiveEnvelope alloc] initWithContents:contents
+                                                                     messages:messages];
+    NSData *data;
+    if (useWireFormat) {
+        data = [envelope _wireData];
+        [transport setHeader:@"BxClientLib-Protocol"
+                       value:_BX_CLIENTLIB_PROTOCOL];
+    } else {
+        data = [NSKeyedArchiver archivedDataWithRootObject:envelope];
+    }
+    [envelope release];
+    [transport setHeader:@"BxClientLib-Accept-Compression"
+                   value:BX_WIRE_COMPRESSION_DEFLATE];
+    NSString *acceptCompression = [transport.serverVars objectForKey:@"HTTP_BXCLIENTLIB_ACCEPT_COMPRESSION"];
+    if ([data length] >= _compressionThreshold &&
+        [[acceptCompression componentsSeparatedByString:@","] containsObject:BX_WIRE_COMPRESSION_DEFLATE]) {
+        NSData *deflated = _BX_wireDeflate(data);
+        if (deflated && [deflated length] < [data length]) {
+            data = deflated;
+            [transport setHeader:@"BxClientLib-Compression"
+                           value:BX_WIRE_COMPRESSION_DEFLATE];
+        }
+    }
+    [self _saveSession:session
+             transport:transport];
+    [transport writeData:data];
+    for (BxCallback *callback in callbacks) {
+        @try {
+            [callback invokeWith:session];
+        } @catch (id exc) {
+            NSLog(@"Bombaxtic -> Exception in a message delivery callback: %@", [exc description]);
+        }
+    }
+}
+
+- (void)_writeMessagesForSession:(BxSession *)session
+                       transport:(BxTransport *)transport
+                      wireFormat:(BOOL)useWireFormat {
+    [self _writeMessagesForSession:session
+                          contents:nil
+                         transport:transport
+                        wireFormat:useWireFormat];
+}
+
+// the result of a single remote request, archived under "result" or "error"
+- (void)_performRemoteRequest:(NSKeyedUnarchiver *)request
+                      session:(BxSession *)session
+                       result:(NSKeyedArchiver *)result {
+    NSString *error = nil;
+    BxRemoteObjectRequestType cmd = [request decodeInt32ForKey:@"cmd"];
+    if (_sessionCookieSigner) {
+        // each request decodes a new session, so nothing created here would be found again
+        error = @"Remote objects need server side sessions and are not available with signed cookie sessions";
+    } else if (cmd == BxRemoteObjectRequestTypeInit || cmd == BxRemoteObjectRequestTypeInitWithSigs) {
+        NSString *className = [request decodeObjectForKey:@"className"];
+        [_classNameMapLock lock];
+        BxClientLibClassBinding *binding = [[[_classNameMap objectForKey:className] retain] autorelease];
+        [_classNameMapLock unlock];
+        id instance = nil;
+        if (binding == nil) {
+            error = [NSString stringWithFormat:@"No class is bound as %@", className];
+        } else if (binding.authorizer && ! [binding.authorizer authorizeBxClientLibInit:binding.boundClass
+                                                                               session:session]) {
+            error = [NSString stringWithFormat:@"Not authorized to create %@", className];
+        } else {
+            instance = binding.instance ? [binding.instance retain] : [[binding.cls alloc] init];
+        }
+        if (instance) {
+            [result encodeObject:[session _addRemotedObject:instance
+                                                    binding:binding]
+                          forKey:@"oid"];
+            if (cmd == BxRemoteObjectRequestTypeInitWithSigs) {
+                [result encodeObject:binding.signatures
+                              forKey:@"signatures"];
+            }
+            [instance release];
+        } else if (error == nil) {
+            error = [NSString stringWithFormat:@"%@ could not be initialized", className];
+        }
+    } else if (cmd == BxRemoteObjectRequestTypeInvoke) {
+        NSString *selectorName = [request decodeObjectForKey:@"selector"];
+        BxClientLibClassBinding *binding = nil;
+        id target = [session _remotedObjectForOid:[request decodeObjectForKey:@"oid"]
+                                          binding:&binding];
+        BxClientLibMethod *method = [binding methodForSelectorName:selectorName];
+        if (target == nil) {
+            error = @"Unknown remote object";
+        } else if (method == nil) {
+            error = [NSString stringWithFormat:@"%@ does not expose %@", binding.boundClass, selectorName];
+        } else if (binding.authorizer && ! [binding.authorizer authorizeBxClientLibClass:binding.boundClass
+                                                                                 instance:target
+                                                                                 selector:method.selector
+                                                                                  session:session]) {
+            error = [NSString stringWithFormat:@"Not authorized to call %@", selectorName];
+        } else {
+            [method invokeWithTarget:target
+                             request:request
+                              result:result];
+        }
+    } else if (cmd == BxRemoteObjectRequestTypeRelease) {
+        [session _removeRemotedObjectForOid:[request decodeObjectForKey:@"oid"]];
+    } else if (cmd == BxRemoteObjectRequestTypeReleaseAll) {
+        [session _removeAllRemotedObjects];
+    } else {
+        error = @"Unknown remote request";
+    }
+    if (error) {
+        [result encodeObject:error
+                      forKey:@"error"];
+    }
+}
+
+// the archived answer to a BxRemoteObjectManager request; a batch is answered request by request, in order
+- (NSData *)_remoteResultForRequest:(NSKeyedUnarchiver *)request
+                            session:(BxSession *)session {
+    NSMutableData *data = [NSMutableData dataWithCapacity:512];
+    NSKeyedArchiver *archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:data];
+    if ([request decodeInt32ForKey:@"cmd"] == BxRemoteObjectRequestTypeBatch) {
+        NSArray *requests = [request decodeObjectForKey:@"requests"];
+        NSMutableArray *results = [NSMutableArray arrayWithCapacity:[requests count]];
+        for (NSData *requestData in requests) {
+            NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+            NSData *resultData = nil;
+            @try {
+                NSKeyedUnarchiver *unarchiver = [[[NSKeyedUnarchiver alloc] initForReadingWithData:requestData] autorelease];
+                if ([unarchiver decodeInt32ForKey:@"cmd"] != BxRemoteObjectRequestTypeBatch) {
+                    resultData = [self _remoteResultForRequest:unarchiver
+                                                       session:session];
+                }
+            } @catch (id exc) {
+                // answered below as an error for this request only
+            }
+            if (resultData == nil) {
+                NSMutableData *errorData = [NSMutableData dataWithCapacity:128];
+                NSKeyedArchiver *errorArchiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:errorData];
+                [errorArchiver encodeObject:@"Malformed remote request"
+                                     forKey:@"error"];
+                [errorArchiver finishEncoding];
+                [errorArchiver release];
+                resultData = errorData;
+            }
+            [results addObject:resultData];
+            [pool release];
+        }
+        [archiver encodeObject:results
+                        forKey:@"results"];
+    } else {
+        @try {
+            [self _performRemoteRequest:request
+                                session:session
+                                 result:archiver];
+        } @catch (id exc) {
+            [archiver encodeObject:[exc description]
+                            forKey:@"error"];
+        }
+    }
+    [archiver finishEncoding];
+    [archiver release];
+    return data;
+}
+
+// YES if a long poll was parked for the session with a deadline at or before time
+- (BOOL)_completeLongPollForSession:(BxSession *)session
+                              dueBy:(NSTimeInterval)time {
+    BOOL useWireFormat;
+    BxTransport *transport = [session _takeParkedTransport:&useWireFormat
+                                                     dueBy:time];
+    if (transport == nil) {
+        return NO;
+    }
+    // the request thread may not have let go of the transport yet
+    @synchronized (transport) {
+        [self _writeMessagesForSession:session
+                             transport:transport
+                            wireFormat:useWireFormat];
+        [transport resume];
+    }
+    [transport release];
+    return YES;
+}
+
+- (void)_completeLongPollForSession:(BxSession *)session {
+    [self _completeLongPollForSession:session
+                                dueBy:DBL_MAX];
+}
+
+// answers long polls that timed out without messages, and those a broadcast has reached
+- (void)_longPollThreadMain:(id)arg {
+    while (YES) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        @try {
+            [_longPollCondition lock];
+            if (! _isBroadcastPending) {
+                [_longPollCondition waitUntilDate:[NSDate dateWithTimeIntervalSinceNow:1]];
+            }
+            BOOL isBroadcastPending = _isBroadcastPending;
+            _isBroadcastPending = NO;
+            [_longPollCondition unlock];
+            NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+            [_longPollSessionsLock lock];
+            NSArray *sessions = [_longPollSessions allObjects];
+            [_longPollSessionsLock unlock];
+            for (BxSession *session in sessions) {
+                BOOL hasBroadcasts = isBroadcastPending && [session _hasBroadcastsInLog:_broadcastLog];
+                [self _completeLongPollForSession:session
+                                            dueBy:hasBroadcasts ? DBL_MAX : now];
+                [_longPollSessionsLock lock];
+                if (! [session _isParked]) {
+                    [_longPollSessions removeObject:session];
+                }
+                [_longPollSessionsLock unlock];
+            }
+        } @catch (id exc) {
+            NSLog(@"Bombaxtic -> Exception while expiring long polls: %@", [exc description]);
+        }
+        [pool release];
+    }
+}
+
+- (BxMessageObservers *)_globalMessageObservers {
+    OSSpinLockLock(&_globalMessageObserversSpinLock);
+    BxMessageObservers *observers = [_globalMessageObservers retain];
+    OSSpinLockUnlock(&_globalMessageObserversSpinLock);
+    return [observers autorelease];
+}
+
+// must be called with _globalMessageObserversLock held
+- (void)_swapGlobalMessageObservers:(BxMessageObservers *)observers {
+    [observers retain];
+    OSSpinLockLock(&_globalMessageObserversSpinLock);
+    BxMessageObservers *oldObservers = _globalMessageObservers;
+    _globalMessageObservers = observers;
+    OSSpinLockUnlock(&_globalMessageObserversSpinLock);
+    [oldObservers release];
+}
+
 - (id)renderWithTransport:(BxTransport *)transport {
-    NSLog(@"Rendering...");
     NSString *clientProtocol = [transport.serverVars objectForKey:@"HTTP_BXCLIENTLIB_PROTOCOL"];
-    if (! clientProtocol || [transport.rawPostData length] == 0) {
+    if (! clientProtocol) {
         [transport setHttpStatusCode:400];
         return self;
     }
     BxSession *currentSession = nil;
     NSString *ipAddress = [transport.serverVars objectForKey:@"REMOTE_ADDR"];
     NSString *sessionCookie = [transport.cookies objectForKey:@"BxClientLib-SessionCookie"];
-    if (sessionCookie) {
-        NSTimeInterval currentTime = [NSDate timeIntervalSinceReferenceDate];
-        [_sessionsLock lock];
-        int count = [_sessions count];
-        for (int i = count - 1; i >= 0; i--) {
-            BxSession *session = [_sessions objectAtIndex:i];
-            if (session.lastActivated + _sessionTimeout > currentTime) {
-                [_sessions removeObjectAtIndex:i];
-                continue;
-            }
-            if ([session.ipAddress isEqualToString:ipAddress] &&
-                [session.cookie isEqualToString:sessionCookie]) {
-                currentSession = [session retain];
-                break;
+    if (sessionCookie && _sessionCookieSigner) {
+        currentSession = [[_sessionCookieSigner sessionForCookie:sessionCookie
+                                                         handler:self
+                                                         timeout:_sessionTimeout] retain];
+        if (currentSession && ! [currentSession.ipAddress isEqualToString:ipAddress]) {
+            [currentSession release];
+            currentSession = nil;
+        }
+        if (currentSession == nil) {
+            [transport setPersistentCookie:@"BxClientLib-SessionCookie"
+                                     value:@""
+                                    maxAge:0];
+            [transport setHttpStatusCode:409];
+            return self;
+        }
+        // signed cookies carry no cursor, so only broadcasts made during the request are seen
+        [currentSession _setBroadcastCursor:_broadcastLog.nextSequence];
+    } else if (sessionCookie) {
+        currentSession = [[_sessions sessionForCookie:sessionCookie
+                                            ipAddress:ipAddress] retain];
+        if (currentSession) {
+            // a sibling process may have saved it since
+            [_sessionStore refreshSession:currentSession];
+            [_sessionStore touchSession:currentSession];
+        } else if (_sessionStore) {
+            // created by another process sharing the store
+            BxSession *storedSession = [_sessionStore loadSessionForCookie:sessionCookie
+                                                                   handler:self];
+            if (storedSession && [storedSession.ipAddress isEqualToString:ipAddress]) {
+                [storedSession _setBroadcastCursor:_broadcastLog.nextSequence];
+                currentSession = [[_sessions addSessionIfAbsent:storedSession] retain];
+                [currentSession _touch:[NSDate timeIntervalSinceReferenceDate]];
+                [_sessionStore touchSession:currentSession];
             }
         }
-        [_sessionsLock unlock];
         if (currentSession == nil) {
             [transport setPersistentCookie:@"BxClientLib-SessionCookie"
                                      value:@""
                                     maxAge:0];
-            // todo remove all the session cookie related stuff like _pendingMessages
+            // anything still held for an expired session is cleaned up by _sessionExpired:
             [transport setHttpStatusCode:409];
             return self;
         }
     } else {
         currentSession = [[BxSession alloc] initWithIpAddress:ipAddress
                                                       handler:self];
-        [_sessionsLock lock];
-        [_sessions addObject:currentSession];
-        [_sessionsLock unlock];
-        [transport setPersistentCookie:@"BxClientLib-SessionCookie"
-                                 value:currentSession.cookie
-                                maxAge:_sessionTimeout];
+        [currentSession _setBroadcastCursor:_broadcastLog.nextSequence];
+        if (! _sessionCookieSigner) {
+            [_sessions addSession:currentSession];
+            [transport setPersistentCookie:@"BxClientLib-SessionCookie"
+                                     value:currentSession.cookie
+                                    maxAge:_sessionTimeout];
+        }
         
         [_sessionCallbacksLock lock];
         for (BxCallback *callback in _sessionCallbacks) {
             [callback invokeWith:currentSession];
         }
         [_sessionCallbacksLock unlock];
+        [_sessionStore addSession:currentSession];
     }
     
-    [[NSKeyedUnarchiver alloc] initForReadingWithData:transport.rawPostData];
-    NSObject *obj = [NSKeyedUnarchiver unarchiveObjectWithData:transport.rawPostData];
-    NSLog(@"Object: %@", obj);
-    if (obj == nil) {
-        [transport setHttpStatusCode:400];
-    } else if ([obj isKindOfClass:[BxMessage class]]) {
-        BxMessage *message = (BxMessage *) obj;
-        NSLog(@"Message: %@ %@", message.kind, [[[NSString alloc] initWithData:message.data
-                                                                   encoding:NSUTF8StringEncoding] autorelease]);
-        [_globalMessageObserversLock lock];
-        NSArray *observers = [_globalMessageObservers objectForKey:[NSNull null]];
-        if (observers) {
-            for (BxCallback *callback in observers) {
-                [callback invokeWith:message];
-            }
-        }
-        if (message.kind) {
-            observers = [_globalMessageObservers objectForKey:message.kind];
-            if (observers) {
-                for (BxCallback *callback in observers) {
-                    [callback invokeWith:message];
+    BOOL useWireFormat = [clientProtocol doubleValue] >= 2;
+    if ([transport.rawPostData length] == 0) {
+        // a poll for pending messages; long polls wait for one to arrive without holding this thread
+        NSTimeInterval interval = MIN([[transport.serverVars objectForKey:@"HTTP_BXCLIENTLIB_LONGPOLL"] doubleValue],
+                                      _maxLongPollInterval);
+        if (interval > 0 && ! _sessionCookieSigner) {
+            [transport suspend];
+            if ([currentSession _parkTransport:transport
+                                    wireFormat:useWireFormat
+                                      deadline:[NSDate timeIntervalSinceReferenceDate] + interval
+                                  broadcastLog:_broadcastLog]) {
+                [_longPollSessionsLock lock];
+                [_longPollSessions addObject:currentSession];
+                [_longPollSessionsLock unlock];
+                // a broadcast made before the session was listed would not have woken it
+                if ([currentSession _hasBroadcastsInLog:_broadcastLog]) {
+                    [self _completeLongPollForSession:currentSession];
                 }
+                [currentSession release];
+                return self;
             }
+            [transport resume];
         }
-        [_globalMessageObserversLock unlock];
-
-        [_messageObserversLock lock]; // todo: make this more fine grained... a lock per session for example...
-        NSDictionary *kindMap = [_messageObservers objectForKey:currentSession];
-        if (kindMap) {
-            observers = [kindMap objectForKey:[NSNull null]];
-            if (observers) {
-                for (BxCallback *callback in observers) {
-                    [callback invokeWith:message];
-                }
-            }
-            if (message.kind) {
-                observers = [kindMap objectForKey:message.kind];
-                if (observers) {
-                    for (BxCallback *callback in observers) {
-                        [callback invokeWith:message];
-                    }
-                }
+        [self _writeMessagesForSession:currentSession
+                             transport:transport
+                            wireFormat:useWireFormat];
+        [currentSession release];
+        return self;
+    }
+    NSData *postData = transport.rawPostData;
+    // older clients label uncompressed bodies LZMA, so anything but deflate is taken as is
+    if ([[transport.serverVars objectForKey:@"HTTP_BXCLIENTLIB_COMPRESSION"] isEqualToString:BX_WIRE_COMPRESSION_DEFLATE]) {
+        postData = _BX_wireInflate(postData);
+    }
+    NSObject *obj = nil;
+    NSKeyedUnarchiver *remoteRequest = nil;
+    if (postData == nil) {
+        // corrupt or oversized compressed body
+    } else if (_BX_wireHasHeader(postData, BX_WIRE_TYPE_MESSAGE)) {
+        obj = [BxMessage _messageWithWireData:postData];
+    } else {
+        @try {
+            NSKeyedUnarchiver *unarchiver = [[[NSKeyedUnarchiver alloc] initForReadingWithData:postData] autorelease];
+            if ([unarchiver containsValueForKey:@"cmd"]) {
+                remoteRequest = unarchiver;
+            } else {
+                obj = [unarchiver decodeObjectForKey:@"root"];
             }
+        } @catch (id exc) {
+            // not an archive
         }
-        [_messageObserversLock unlock];
-        
-        [_pendingMessagesLock lock];
-        NSMutableArray *messages = [_pendingMessages objectForKey:currentSession.cookie];
-        BxArchiveEnvelope *envelope;
-        if (messages) {
-            envelope = [[BxArchiveEnvelope alloc] initWithContents:nil
-                                                          messages:[[messages copy] autorelease]];
-            [messages removeAllObjects];
+    }
+    if (remoteRequest) {
+        [self _writeMessagesForSession:currentSession
+                              contents:[self _remoteResultForRequest:remoteRequest
+                                                             session:currentSession]
+                             transport:transport
+                            wireFormat:useWireFormat];
+    } else if (obj == nil) {
+        [transport setHttpStatusCode:400];
+    } else if ([obj isKindOfClass:[BxMessage class]]) {
+        BxMessage *message = (BxMessage *) obj;
+        // answered as soon as the message is queued, observers run on the dispatcher's threads
+        NSUInteger dropped;
+        BOOL isQueued = [_messageDispatcher dispatchMessage:message
+                                                    session:currentSession
+                                                      limit:_maxPendingMessages
+                                                     policy:_pendingMessagePolicy
+                                                    dropped:&dropped];
+        if (dropped > 0) {
+            OSAtomicAdd64(dropped, &_droppedMessageCount);
+        }
+        if (isQueued) {
+            [self _writeMessagesForSession:currentSession
+                                 transport:transport
+                                wireFormat:useWireFormat];
         } else {
-            envelope = [[BxArchiveEnvelope alloc] initWithContents:nil
-                                                          messages:nil];
+            [self _invalidateSession:currentSession];
+            [transport setPersistentCookie:@"BxClientLib-SessionCookie"
+                                     value:@""
+                                    maxAge:0];
+            [transport setHttpStatusCode:409];
         }
-        [_pendingMessagesLock unlock];
-//        NSMutableData *data = [NSMutableData data];
-//        NSKeyedArchiver *archiver = [[[NSKeyedArchiver alloc] initForWritingWithMutableData:data] autorelease];
-//        [archiver setOutputFormat:NSPropertyListXMLFormat_v1_0];
-//        [archiver encodeRootObject:envelope];
-//        [archiver finishEncoding];
-//        NSLog(@"%@", [[[NSString alloc] initWithData:data
-//                                            encoding:NSUTF8StringEncoding] autorelease]);
-        
-        NSData *data = [NSKeyedArchiver archivedDataWithRootObject:envelope];
-        [envelope release];
-        NSLog(@"data: %@ len:%d", data, [data length]);
-        BxArchiveEnvelope *newEnvelope = [NSKeyedUnarchiver unarchiveObjectWithData:data];
-        NSLog(@"New Envelope: %@", newEnvelope);
-        [transport writeData:data];
     } else {
-        // this is a remote invocation... but what then?
+        [transport setHttpStatusCode:400];
     }
     
     
@@ -167,20 +505,41 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
     return self;
 }
 
+// must be called before anything is written so that a signed cookie goes out with the headers
+- (void)_saveSession:(BxSession *)session
+           transport:(BxTransport *)transport {
+    if (_sessionCookieSigner) {
+        NSString *cookie = [_sessionCookieSigner cookieForSession:session];
+        if (cookie) {
+            [transport setPersistentCookie:@"BxClientLib-SessionCookie"
+                                     value:cookie
+                                    maxAge:_sessionTimeout];
+        } else if (! [transport.cookies objectForKey:@"BxClientLib-SessionCookie"]) {
+            // a new session that cannot be issued a cookie would never be seen again
+            [transport setHttpStatusCode:500];
+        }
+    } else {
+        [_sessionStore saveSession:session];
+    }
+}
+
 - (void)dealloc {
     // not likely to reach here...
     [_classNameMapLock release];
+    [_longPollSessionsLock release];
+    [_longPollCondition release];
     [_globalMessageObserversLock release];
-    [_messageObserversLock release];
-    [_pendingMessagesLock release];
-    [_sessionsLock release];
     [_sessionCallbacksLock release];
     [_sessions release];
+    [_broadcastLog release];
+    [_sessionStore release];
+    [_sessionCookieSigner release];
     [_classNameMap release];
     [_globalMessageObservers release];
-    [_messageObservers release];
-    [_pendingMessages release];
+    [_messageDispatcher release];
+    [_messageBus release];
     [_sessionCallbacks release];
+    [_longPollSessions release];
     [super dealloc];
 }
 
@@ -231,22 +590,15 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
 
 - (BxClientLibHandler *)_addGlobalMessageObserver:(id)observer
                                          selector:(SEL)selector
-                                             kind:(NSString *)kind {
+                                             kind:(NSString *)kind
+                                          batched:(BOOL)isBatched {
     BxCallback *callback = [BxCallback callbackWithSelector:selector
                                                      target:observer
                                                       token:nil];
     [_globalMessageObserversLock lock];
-    id key = kind;
-    if (kind == nil) {
-        key = [NSNull null];
-    }
-    NSMutableArray *observers = [_globalMessageObservers objectForKey:key];
-    if (! observers) {
-        observers = [NSMutableArray arrayWithCapacity:16];
-        [_globalMessageObservers setObject:observers
-                                    forKey:key];
-    }
-    [observers addObject:callback];
+    [self _swapGlobalMessageObservers:[_globalMessageObservers observersByAddingCallback:callback
+                                                                                   kind:kind
+                                                                                batched:isBatched]];
     [_globalMessageObserversLock unlock];
     return self;
 }
@@ -257,7 +609,19 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
     BxClientLibHandler *singleton = [self _singleton];
     return [singleton _addGlobalMessageObserver:observer
                                        selector:selector
-                                           kind:kind];
+                                           kind:kind
+                                        batched:NO];
+}
+
++ (BxClientLibHandler *)addGlobalMessageObserver:(id)observer
+                                        selector:(SEL)selector
+                                            kind:(NSString *)kind
+                                         batched:(BOOL)isBatched {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _addGlobalMessageObserver:observer
+                                       selector:selector
+                                           kind:kind
+                                        batched:isBatched];
 }
 
 
@@ -265,29 +629,14 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
 - (BxClientLibHandler *)_addMessageObserver:(id)observer
                                    selector:(SEL)selector
                                     session:(BxSession *)session
-                                       kind:(NSString *)kind {
+                                       kind:(NSString *)kind
+                                    batched:(BOOL)isBatched {
     BxCallback *callback = [BxCallback callbackWithSelector:selector
                                                      target:observer
                                                       token:session];
-    [_messageObserversLock lock];
-    NSMutableDictionary *kindMap = [_messageObservers objectForKey:session];
-    if (! kindMap) {
-        kindMap = [NSMutableDictionary dictionaryWithCapacity:16];
-        [_messageObservers setObject:kindMap
-                              forKey:session];
-    }
-    id key = kind;
-    if (kind == nil) {
-        key = [NSNull null];
-    }
-    NSMutableArray *observers = [kindMap objectForKey:key];
-    if (! observers) {
-        observers = [NSMutableArray arrayWithCapacity:16];
-        [kindMap setObject:observers
-                    forKey:key];
-    }
-    [observers addObject:callback];
-    [_messageObserversLock unlock];
+    [session _addMessageObserver:callback
+                            kind:kind
+                         batched:isBatched];
     return self;
 }
 
@@ -299,7 +648,21 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
     return [singleton _addMessageObserver:observer
                                  selector:selector
                                   session:session
-                                     kind:kind];
+                                     kind:kind
+                                  batched:NO];
+}
+
++ (BxClientLibHandler *)addMessageObserver:(id)observer
+                                  selector:(SEL)selector
+                                   session:(BxSession *)session
+                                      kind:(NSString *)kind
+                                   batched:(BOOL)isBatched {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _addMessageObserver:observer
+                                 selector:selector
+                                  session:session
+                                     kind:kind
+                                  batched:isBatched];
 }
 
 - (BxClientLibHandler *)_bindClass:(Class)cls {
@@ -451,20 +814,20 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
                          authorizer:authorizer];
 }
 
+- (void)_deliverBroadcast:(BxMessage *)message {
+    [_broadcastLog appendMessage:message];
+    // sessions pick the message up from the log on their next poll; parked long polls are
+    // answered on the long poll thread so the caller never writes responses itself
+    [_longPollCondition lock];
+    _isBroadcastPending = YES;
+    [_longPollCondition signal];
+    [_longPollCondition unlock];
+}
+
 - (BxClientLibHandler *)_broadcastMessage:(BxMessage *)message {
-    [_pendingMessagesLock lock];
-    [_sessionsLock lock];
-    for (BxSession *session in _sessions) {
-        NSMutableArray *messages = [_pendingMessages objectForKey:session.cookie];
-        if (! messages) {
-            messages = [NSMutableArray arrayWithCapacity:4];
-            [_pendingMessages setObject:messages
-                                 forKey:session.cookie];
-        }
-        [messages addObject:message];
-    }
-    [_sessionsLock unlock];
-    [_pendingMessagesLock unlock];
+    [self _deliverBroadcast:message];
+    [_messageBus _publishMessage:message
+                          cookie:nil];
     return self;
 }
 
@@ -489,18 +852,8 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
 - (BxClientLibHandler *)_removeGlobalMessageObserver:(id)observer
                                                 kind:(NSString *)kind {
     [_globalMessageObserversLock lock];
-    if (kind) {
-        NSMutableArray *observers = [_globalMessageObservers objectForKey:kind];
-        if (observers) {
-            [observers removeObject:observer];
-        }
-    } else {
-        NSArray *keys = [_globalMessageObservers allKeys];
-        for (NSString *key in keys) {
-            NSMutableArray *observers = [_globalMessageObservers objectForKey:key];
-            [observers removeObject:observer];
-        }
-    }
+    [self _swapGlobalMessageObservers:[_globalMessageObservers observersByRemovingTarget:observer
+                                                                                   kind:kind]];
     [_globalMessageObserversLock unlock];
     return self;
 }
@@ -515,24 +868,8 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
 - (BxClientLibHandler *)_removeMessageObserver:(id)observer
                                        session:(BxSession *)session
                                           kind:(NSString *)kind {
-
-    [_messageObserversLock lock];
-    NSMutableDictionary *kindMap = [_messageObservers objectForKey:session];
-    if (kindMap) {
-        if (kind) {
-            NSMutableArray *observers = [kindMap objectForKey:kind];
-            if (observers) {
-                [observers removeObject:observer];
-            }
-        } else {
-            NSArray *keys = [kindMap allKeys];
-            for (NSString *key in keys) {
-                NSMutableArray *observers = [kindMap objectForKey:key];
-                [observers removeObject:observer];
-            }
-        }
-    }
-    [_messageObserversLock unlock];
+    [session _removeMessageObserver:observer
+                               kind:kind];
     return self;
 }
 
@@ -545,20 +882,47 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
                                         kind:kind];
 }
 
+- (void)_deliverMessage:(BxMessage *)message
+              toSession:(BxSession *)session
+               callback:(BxCallback *)callback {
+    NSUInteger dropped;
+    if (! [session _enqueueMessage:message
+                          callback:callback
+                             limit:_maxPendingMessages
+                            policy:_pendingMessagePolicy
+                           dropped:&dropped]) {
+        [self _invalidateSession:session];
+    }
+    if (dropped > 0) {
+        OSAtomicAdd64(dropped, &_droppedMessageCount);
+    }
+}
+
 - (BxClientLibHandler *)_sendMessage:(BxMessage *)message
                            toSession:(BxSession *)session {
-    [_pendingMessagesLock lock];
-    NSMutableArray *messages = [_pendingMessages objectForKey:session.cookie];
-    if (! messages) {
-        messages = [NSMutableArray arrayWithCapacity:4];
-        [_pendingMessages setObject:messages
-                             forKey:session.cookie];
-    }
-    [messages addObject:message];
-    [_pendingMessagesLock unlock];
+    [self _deliverMessage:message
+                toSession:session
+                 callback:nil];
+    [_messageBus _publishMessage:message
+                          cookie:session.cookie];
     return self;
 }
 
+// called on the bus thread for messages published by sibling processes
+- (void)_receiveMessage:(BxMessage *)message
+                 cookie:(NSString *)cookie {
+    if (cookie == nil) {
+        [self _deliverBroadcast:message];
+    } else {
+        BxSession *session = [_sessions sessionForCookie:cookie];
+        if (session) {
+            [self _deliverMessage:message
+                        toSession:session
+                         callback:nil];
+        }
+    }
+}
+
 + (BxClientLibHandler *)sendMessage:(BxMessage *)message
                           toSession:(BxSession *)session {
     BxClientLibHandler *singleton = [self _singleton];
@@ -573,15 +937,12 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
     BxCallback *callback = [BxCallback callbackWithSelector:selector
                                                      target:target
                                                       token:message];
-    [_pendingMessagesLock lock];
-    NSMutableArray *messages = [_pendingMessages objectForKey:session.cookie];
-    if (! messages) {
-        messages = [NSMutableArray arrayWithCapacity:4];
-        [_pendingMessages setObject:callback  // xxx note that the token is the message
-                             forKey:session.cookie];
-    }
-    [messages addObject:message];
-    [_pendingMessagesLock unlock];
+    // only this process delivers the callback, so it is not published to siblings
+    [self _deliverMessage:message
+                toSession:session
+                 callback:callback];
+    [_messageBus _publishMessage:message
+                          cookie:session.cookie];
     return self;
 }
 
@@ -609,8 +970,145 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
     return [singleton _setAuthenticator:authenticator];
 }
 
+- (BxClientLibHandler *)_setBroadcastCapacity:(NSUInteger)capacity
+                                       maxAge:(NSTimeInterval)maxAge
+                               overflowPolicy:(BxBroadcastOverflowPolicy)overflowPolicy {
+    // reconfigured in place, since request and bus threads may be reading it
+    [_broadcastLog setCapacity:capacity
+                        maxAge:maxAge];
+    _broadcastOverflowPolicy = overflowPolicy;
+    return self;
+}
+
++ (BxClientLibHandler *)setBroadcastCapacity:(NSUInteger)capacity
+                                      maxAge:(NSTimeInterval)maxAge
+                              overflowPolicy:(BxBroadcastOverflowPolicy)overflowPolicy {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _setBroadcastCapacity:capacity
+                                     maxAge:maxAge
+                             overflowPolicy:overflowPolicy];
+}
+
+- (BxClientLibHandler *)_setMaxPendingMessages:(NSUInteger)maxPendingMessages
+                                        policy:(BxPendingMessagePolicy)policy {
+    _maxPendingMessages = maxPendingMessages;
+    _pendingMessagePolicy = policy;
+    return self;
+}
+
++ (BxClientLibHandler *)setMaxPendingMessages:(NSUInteger)maxPendingMessages
+                                       policy:(BxPendingMessagePolicy)policy {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _setMaxPendingMessages:maxPendingMessages
+                                      policy:policy];
+}
+
+- (NSDictionary *)_outboundQueueStatistics {
+    NSArray *sessions = [_sessions allSessions];
+    NSUInteger pendingMessages = 0;
+    NSUInteger maxPendingMessages = 0;
+    for (BxSession *session in sessions) {
+        NSUInteger count = session.pendingMessageCount;
+        pendingMessages += count;
+        maxPendingMessages = MAX(maxPendingMessages, count);
+    }
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            [NSNumber numberWithUnsignedInteger:[sessions count]], @"sessions",
+            [NSNumber numberWithUnsignedInteger:pendingMessages], @"pendingMessages",
+            [NSNumber numberWithUnsignedInteger:maxPendingMessages], @"maxPendingMessages",
+            [NSNumber numberWithLongLong:_droppedMessageCount], @"droppedMessages",
+            [NSNumber numberWithLongLong:_invalidatedSessionCount], @"invalidatedSessions",
+            nil];
+}
+
++ (NSDictionary *)outboundQueueStatistics {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _outboundQueueStatistics];
+}
+
+- (BxClientLibHandler *)_setMaxConcurrentMessageDispatches:(NSUInteger)maxConcurrentDispatches {
+    _messageDispatcher.maxConcurrentDispatches = maxConcurrentDispatches;
+    return self;
+}
+
++ (BxClientLibHandler *)setMaxConcurrentMessageDispatches:(NSUInteger)maxConcurrentDispatches {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _setMaxConcurrentMessageDispatches:maxConcurrentDispatches];
+}
+
+- (NSDictionary *)_messageObserverStatistics {
+    return [_messageDispatcher statistics];
+}
+
++ (NSDictionary *)messageObserverStatistics {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _messageObserverStatistics];
+}
+
+- (BxClientLibHandler *)_setCompressionThreshold:(NSUInteger)compressionThreshold {
+    _compressionThreshold = compressionThreshold;
+    return self;
+}
+
++ (BxClientLibHandler *)setCompressionThreshold:(NSUInteger)compressionThreshold {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _setCompressionThreshold:compressionThreshold];
+}
+
+- (BxClientLibHandler *)_setMessageBus:(BxMessageBus *)messageBus {
+    [messageBus _setHandler:self];
+    [_messageBus _setHandler:nil];
+    [_messageBus release];
+    _messageBus = [messageBus retain];
+    return self;
+}
+
++ (BxClientLibHandler *)setMessageBus:(BxMessageBus *)messageBus {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _setMessageBus:messageBus];
+}
+
+- (BxClientLibHandler *)_setMaxLongPollInterval:(NSTimeInterval)maxLongPollInterval {
+    _maxLongPollInterval = maxLongPollInterval;
+    return self;
+}
+
++ (BxClientLibHandler *)setMaxLongPollInterval:(NSTimeInterval)maxLongPollInterval {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _setMaxLongPollInterval:maxLongPollInterval];
+}
+
+- (BxClientLibHandler *)_setSessionCookieSigner:(BxSessionCookieSigner *)sessionCookieSigner {
+    if (_sessionCookieSigner) {
+        [_sessionCookieSigner release];
+    }
+    _sessionCookieSigner = [sessionCookieSigner retain];
+    return self;
+}
+
++ (BxClientLibHandler *)setSessionCookieSigner:(BxSessionCookieSigner *)sessionCookieSigner {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _setSessionCookieSigner:sessionCookieSigner];
+}
+
+- (BxClientLibHandler *)_setSessionStore:(id <BxSessionStore>)sessionStore {
+    if (_sessionStore) {
+        [_sessionStore release];
+    }
+    _sessionStore = [sessionStore retain];
+    _sessionStore.timeout = _sessionTimeout;
+    return self;
+}
+
++ (BxClientLibHandler *)setSessionStore:(id <BxSessionStore>)sessionStore {
+    BxClientLibHandler *singleton = [self _singleton];
+    return [singleton _setSessionStore:sessionStore];
+}
+
 - (BxClientLibHandler *)_setSessionTimeout:(NSTimeInterval)sessionTimeout {
     _sessionTimeout = sessionTimeout;
+    _sessions.timeout = sessionTimeout;
+    _sessionStore.timeout = sessionTimeout;
     return self;
 }
 
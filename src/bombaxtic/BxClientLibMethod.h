@@ -0,0 +1,38 @@
+/**
+ \brief A remotely callable method of a class bound to BxClientLibHandler
+ \class BxClientLibMethod
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ The selector, signature and implementation are resolved once when the class is bound, so
+ an invocation only has to decode its arguments.  Methods taking up to two objects and
+ returning an object or nothing are called straight through their IMP; everything else
+ goes through an NSInvocation built from the cached signature.
+ 
+ Arguments and results are keyed archive values, "arg1"... and "result", using the same
+ encodings as BxRemoteObjectManager in BxClientLib.
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+#import <objc/runtime.h>
+
+@interface BxClientLibMethod : NSObject {
+    SEL _selector;
+    IMP _imp;
+    NSMethodSignature *_signature;
+    NSString *_types;
+    BOOL _isObjectCall;
+}
+
+- (id)initWithMethod:(Method)method;
+
+- (void)invokeWithTarget:(id)target
+                 request:(NSKeyedUnarchiver *)request
+                  result:(NSKeyedArchiver *)result;
+
+@property (readonly, nonatomic) SEL selector;
+// the Objective-C type encoding, as sent to clients
+@property (readonly, nonatomic) NSString *types;
+
+@end
@@ -0,0 +1,189 @@
+#import "BxClientLibMethod.h"
+
+#define BX_CLIENTLIB_METHOD_MAX_DIRECT_ARGUMENTS 2
+
+@implementation BxClientLibMethod
+
+@synthesize selector = _selector;
+@synthesize types = _types;
+
+// skips qualifiers such as const and oneway
+static inline char _BX_baseType(const char *type) {
+    while (*type && strchr("rnNoORV", *type)) {
+        type++;
+    }
+    return *type;
+}
+
+- (id)initWithMethod:(Method)method {
+    [super init];
+    _selector = method_getName(method);
+    _imp = method_getImplementation(method);
+    _types = [[NSString alloc] initWithUTF8String:method_getTypeEncoding(method)];
+    _signature = [[NSMethodSignature signatureWithObjCTypes:method_getTypeEncoding(method)] retain];
+    NSUInteger argumentCount = [_signature numberOfArguments] - 2;
+    char returnType = _BX_baseType([_signature methodReturnType]);
+    _isObjectCall = argumentCount <= BX_CLIENTLIB_METHOD_MAX_DIRECT_ARGUMENTS &&
+                    (returnType == '@' || returnType == 'v');
+    for (NSUInteger i = 2; _isObjectCall && i < [_signature numberOfArguments]; i++) {
+        _isObjectCall = _BX_baseType([_signature getArgumentTypeAtIndex:i]) == '@';
+    }
+    return self;
+}
+
+- (void)_encodeObjectResult:(id)x
+                     result:(NSKeyedArchiver *)result {
+    if ([x conformsToProtocol:@protocol(NSCoding)]) {
+        [result encodeObject:x
+                      forKey:@"result"];
+    }
+}
+
+- (void)_invokeDirectlyWithTarget:(id)target
+                          request:(NSKeyedUnarchiver *)request
+                           result:(NSKeyedArchiver *)result {
+    id x;
+    switch ([_signature numberOfArguments] - 2) {
+        case 0:
+            x = ((id (*)(id, SEL)) _imp)(target, _selector);
+            break;
+        case 1:
+            x = ((id (*)(id, SEL, id)) _imp)(target, _selector,
+                                             [request decodeObjectForKey:@"arg1"]);
+            break;
+        default:
+            x = ((id (*)(id, SEL, id, id)) _imp)(target, _selector,
+                                                 [request decodeObjectForKey:@"arg1"],
+                                                 [request decodeObjectForKey:@"arg2"]);
+            break;
+    }
+    if (_BX_baseType([_signature methodReturnType]) == '@') {
+        [self _encodeObjectResult:x
+                           result:result];
+    }
+}
+
+- (void)_setArgument:(NSUInteger)i
+          invocation:(NSInvocation *)invocation
+             request:(NSKeyedUnarchiver *)request {
+    NSString *argName = [NSString stringWithFormat:@"arg%d", (int) (i - 1)];
+    char argType = _BX_baseType([_signature getArgumentTypeAtIndex:i]);
+    if (argType == '@') {  // object
+        id x = [request decodeObjectForKey:argName];
+        [invocation setArgument:&x atIndex:i];
+    } else if (argType == '*') {  // c string
+        NSUInteger len = 0;
+        const uint8_t *bytes = [request decodeBytesForKey:argName
+                                           returnedLength:&len];
+        char *x = NULL;
+        if (bytes) {
+            // kept alive by the request's autorelease pool
+            NSMutableData *str = [NSMutableData dataWithBytes:bytes
+                                                       length:len];
+            [str appendBytes:"" length:1];
+            x = [str mutableBytes];
+        }
+        [invocation setArgument:&x atIndex:i];
+    } else if (argType == 'd') {  // double
+        double x = [request decodeDoubleForKey:argName];
+        [invocation setArgument:&x atIndex:i];
+    } else if (argType == 'f') {  // float
+        float x = [request decodeFloatForKey:argName];
+        [invocation setArgument:&x atIndex:i];
+    } else if (argType == 'c' || argType == 'C' || argType == 'B') {
+        char x = [request decodeInt32ForKey:argName];
+        [invocation setArgument:&x atIndex:i];
+    } else if (argType == 's' || argType == 'S') {
+        short x = [request decodeInt32ForKey:argName];
+        [invocation setArgument:&x atIndex:i];
+    } else if (argType == 'i' || argType == 'I') {
+        int x = [request decodeInt32ForKey:argName];
+        [invocation setArgument:&x atIndex:i];
+    } else if (argType == 'l' || argType == 'L') {
+        long x = [request decodeInt32ForKey:argName];
+        [invocation setArgument:&x atIndex:i];
+    } else if (argType == 'q' || argType == 'Q') {  // long long
+        long long x = [request decodeInt64ForKey:argName];
+        [invocation setArgument:&x atIndex:i];
+    } else {
+        // other type, unsupported; left zeroed
+    }
+}
+
+- (void)_encodeReturnValue:(NSInvocation *)invocation
+                    result:(NSKeyedArchiver *)result {
+    char returnType = _BX_baseType([_signature methodReturnType]);
+    if (returnType == '@') {  // object
+        id x;
+        [invocation getReturnValue:&x];
+        [self _encodeObjectResult:x
+                           result:result];
+    } else if (returnType == '*') {  // c string
+        char *x;
+        [invocation getReturnValue:&x];
+        if (x) {
+            [result encodeBytes:(uint8_t *) x
+                         length:strlen(x)
+                         forKey:@"result"];
+        }
+    } else if (returnType == 'd') {  // double
+        double x;
+        [invocation getReturnValue:&x];
+        [result encodeDouble:x forKey:@"result"];
+    } else if (returnType == 'f') {  // float
+        float x;
+        [invocation getReturnValue:&x];
+        [result encodeFloat:x forKey:@"result"];
+    } else if (returnType == 'c' || returnType == 'C' || returnType == 'B') {
+        char x;
+        [invocation getReturnValue:&x];
+        [result encodeInt32:x forKey:@"result"];
+    } else if (returnType == 's' || returnType == 'S') {
+        short x;
+        [invocation getReturnValue:&x];
+        [result encodeInt32:x forKey:@"result"];
+    } else if (returnType == 'i' || returnType == 'I') {
+        int x;
+        [invocation getReturnValue:&x];
+        [result encodeInt32:x forKey:@"result"];
+    } else if (returnType == 'l' || returnType == 'L') {
+        long x;
+        [invocation getReturnValue:&x];
+        [result encodeInt32:(int32_t) x forKey:@"result"];
+    } else if (returnType == 'q' || returnType == 'Q') {  // long long
+        long long x;
+        [invocation getReturnValue:&x];
+        [result encodeInt64:x forKey:@"result"];
+    } else {
+        // void or unsupported
+    }
+}
+
+- (void)invokeWithTarget:(id)target
+                 request:(NSKeyedUnarchiver *)request
+                  result:(NSKeyedArchiver *)result {
+    if (_isObjectCall) {
+        [self _invokeDirectlyWithTarget:target
+                                request:request
+                                 result:result];
+        return;
+    }
+    NSInvocation *invocation = [NSInvocation invocationWithMethodSignature:_signature];
+    [invocation setSelector:_selector];
+    for (NSUInteger i = 2; i < [_signature numberOfArguments]; i++) {
+        [self _setArgument:i
+                invocation:invocation
+                   request:request];
+    }
+    [invocation invokeWithTarget:target];
+    [self _encodeReturnValue:invocation
+                      result:result];
+}
+
+- (void)dealloc {
+    [_signature release];
+    [_types release];
+    [super dealloc];
+}
+
+@end
@@ -35,7 +35,7 @@
  
  - (id)renderWithTransport:(BxTransport *)transport {
      NSString *ipAddress = [transport.serverVars objectForKey:@"REMOTE_ADDR"];
-     NSMutableDictionary *results = [_db fetchNamedRowWith:@"SELECT * FROM ipInfo WHERE ip=?", ipAddress, nil];
+     NSDictionary *results = [_db fetchNamedRowWith:@"SELECT * FROM ipInfo WHERE ip=?", ipAddress, nil];
      if (results != nil) {
          [transport write:@"Old variables:\n"];
          [transport writeFormat:@"%@", results];
@@ -68,6 +68,7 @@ enum BxDatabaseConnectionType_enum {
     BxDatabaseConnectionTypeSQLite
 } typedef BxDatabaseConnectionType;
 
+@class BxDatabaseQuery;
 @class BxDatabaseStatement;
 
 @interface BxDatabaseConnection : NSObject {
@@ -80,6 +81,11 @@ enum BxDatabaseConnectionType_enum {
     void *_rawError;
     void *_rawServer;
     NSMutableSet *_statementsSet;
+    NSMutableDictionary *_statementCache; // sql -> BxDatabaseStatement
+    NSMutableArray *_statementCacheOrder; // sql, least recently used first
+    NSUInteger _statementCacheSize;
+    BOOL _fetchesTypedValues;
+    NSOperationQueue *_asyncQueue; // created by the first asynchronous query
 }
 
 /** \anchor beginTransaction
@@ -248,7 +254,8 @@ enum BxDatabaseConnectionType_enum {
  advisable to construct the SQL from user-provided parameters due to the
  danger of SQL injection.  In such cases, use of \c fetchAllWith: is recommended.
  
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
 
  Example of returning all the results in a table:
  \code
@@ -280,7 +287,8 @@ enum BxDatabaseConnectionType_enum {
  specifying the placeholders varies from database to database (e.g. \c :name for Oracle,
  \c ? for MySQL, etc).
  
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
 
  Example of returning all the results in a table:
  \code
@@ -311,7 +319,8 @@ enum BxDatabaseConnectionType_enum {
  advisable to construct the SQL from user-provided parameters due to the
  danger of SQL injection.  In such cases, use of \c fetchNamedAllWith: is recommended.
  
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
 
  Example of returning all the results in a table:
  \code
@@ -345,7 +354,8 @@ enum BxDatabaseConnectionType_enum {
  specifying the placeholders varies from database to database (e.g. \c :name for Oracle,
  \c ? for MySQL, etc).
 
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
 
  Example of returning all the results in a table:
  \code
@@ -378,7 +388,8 @@ enum BxDatabaseConnectionType_enum {
  construct the SQL from user-provided parameters due to the danger of SQL injection.
  In such cases, use of \c fetchNamedRowWith: is recommended.
  
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
 
  Example of returning a single results for a table:
  \code
@@ -410,7 +421,8 @@ enum BxDatabaseConnectionType_enum {
  specifying the placeholders varies from database to database (e.g. \c :name for Oracle,
  \c ? for MySQL, etc).
 
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
  
  Example of returning a single results for a table:
  \code
@@ -441,7 +453,8 @@ enum BxDatabaseConnectionType_enum {
  construct the SQL from user-provided parameters due to the danger of SQL injection.
  In such cases, use of \c fetchRowWith: is recommended.
  
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
  
  Example of returning a single results for a table:
  \code
@@ -473,7 +486,8 @@ enum BxDatabaseConnectionType_enum {
  placeholders varies from database to database (e.g. \c :name for Oracle, \c ?
  for MySQL, etc).
  
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
 
  Example of returning a single results for a table:
  \code
@@ -496,6 +510,57 @@ enum BxDatabaseConnectionType_enum {
  */
 - (NSArray *)fetchRowWith:(NSString *)sql, ...;
 
+/** \anchor executeAsyncWith
+ \brief Starts executing the provided SQL with the provided values in the background
+
+ The query runs on a worker thread and the call returns at once.  A connection runs one
+ query at a time, so its asynchronous queries run one after another; use a BxDatabasePool
+ to run queries in parallel.  Unless the connection was opened with \c locking, it must
+ not be used by the current thread until the query is done.
+
+ \param sql the raw SQL statement to execute, followed by a \c nil terminated list of values
+ \return a query whose \c result is an \c NSNumber boolean, as returned by \c executeWith:
+ \sa BxDatabaseQuery
+ \since 2.0
+ */
+- (BxDatabaseQuery *)executeAsyncWith:(NSString *)sql, ...;
+
+/** \anchor fetchAllAsyncWith
+ \brief Starts fetching an array of row arrays for a SELECT statement in the background
+ \param sql the raw SQL statement to execute, followed by a \c nil terminated list of values
+ \return a query whose \c result is an array of row arrays, as returned by \c fetchAllWith:
+ \sa BxDatabaseQuery
+ \since 2.0
+ */
+- (BxDatabaseQuery *)fetchAllAsyncWith:(NSString *)sql, ...;
+
+/** \anchor fetchNamedAllAsyncWith
+ \brief Starts fetching an array of row dictionaries for a SELECT statement in the background
+ \param sql the raw SQL statement to execute, followed by a \c nil terminated list of values
+ \return a query whose \c result is an array of row dictionaries, as returned by \c fetchNamedAllWith:
+ \sa BxDatabaseQuery
+ \since 2.0
+ */
+- (BxDatabaseQuery *)fetchNamedAllAsyncWith:(NSString *)sql, ...;
+
+/** \anchor fetchNamedRowAsyncWith
+ \brief Starts fetching a single row dictionary for a SELECT statement in the background
+ \param sql the raw SQL statement to execute, followed by a \c nil terminated list of values
+ \return a query whose \c result is a single row dictionary, as returned by \c fetchNamedRowWith:
+ \sa BxDatabaseQuery
+ \since 2.0
+ */
+- (BxDatabaseQuery *)fetchNamedRowAsyncWith:(NSString *)sql, ...;
+
+/** \anchor fetchRowAsyncWith
+ \brief Starts fetching a single row array for a SELECT statement in the background
+ \param sql the raw SQL statement to execute, followed by a \c nil terminated list of values
+ \return a query whose \c result is a single row array, as returned by \c fetchRowWith:
+ \sa BxDatabaseQuery
+ \since 2.0
+ */
+- (BxDatabaseQuery *)fetchRowAsyncWith:(NSString *)sql, ...;
+
 /** \anchor initWithMySQLServer
  \brief Creates a new BxDatabaseConnection for a MySQL server
  
@@ -1008,4 +1073,26 @@ enum BxDatabaseConnectionType_enum {
  */
 @property (nonatomic, readonly) void *rawConnection;
 
+/** \anchor statementCacheSize
+ The number of prepared statements kept for reuse by the \c execute and \c fetch methods,
+ defaults to 32.  The statement for a given SQL text is prepared once and then only reset
+ and rebound each time the same SQL is run again, with the least recently used statement
+ closed when the cache is full.  Set to 0 to prepare every statement anew.
+ 
+ \note Statements returned by \c prepare: and \c prepareWith: are never cached.
+ 
+ \since 2.0
+ */
+@property (nonatomic, assign) NSUInteger statementCacheSize;
+
+/** \anchor connectionFetchesTypedValues
+ If \c YES, the \c fetch methods and new statements return values with the column types
+ of the database (NSNumber, NSDecimalNumber, NSData and NSDate) instead of NSStrings.
+ Defaults to \c NO.
+ 
+ \sa BxDatabaseStatement's \c fetchesTypedValues property
+ \since 2.0
+ */
+@property (nonatomic, assign) BOOL fetchesTypedValues;
+
 @end
@@ -1,5 +1,4 @@
-#import "BxDatabaseConnection.h"
-#import <Bombaxtic/BxDatabaseStatement.h>
+#import "BxDatabaseConnection_Private.h"
 #import "sqlite3.h"
 #import "mysql.h"
 #import "libpq-fe.h"
@@ -12,6 +11,8 @@
 @synthesize rawConnection = _rawConnection;
 @synthesize lastError = _lastError;
 @synthesize recursiveLock = _lock;
+@synthesize statementCacheSize = _statementCacheSize;
+@synthesize fetchesTypedValues = _fetchesTypedValues;
 
 static BOOL _hasInitializedOracle = NO;
 static OCIEnv *_oraEnv = NULL;
@@ -20,6 +21,76 @@ static OCIEnv *_oraEnv = NULL;
     return _statementsSet;
 }
 
+- (void)_initStatementCache {
+    _statementCache = [[NSMutableDictionary alloc] initWithCapacity:32];
+    _statementCacheOrder = [[NSMutableArray alloc] initWithCapacity:32];
+    _statementCacheSize = 32;
+}
+
+// prelocked
+- (void)_trimStatementCache:(NSUInteger)size {
+    while ([_statementCacheOrder count] > size) {
+        NSString *sql = [_statementCacheOrder objectAtIndex:0];
+        [[_statementCache objectForKey:sql] close];
+        [_statementCache removeObjectForKey:sql];
+        [_statementCacheOrder removeObjectAtIndex:0];
+    }
+}
+
+// prelocked; a statement with the args bound, owned by the cache when there is room for it
+- (BxDatabaseStatement *)_statementForSQL:(NSString *)sql
+                                     args:(va_list)args {
+    BxDatabaseStatement *stmt = [_statementCache objectForKey:sql];
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    if (stmt) {
+        [_statementCacheOrder removeObject:sql];
+        stmt.fetchesTypedValues = _fetchesTypedValues;
+        if ([stmt _rebindArgs:args]) {
+            [_statementCacheOrder addObject:[[sql copy] autorelease]];
+            va_end(argsCopy);
+            return stmt;
+        }
+        // prepared again below
+        [stmt close];
+        [_statementCache removeObjectForKey:sql];
+    }
+    stmt = [[[BxDatabaseStatement alloc] initWithConnection:self
+                                                        sql:sql
+                                                       args:argsCopy] autorelease];
+    va_end(argsCopy);
+    if (stmt && _statementCacheSize > 0) {
+        NSString *key = [[sql copy] autorelease];
+        [self _trimStatementCache:_statementCacheSize - 1];
+        [stmt _setCached];
+        [_statementCache setObject:stmt
+                            forKey:key];
+        [_statementCacheOrder addObject:key];
+    }
+    return stmt;
+}
+
+// prelocked; cached statements are reset for their next use, others closed at once
+- (void)_finishStatement:(BxDatabaseStatement *)stmt {
+    // a cached statement that was just used is the most recent one
+    if ([_statementCache objectForKey:[_statementCacheOrder lastObject]] == stmt) {
+        [stmt _reset];
+    } else {
+        [stmt close];
+    }
+}
+
+- (void)setStatementCacheSize:(NSUInteger)statementCacheSize {
+    if (_isLocking) {
+        [_lock lock];
+    }
+    _statementCacheSize = statementCacheSize;
+    [self _trimStatementCache:statementCacheSize];
+    if (_isLocking) {
+        [_lock unlock];
+    }
+}
+
 - (OCIError *)_ociError {
     return (OCIError *) _rawError;
 }
@@ -69,6 +140,8 @@ static OCIEnv *_oraEnv = NULL;
         [_lock lock];
     }
     BOOL result = YES;
+    // cached statements have to be finalized before the connection can close
+    [self _trimStatementCache:0];
     if (_connectionType == BxDatabaseConnectionTypeSQLite) {
         sqlite3 *conn = (sqlite3 *) _rawConnection;
         if (sqlite3_close(conn) != SQLITE_OK) {
@@ -147,7 +220,8 @@ static OCIEnv *_oraEnv = NULL;
     return [self executeWith:sql, nil];
 }
 
-- (BOOL)executeWith:(NSString *)sql, ... {
+- (BOOL)_executeWith:(NSString *)sql
+                args:(va_list)args {
     if (_isClosed) {
         self.lastError = @"Database closed.";
         return NO;
@@ -157,17 +231,13 @@ static OCIEnv *_oraEnv = NULL;
     }
     BOOL result;
     BxDatabaseStatement *stmt;
-    va_list args;
-    va_start(args, sql);
-    stmt = [[BxDatabaseStatement alloc] initWithConnection:self
-                                                       sql:sql
-                                                      args:args];
-    va_end(args);
+    stmt = [self _statementForSQL:sql
+                             args:args];
     if (stmt == nil) {
         result = NO;
     } else {
         result = [stmt execute];
-        [stmt release];
+        [self _finishStatement:stmt];
     }
     if (_isLocking) {
         [_lock unlock];
@@ -175,12 +245,22 @@ static OCIEnv *_oraEnv = NULL;
     return result;
 }
 
+- (BOOL)executeWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BOOL result = [self _executeWith:sql
+                                args:args];
+    va_end(args);
+    return result;
+}
+
 
 - (NSArray *)fetchAll:(NSString *)sql {
     return [self fetchAllWith:sql, nil];
 }
 
-- (NSArray *)fetchAllWith:(NSString *)sql, ... {
+- (NSArray *)_fetchAllWith:(NSString *)sql
+                      args:(va_list)args {
     if (_isClosed) {
         self.lastError = @"Database closed.";
         return nil;
@@ -189,12 +269,8 @@ static OCIEnv *_oraEnv = NULL;
         [_lock lock];
     }
     NSMutableArray *array = nil;
-    va_list args;
-    va_start(args, sql);
-    BxDatabaseStatement *stmt = [[BxDatabaseStatement alloc] initWithConnection:self
-                                                                            sql:sql
-                                                                           args:args];
-    va_end(args);
+    BxDatabaseStatement *stmt = [self _statementForSQL:sql
+                                                  args:args];
     if (stmt != nil) {
         if ([stmt execute]) {
             array = [NSMutableArray arrayWithCapacity:128];
@@ -206,7 +282,7 @@ static OCIEnv *_oraEnv = NULL;
                 [array addObject:row];
             }
         }
-        [stmt release];
+        [self _finishStatement:stmt];
     }
     if (_isLocking) {
         [_lock unlock];
@@ -219,7 +295,17 @@ static OCIEnv *_oraEnv = NULL;
     return [self fetchNamedAllWith:sql, nil];
 }
 
-- (NSArray *)fetchNamedAllWith:(NSString *)sql, ... {
+- (NSArray *)fetchAllWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    NSArray *array = [self _fetchAllWith:sql
+                                    args:args];
+    va_end(args);
+    return array;
+}
+
+- (NSArray *)_fetchNamedAllWith:(NSString *)sql
+                           args:(va_list)args {
     if (_isClosed) {
         self.lastError = @"Database closed.";
         return nil;
@@ -228,12 +314,8 @@ static OCIEnv *_oraEnv = NULL;
         [_lock lock];
     }
     NSMutableArray *array = nil;
-    va_list args;
-    va_start(args, sql);
-    BxDatabaseStatement *stmt = [[BxDatabaseStatement alloc] initWithConnection:self
-                                                                            sql:sql
-                                                                           args:args];
-    va_end(args);
+    BxDatabaseStatement *stmt = [self _statementForSQL:sql
+                                                  args:args];
     if (stmt != nil) {
         if ([stmt execute]) {
             array = [NSMutableArray arrayWithCapacity:128];
@@ -247,7 +329,7 @@ static OCIEnv *_oraEnv = NULL;
                 [array addObject:dict];
             }
         }
-        [stmt release];
+        [self _finishStatement:stmt];
     }
     if (_isLocking) {
         [_lock unlock];
@@ -259,7 +341,17 @@ static OCIEnv *_oraEnv = NULL;
     return [self fetchNamedRowWith:sql, nil];
 }
 
-- (NSDictionary *)fetchNamedRowWith:(NSString *)sql, ... {
+- (NSArray *)fetchNamedAllWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    NSArray *array = [self _fetchNamedAllWith:sql
+                                         args:args];
+    va_end(args);
+    return array;
+}
+
+- (NSDictionary *)_fetchNamedRowWith:(NSString *)sql
+                                args:(va_list)args {
     if (_isClosed) {
         self.lastError = @"Database closed.";
         return nil;
@@ -269,17 +361,13 @@ static OCIEnv *_oraEnv = NULL;
     }
     
     NSDictionary *row = nil;
-    va_list args;
-    va_start(args, sql);
-    BxDatabaseStatement *stmt = [[BxDatabaseStatement alloc] initWithConnection:self
-                                                                            sql:sql
-                                                                           args:args];
-    va_end(args);
+    BxDatabaseStatement *stmt = [self _statementForSQL:sql
+                                                  args:args];
     if (stmt != nil) {
         if ([stmt execute]) {
             row = [stmt fetchDictionary];
         }
-        [stmt release];
+        [self _finishStatement:stmt];
     }
     if (_isLocking) {
         [_lock unlock];
@@ -287,11 +375,21 @@ static OCIEnv *_oraEnv = NULL;
     return row;    
 }
 
+- (NSDictionary *)fetchNamedRowWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    NSDictionary *row = [self _fetchNamedRowWith:sql
+                                            args:args];
+    va_end(args);
+    return row;
+}
+
 - (NSArray *)fetchRow:(NSString *)sql {
     return [self fetchRowWith:sql, nil];
 }
 
-- (NSArray *)fetchRowWith:(NSString *)sql, ... {
+- (NSArray *)_fetchRowWith:(NSString *)sql
+                      args:(va_list)args {
     if (_isClosed) {
         self.lastError = @"Database closed.";
         return nil;
@@ -301,17 +399,13 @@ static OCIEnv *_oraEnv = NULL;
     }
     
     NSArray *row = nil;
-    va_list args;
-    va_start(args, sql);
-    BxDatabaseStatement *stmt = [[BxDatabaseStatement alloc] initWithConnection:self
-                                                                            sql:sql
-                                                                           args:args];
-    va_end(args);
+    BxDatabaseStatement *stmt = [self _statementForSQL:sql
+                                                  args:args];
     if (stmt != nil) {
         if ([stmt execute]) {
             row = [stmt fetchArray];
         }
-        [stmt release];
+        [self _finishStatement:stmt];
     }
     if (_isLocking) {
         [_lock unlock];
@@ -319,6 +413,88 @@ static OCIEnv *_oraEnv = NULL;
     return row;    
 }
 
+- (NSArray *)fetchRowWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    NSArray *row = [self _fetchRowWith:sql
+                                  args:args];
+    va_end(args);
+    return row;
+}
+
+- (BxDatabaseQuery *)_startQuery:(BxDatabaseQueryType)type
+                             sql:(NSString *)sql
+                            args:(va_list)args {
+    @synchronized (self) {
+        if (_asyncQueue == nil) {
+            // one query at a time, as on the connection itself
+            _asyncQueue = [[NSOperationQueue alloc] init];
+            [_asyncQueue setMaxConcurrentOperationCount:1];
+        }
+    }
+    BxDatabaseQuery *query = [[BxDatabaseQuery alloc] _initWithType:type
+                                                                sql:sql
+                                                               args:args
+                                                               pool:nil
+                                                         connection:self];
+    NSInvocationOperation *operation = [[NSInvocationOperation alloc] initWithTarget:query
+                                                                            selector:@selector(_run)
+                                                                              object:nil];
+    [_asyncQueue addOperation:operation];
+    [operation release];
+    return [query autorelease];
+}
+
+- (BxDatabaseQuery *)executeAsyncWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseQuery *query = [self _startQuery:BxDatabaseQueryTypeExecute
+                                           sql:sql
+                                          args:args];
+    va_end(args);
+    return query;
+}
+
+- (BxDatabaseQuery *)fetchAllAsyncWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseQuery *query = [self _startQuery:BxDatabaseQueryTypeFetchAll
+                                           sql:sql
+                                          args:args];
+    va_end(args);
+    return query;
+}
+
+- (BxDatabaseQuery *)fetchNamedAllAsyncWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseQuery *query = [self _startQuery:BxDatabaseQueryTypeFetchNamedAll
+                                           sql:sql
+                                          args:args];
+    va_end(args);
+    return query;
+}
+
+- (BxDatabaseQuery *)fetchNamedRowAsyncWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseQuery *query = [self _startQuery:BxDatabaseQueryTypeFetchNamedRow
+                                           sql:sql
+                                          args:args];
+    va_end(args);
+    return query;
+}
+
+- (BxDatabaseQuery *)fetchRowAsyncWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseQuery *query = [self _startQuery:BxDatabaseQueryTypeFetchRow
+                                           sql:sql
+                                          args:args];
+    va_end(args);
+    return query;
+}
+
 - (id)initWithMySQLServer:(NSString *)server
                  database:(NSString *)database
                      user:(NSString *)user
@@ -348,6 +524,7 @@ static OCIEnv *_oraEnv = NULL;
     _connectionType = BxDatabaseConnectionTypeMySQL;
     self.lastError = nil;
     _isClosed = NO;
+    [self _initStatementCache];
     
     MYSQL *conn;
     conn = mysql_init(NULL);
@@ -391,6 +568,7 @@ static OCIEnv *_oraEnv = NULL;
     _connectionType = BxDatabaseConnectionTypeOracle;
     self.lastError = nil;
     _isClosed = NO;
+    [self _initStatementCache];
     if (_hasInitializedOracle == NO) {
         int rc;
         if (rc = OCIEnvCreate(&_oraEnv,
@@ -483,6 +661,7 @@ static OCIEnv *_oraEnv = NULL;
     _connectionType = BxDatabaseConnectionTypePostgreSQL;
     self.lastError = nil;
     _isClosed = NO;
+    [self _initStatementCache];
     _statementsSet = [[NSMutableSet alloc] initWithCapacity:16];
     const char *cServer = server == nil ? NULL : [server UTF8String];
     const char *cDatabase = database == nil ? NULL : [database UTF8String];
@@ -519,6 +698,7 @@ static OCIEnv *_oraEnv = NULL;
     _connectionType = BxDatabaseConnectionTypeSQLite;
     self.lastError = nil;
     _isClosed = NO;
+    [self _initStatementCache];
     sqlite3 *conn;
     if (sqlite3_open([path UTF8String], &conn) != SQLITE_OK) {
         if (error != nil && error != NULL) {
@@ -545,7 +725,8 @@ static OCIEnv *_oraEnv = NULL;
     return [self prepareWith:sql, nil];
 }
 
-- (BxDatabaseStatement *)prepareWith:(NSString *)sql, ... {
+- (BxDatabaseStatement *)_prepareWith:(NSString *)sql
+                                 args:(va_list)args {
     if (_isClosed) {
         self.lastError = @"Database closed.";
         return nil;
@@ -554,18 +735,24 @@ static OCIEnv *_oraEnv = NULL;
         [_lock lock];
     }
     BxDatabaseStatement *stmt = nil;
-    va_list args;
-    va_start(args, sql);
     stmt = [[[BxDatabaseStatement alloc] initWithConnection:self
                                                         sql:sql
                                                        args:args] autorelease];
-    va_end(args);
     if (_isLocking) {
         [_lock unlock];
     }
     return stmt;
 }
 
+- (BxDatabaseStatement *)prepareWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseStatement *stmt = [self _prepareWith:sql
+                                              args:args];
+    va_end(args);
+    return stmt;
+}
+
 - (BOOL)rollbackTransaction {
     if (_isClosed) {
         self.lastError = @"Database closed.";
@@ -609,6 +796,9 @@ static OCIEnv *_oraEnv = NULL;
     if (_isLocking) {
         [_lock release];
     }
+    [_statementCache release];
+    [_statementCacheOrder release];
+    [_asyncQueue release];
     if (_connectionType == BxDatabaseConnectionTypeSQLite) {
         
     } else if (_connectionType == BxDatabaseConnectionTypePostgreSQL) {
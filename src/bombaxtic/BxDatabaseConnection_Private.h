@@ -0,0 +1,52 @@
+/**
+ \brief Methods shared between BxDatabaseConnection, BxDatabasePool, BxDatabaseStatement and BxDatabaseQuery
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ Not part of the public API.  Anything that calls these must import this header so that
+ the compiler knows their return types.
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+#import <Bombaxtic/BxDatabaseConnection.h>
+#import <Bombaxtic/BxDatabaseQuery.h>
+#import <Bombaxtic/BxDatabaseStatement.h>
+
+@class BxDatabasePool;
+
+@interface BxDatabaseConnection (Private)
+
+- (BOOL)_executeWith:(NSString *)sql
+                args:(va_list)args;
+- (NSArray *)_fetchAllWith:(NSString *)sql
+                      args:(va_list)args;
+- (NSArray *)_fetchNamedAllWith:(NSString *)sql
+                           args:(va_list)args;
+- (NSDictionary *)_fetchNamedRowWith:(NSString *)sql
+                                args:(va_list)args;
+- (NSArray *)_fetchRowWith:(NSString *)sql
+                      args:(va_list)args;
+- (BxDatabaseStatement *)_prepareWith:(NSString *)sql
+                                 args:(va_list)args;
+
+@end
+
+@interface BxDatabaseStatement (Private)
+
+- (void)_setCached;
+- (BOOL)_reset;
+- (BOOL)_rebindArgs:(va_list)args;
+- (void)_setPool:(BxDatabasePool *)pool;
+
+@end
+
+@interface BxDatabaseQuery (Private)
+
+- (id)_initWithType:(BxDatabaseQueryType)type
+                sql:(NSString *)sql
+               args:(va_list)args
+               pool:(BxDatabasePool *)pool
+         connection:(BxDatabaseConnection *)connection;
+
+@end
@@ -0,0 +1,309 @@
+/**
+ \brief Shares a set of BxDatabaseConnection instances between request threads
+ \class BxDatabasePool
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+
+ A single BxDatabaseConnection runs one query at a time, so every request thread using
+ it queues behind the others.  BxDatabasePool keeps between \c minSize and \c maxSize
+ connections open and lends one to each thread for the duration of a call, so that up to
+ \c maxSize queries run in parallel.  The pool provides the same \c execute, \c fetch and
+ \c prepare methods as BxDatabaseConnection and works with any of its databases, since
+ the connections are opened by a callback provided by the application.
+
+ A thread that already holds a connection, e.g. between \c beginTransaction and
+ \c commitTransaction or while using a statement from \c prepare:, is always given that
+ same connection again.  Otherwise a thread gets back the connection it used last if it
+ is idle.  When all \c maxSize connections are in use, a thread waits up to
+ \c checkoutTimeout seconds for one to be returned before the call fails.
+
+ Connections that have been idle for \c validationInterval seconds are checked with a
+ trivial query before they are lent out and replaced if the check fails, e.g. because the
+ server closed the connection.  Connections idle for longer than \c idleTimeout are
+ closed in the background as long as more than \c minSize remain.
+
+ \note The connections are only ever used by one thread at a time and do not need to be
+ opened with locking.  A statement returned by \c prepare: keeps its connection until it
+ is closed or deallocated, which must happen on the thread that prepared it.
+
+ Example of a pool of MySQL connections:
+ \code
+ @implementation MyHandler
+ - (BxDatabaseConnection *)connectionForPool:(BxDatabasePool *)pool {
+     return [[[BxDatabaseConnection alloc] initWithMySQLServer:@"localhost"
+                                                       database:@"exampledb"
+                                                           user:@"jane"
+                                                       password:@"secret"
+                                                        locking:NO
+                                                          error:nil] autorelease];
+ }
+
+ - (id)setup {
+     _pool = [[BxDatabasePool alloc] initWithMinSize:2
+                                             maxSize:8
+                                  connectionCallback:@selector(connectionForPool:)
+                                              target:self
+                                               error:nil];
+     return self;
+ }
+
+ - (id)renderWithTransport:(BxTransport *)transport {
+     NSArray *rows = [_pool fetchAllWith:@"SELECT name FROM cheeses WHERE country=?", @"France", nil];
+     // ...
+     return self;
+ }
+ \endcode
+
+ */
+
+#import <Cocoa/Cocoa.h>
+
+@class BxCallback;
+@class BxDatabaseConnection;
+@class BxDatabaseQuery;
+@class BxDatabaseStatement;
+
+@interface BxDatabasePool : NSObject {
+    BxCallback *_connectionCallback;
+    NSCondition *_condition;
+    NSMutableArray *_idleConnections; // least recently returned first
+    NSMutableArray *_idleSince; // NSNumber time each idle connection was returned
+    NSUInteger _connectionCount; // idle, lent out or being opened
+    NSUInteger _minSize;
+    NSUInteger _maxSize;
+    NSString *_threadKey;
+    NSTimeInterval _checkoutTimeout;
+    NSTimeInterval _idleTimeout;
+    NSTimeInterval _validationInterval;
+    NSString *_lastError;
+    NSOperationQueue *_asyncQueue;
+}
+
+/** \anchor initWithMinSize
+ \brief Creates a new BxDatabasePool and opens its first \c minSize connections
+
+ The callback is sent with the pool as its only argument whenever a connection is needed
+ and returns an autoreleased BxDatabaseConnection, or \c nil if it could not connect.
+
+ \param minSize the number of connections kept open even while idle
+ \param maxSize the most connections open at once, at least 1
+ \param selector the callback that opens a connection
+ \param target the object the callback is sent to, which is retained
+ \param error if not \c nil will be populated with the error message if an error occurs
+
+ \return a pool with \c minSize open connections or \c nil if one could not be opened
+ \since 2.0
+ */
+- (id)initWithMinSize:(NSUInteger)minSize
+              maxSize:(NSUInteger)maxSize
+   connectionCallback:(SEL)selector
+               target:(id)target
+                error:(NSString **)error;
+
+/** \anchor checkoutConnection
+ \brief Lends a connection to the current thread until it is checked back in
+
+ Every \c checkoutConnection must be matched by a \c checkinConnection: on the same
+ thread.  Calls may be nested; the thread keeps the connection until the outermost
+ checkout is checked in.
+
+ \return a connection or \c nil if none became available within \c checkoutTimeout, in which case \c lastError is set
+ \since 2.0
+ */
+- (BxDatabaseConnection *)checkoutConnection;
+
+/** \anchor checkinConnection
+ \brief Returns a connection obtained with \c checkoutConnection
+ \since 2.0
+ */
+- (id)checkinConnection:(BxDatabaseConnection *)connection;
+
+/** \anchor poolBeginTransaction
+ \brief Checks out a connection for the current thread and begins a transaction on it
+
+ Every pool call the thread makes until \c commitTransaction or \c rollbackTransaction
+ uses the same connection.
+
+ \sa BxDatabaseConnection's \c beginTransaction method
+ \since 2.0
+ */
+- (BOOL)beginTransaction;
+
+/** \anchor poolCommitTransaction
+ \brief Commits the current thread's transaction and checks its connection back in
+ \since 2.0
+ */
+- (BOOL)commitTransaction;
+
+/** \anchor poolRollbackTransaction
+ \brief Cancels the current thread's transaction and checks its connection back in
+ \since 2.0
+ */
+- (BOOL)rollbackTransaction;
+
+/** \anchor poolExecute
+ \brief Executes the provided SQL on a pooled connection
+ \sa BxDatabaseConnection's \c execute: method
+ \since 2.0
+ */
+- (BOOL)execute:(NSString *)sql;
+
+/** \anchor poolExecuteWith
+ \brief Executes the provided SQL with the provided values on a pooled connection
+ \sa BxDatabaseConnection's \c executeWith: method
+ \since 2.0
+ */
+- (BOOL)executeWith:(NSString *)sql, ...;
+
+/** \anchor poolFetchAll
+ \brief Returns an array of row arrays for a SELECT statement
+ \since 2.0
+ */
+- (NSArray *)fetchAll:(NSString *)sql;
+
+/** \anchor poolFetchAllWith
+ \brief Returns an array of row arrays for a SELECT statement with the provided values
+ \since 2.0
+ */
+- (NSArray *)fetchAllWith:(NSString *)sql, ...;
+
+/** \anchor poolFetchNamedAll
+ \brief Returns an array of row dictionaries for a SELECT statement
+ \since 2.0
+ */
+- (NSArray *)fetchNamedAll:(NSString *)sql;
+
+/** \anchor poolFetchNamedAllWith
+ \brief Returns an array of row dictionaries for a SELECT statement with the provided values
+ \since 2.0
+ */
+- (NSArray *)fetchNamedAllWith:(NSString *)sql, ...;
+
+/** \anchor poolFetchNamedRow
+ \brief Returns a single row dictionary for a SELECT statement
+ \since 2.0
+ */
+- (NSDictionary *)fetchNamedRow:(NSString *)sql;
+
+/** \anchor poolFetchNamedRowWith
+ \brief Returns a single row dictionary for a SELECT statement with the provided values
+ \since 2.0
+ */
+- (NSDictionary *)fetchNamedRowWith:(NSString *)sql, ...;
+
+/** \anchor poolFetchRow
+ \brief Returns a single row array for a SELECT statement
+ \since 2.0
+ */
+- (NSArray *)fetchRow:(NSString *)sql;
+
+/** \anchor poolFetchRowWith
+ \brief Returns a single row array for a SELECT statement with the provided values
+ \since 2.0
+ */
+- (NSArray *)fetchRowWith:(NSString *)sql, ...;
+
+/** \anchor poolExecuteAsyncWith
+ \brief Starts executing the provided SQL with the provided values in the background
+
+ The query runs on a worker thread with a connection of its own, so up to \c maxSize
+ queries started by one request run in parallel.  A query never joins the current
+ thread's transaction; use the blocking methods between \c beginTransaction and
+ \c commitTransaction.
+
+ Example of running two queries at once:
+ \code
+ - (id)renderWithTransport:(BxTransport *)transport {
+     BxDatabaseQuery *cheeses = [_pool fetchAllAsyncWith:@"SELECT name FROM cheeses WHERE country=?", @"France", nil];
+     NSArray *wines = [_pool fetchAllWith:@"SELECT name FROM wines WHERE country=?", @"France", nil];
+     [transport writeFormat:@"%@ with %@", [cheeses result], wines];
+     return self;
+ }
+ \endcode
+
+
+ \param sql the raw SQL statement to execute, followed by a \c nil terminated list of values
+ \return a query whose \c result is an \c NSNumber boolean, as returned by \c executeWith:
+ \sa BxDatabaseQuery
+ \since 2.0
+ */
+- (BxDatabaseQuery *)executeAsyncWith:(NSString *)sql, ...;
+
+/** \anchor poolFetchAllAsyncWith
+ \brief Starts fetching an array of row arrays for a SELECT statement in the background
+ \param sql the raw SQL statement to execute, followed by a \c nil terminated list of values
+ \return a query whose \c result is an array of row arrays, as returned by \c fetchAllWith:
+ \sa BxDatabaseQuery
+ \since 2.0
+ */
+- (BxDatabaseQuery *)fetchAllAsyncWith:(NSString *)sql, ...;
+
+/** \anchor poolFetchNamedAllAsyncWith
+ \brief Starts fetching an array of row dictionaries for a SELECT statement in the background
+ \param sql the raw SQL statement to execute, followed by a \c nil terminated list of values
+ \return a query whose \c result is an array of row dictionaries, as returned by \c fetchNamedAllWith:
+ \sa BxDatabaseQuery
+ \since 2.0
+ */
+- (BxDatabaseQuery *)fetchNamedAllAsyncWith:(NSString *)sql, ...;
+
+/** \anchor poolFetchNamedRowAsyncWith
+ \brief Starts fetching a single row dictionary for a SELECT statement in the background
+ \param sql the raw SQL statement to execute, followed by a \c nil terminated list of values
+ \return a query whose \c result is a single row dictionary, as returned by \c fetchNamedRowWith:
+ \sa BxDatabaseQuery
+ \since 2.0
+ */
+- (BxDatabaseQuery *)fetchNamedRowAsyncWith:(NSString *)sql, ...;
+
+/** \anchor poolFetchRowAsyncWith
+ \brief Starts fetching a single row array for a SELECT statement in the background
+ \param sql the raw SQL statement to execute, followed by a \c nil terminated list of values
+ \return a query whose \c result is a single row array, as returned by \c fetchRowWith:
+ \sa BxDatabaseQuery
+ \since 2.0
+ */
+- (BxDatabaseQuery *)fetchRowAsyncWith:(NSString *)sql, ...;
+
+/** \anchor poolPrepare
+ \brief Creates a prepared statement that keeps a pooled connection until it is closed
+ \sa BxDatabaseConnection's \c prepare: method
+ \since 2.0
+ */
+- (BxDatabaseStatement *)prepare:(NSString *)sql;
+
+/** \anchor poolPrepareWith
+ \brief Creates a prepared statement with the provided values that keeps a pooled connection until it is closed
+ \since 2.0
+ */
+- (BxDatabaseStatement *)prepareWith:(NSString *)sql, ...;
+
+/** \anchor checkoutTimeout
+ How long a thread waits for a connection when all are in use, defaults to 10 seconds
+ \since 2.0
+ */
+@property (assign) NSTimeInterval checkoutTimeout;
+
+/** \anchor idleTimeout
+ How long a connection beyond \c minSize may stay idle before it is closed, defaults to 300 seconds
+ \since 2.0
+ */
+@property (assign) NSTimeInterval idleTimeout;
+
+/** \anchor validationInterval
+ How long a connection may be idle before it is checked on checkout, defaults to 30 seconds.
+ 0 checks every checkout and a negative value never does.
+ \since 2.0
+ */
+@property (assign) NSTimeInterval validationInterval;
+
+/** \anchor poolLastError
+ The last error of a pooled call, which may have come from any thread
+ \since 2.0
+ */
+@property (copy) NSString *lastError;
+
+@property (readonly) NSUInteger minSize;
+@property (readonly) NSUInteger maxSize;
+
+@end
@@ -0,0 +1,473 @@
+#import "BxDatabasePool.h"
+#import "BxCallback.h"
+#import "BxDatabaseConnection_Private.h"
+#import <Bombaxtic/BxUtil.h>
+
+// how often idle connections are looked at for closing
+#define BX_DATABASE_POOL_REAP_INTERVAL 5
+
+@implementation BxDatabasePool
+
+@synthesize checkoutTimeout = _checkoutTimeout;
+@synthesize idleTimeout = _idleTimeout;
+@synthesize validationInterval = _validationInterval;
+@synthesize lastError = _lastError;
+@synthesize minSize = _minSize;
+@synthesize maxSize = _maxSize;
+
+- (id)initWithMinSize:(NSUInteger)minSize
+              maxSize:(NSUInteger)maxSize
+   connectionCallback:(SEL)selector
+               target:(id)target
+                error:(NSString **)error {
+    [super init];
+    _maxSize = MAX(maxSize, 1);
+    _minSize = MIN(minSize, _maxSize);
+    _connectionCallback = [[BxCallback alloc] initWithSelector:selector
+                                                        target:target];
+    _condition = [[NSCondition alloc] init];
+    _idleConnections = [[NSMutableArray alloc] initWithCapacity:_maxSize];
+    _idleSince = [[NSMutableArray alloc] initWithCapacity:_maxSize];
+    _connectionCount = 0;
+    _threadKey = [[NSString alloc] initWithFormat:@"BxDatabasePool-%@", [BxUtil randomAlphaNumericString:16]];
+    _checkoutTimeout = 10;
+    _idleTimeout = 300;
+    _validationInterval = 30;
+    _lastError = nil;
+    _asyncQueue = [[NSOperationQueue alloc] init];
+    [_asyncQueue setMaxConcurrentOperationCount:_maxSize];
+    NSNumber *now = [NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate]];
+    while (_connectionCount < _minSize) {
+        BxDatabaseConnection *connection = [self _openConnection];
+        if (connection == nil) {
+            if (error != nil && error != NULL) {
+                *error = _lastError;
+            }
+            [self release];
+            return nil;
+        }
+        [_idleConnections addObject:connection];
+        [_idleSince addObject:now];
+        _connectionCount++;
+    }
+    [NSThread detachNewThreadSelector:@selector(_reapThreadMain:)
+                             toTarget:self
+                           withObject:nil];
+    return self;
+}
+
+- (BxDatabaseConnection *)_openConnection {
+    BxDatabaseConnection *connection = nil;
+    @try {
+        connection = [_connectionCallback invokeWith:self];
+    } @catch (id exc) {
+        NSLog(@"Bombaxtic -> Exception while opening a pooled database connection: %@", [exc description]);
+    }
+    if (! [connection isKindOfClass:[BxDatabaseConnection class]]) {
+        self.lastError = @"Could not open a database connection.";
+        return nil;
+    }
+    return connection;
+}
+
+- (BOOL)_validateConnection:(BxDatabaseConnection *)connection {
+    NSString *sql = @"SELECT 1";
+    if (connection.connectionType == BxDatabaseConnectionTypeOracle) {
+        sql = @"SELECT 1 FROM DUAL";
+    }
+    return [connection fetchRow:sql] != nil;
+}
+
+- (NSMutableDictionary *)_threadState {
+    NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+    NSMutableDictionary *threadState = [threadDictionary objectForKey:_threadKey];
+    if (threadState == nil) {
+        threadState = [NSMutableDictionary dictionaryWithCapacity:3];
+        [threadDictionary setObject:threadState
+                             forKey:_threadKey];
+    }
+    return threadState;
+}
+
+// returns a retained connection, or nil once the deadline has passed
+- (BxDatabaseConnection *)_takeConnectionPreferring:(BxDatabaseConnection *)preferred {
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:_checkoutTimeout];
+    BxDatabaseConnection *connection = nil;
+    NSTimeInterval idleSince = 0;
+    BOOL isOpening = NO;
+    [_condition lock];
+    while (connection == nil) {
+        NSUInteger count = [_idleConnections count];
+        if (count > 0) {
+            NSUInteger index = preferred ? [_idleConnections indexOfObjectIdenticalTo:preferred] : NSNotFound;
+            if (index == NSNotFound) {
+                // the most recently used is the most likely to still be open
+                index = count - 1;
+            }
+            connection = [[_idleConnections objectAtIndex:index] retain];
+            idleSince = [[_idleSince objectAtIndex:index] doubleValue];
+            [_idleConnections removeObjectAtIndex:index];
+            [_idleSince removeObjectAtIndex:index];
+        } else if (_connectionCount < _maxSize) {
+            _connectionCount++;
+            isOpening = YES;
+            break;
+        } else if (! [_condition waitUntilDate:deadline]) {
+            break;
+        }
+    }
+    [_condition unlock];
+    if (connection && _validationInterval >= 0 &&
+        [NSDate timeIntervalSinceReferenceDate] - idleSince >= _validationInterval &&
+        ! [self _validateConnection:connection]) {
+        [connection release];
+        connection = nil;
+        isOpening = YES;
+    }
+    if (isOpening) {
+        connection = [[self _openConnection] retain];
+        if (connection == nil) {
+            [_condition lock];
+            _connectionCount--;
+            [_condition signal];
+            [_condition unlock];
+        }
+    } else if (connection == nil) {
+        self.lastError = @"Timed out waiting for a database connection.";
+    }
+    return connection;
+}
+
+- (BxDatabaseConnection *)checkoutConnection {
+    NSMutableDictionary *threadState = [self _threadState];
+    BxDatabaseConnection *connection = [threadState objectForKey:@"connection"];
+    if (connection) {
+        [threadState setObject:[NSNumber numberWithUnsignedInteger:[[threadState objectForKey:@"depth"] unsignedIntegerValue] + 1]
+                        forKey:@"depth"];
+        return connection;
+    }
+    connection = [self _takeConnectionPreferring:[[threadState objectForKey:@"last"] nonretainedObjectValue]];
+    if (connection) {
+        [threadState setObject:connection
+                        forKey:@"connection"];
+        [threadState setObject:[NSNumber numberWithUnsignedInteger:1]
+                        forKey:@"depth"];
+        [threadState setObject:[NSValue valueWithNonretainedObject:connection]
+                        forKey:@"last"];
+        [connection release];
+    }
+    return connection;
+}
+
+- (id)checkinConnection:(BxDatabaseConnection *)connection {
+    if (connection == nil) {
+        return self;
+    }
+    NSMutableDictionary *threadState = [self _threadState];
+    [connection retain];
+    if ([threadState objectForKey:@"connection"] == connection) {
+        NSUInteger depth = [[threadState objectForKey:@"depth"] unsignedIntegerValue];
+        if (depth > 1) {
+            [threadState setObject:[NSNumber numberWithUnsignedInteger:depth - 1]
+                            forKey:@"depth"];
+            [connection release];
+            return self;
+        }
+        [threadState removeObjectForKey:@"connection"];
+        [threadState removeObjectForKey:@"depth"];
+    }
+    [_condition lock];
+    [_idleConnections addObject:connection];
+    [_idleSince addObject:[NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate]]];
+    [_condition signal];
+    [_condition unlock];
+    [connection release];
+    return self;
+}
+
+- (void)_reapIdleConnections {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    NSMutableArray *expired = [NSMutableArray arrayWithCapacity:4];
+    [_condition lock];
+    // oldest first, so stop at the first one that has not expired
+    while ([_idleConnections count] > 0 && _connectionCount > _minSize &&
+           now - [[_idleSince objectAtIndex:0] doubleValue] > _idleTimeout) {
+        [expired addObject:[_idleConnections objectAtIndex:0]];
+        [_idleConnections removeObjectAtIndex:0];
+        [_idleSince removeObjectAtIndex:0];
+        _connectionCount--;
+    }
+    BOOL isBelowMinimum = _connectionCount < _minSize;
+    if (isBelowMinimum) {
+        _connectionCount++;
+    }
+    [_condition unlock];
+    // closed outside the lock when the array goes away
+    if (isBelowMinimum) {
+        BxDatabaseConnection *connection = [self _openConnection];
+        if (connection) {
+            [self checkinConnection:connection];
+        } else {
+            [_condition lock];
+            _connectionCount--;
+            [_condition unlock];
+        }
+    }
+}
+
+- (void)_reapThreadMain:(id)arg {
+    while (YES) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        @try {
+            [NSThread sleepForTimeInterval:BX_DATABASE_POOL_REAP_INTERVAL];
+            [self _reapIdleConnections];
+        } @catch (id exc) {
+            NSLog(@"Bombaxtic -> Exception while closing idle database connections: %@", [exc description]);
+        }
+        [pool release];
+    }
+}
+
+- (BOOL)beginTransaction {
+    BxDatabaseConnection *connection = [self checkoutConnection];
+    if (connection == nil) {
+        return NO;
+    }
+    if (! [connection beginTransaction]) {
+        self.lastError = connection.lastError;
+        [self checkinConnection:connection];
+        return NO;
+    }
+    return YES;
+}
+
+- (BOOL)commitTransaction {
+    BxDatabaseConnection *connection = [[self _threadState] objectForKey:@"connection"];
+    if (connection == nil) {
+        self.lastError = @"No transaction has been begun on this thread.";
+        return NO;
+    }
+    BOOL result = [connection commitTransaction];
+    if (! result) {
+        self.lastError = connection.lastError;
+    }
+    [self checkinConnection:connection];
+    return result;
+}
+
+- (BOOL)rollbackTransaction {
+    BxDatabaseConnection *connection = [[self _threadState] objectForKey:@"connection"];
+    if (connection == nil) {
+        self.lastError = @"No transaction has been begun on this thread.";
+        return NO;
+    }
+    BOOL result = [connection rollbackTransaction];
+    if (! result) {
+        self.lastError = connection.lastError;
+    }
+    [self checkinConnection:connection];
+    return result;
+}
+
+- (BOOL)execute:(NSString *)sql {
+    return [self executeWith:sql, nil];
+}
+
+- (BOOL)executeWith:(NSString *)sql, ... {
+    BxDatabaseConnection *connection = [self checkoutConnection];
+    if (connection == nil) {
+        return NO;
+    }
+    va_list args;
+    va_start(args, sql);
+    BOOL result = [connection _executeWith:sql
+                                      args:args];
+    va_end(args);
+    if (! result) {
+        self.lastError = connection.lastError;
+    }
+    [self checkinConnection:connection];
+    return result;
+}
+
+- (NSArray *)fetchAll:(NSString *)sql {
+    return [self fetchAllWith:sql, nil];
+}
+
+- (NSArray *)fetchAllWith:(NSString *)sql, ... {
+    BxDatabaseConnection *connection = [self checkoutConnection];
+    if (connection == nil) {
+        return nil;
+    }
+    va_list args;
+    va_start(args, sql);
+    NSArray *array = [connection _fetchAllWith:sql
+                                          args:args];
+    va_end(args);
+    if (array == nil) {
+        self.lastError = connection.lastError;
+    }
+    [self checkinConnection:connection];
+    return array;
+}
+
+- (NSArray *)fetchNamedAll:(NSString *)sql {
+    return [self fetchNamedAllWith:sql, nil];
+}
+
+- (NSArray *)fetchNamedAllWith:(NSString *)sql, ... {
+    BxDatabaseConnection *connection = [self checkoutConnection];
+    if (connection == nil) {
+        return nil;
+    }
+    va_list args;
+    va_start(args, sql);
+    NSArray *array = [connection _fetchNamedAllWith:sql
+                                               args:args];
+    va_end(args);
+    if (array == nil) {
+        self.lastError = connection.lastError;
+    }
+    [self checkinConnection:connection];
+    return array;
+}
+
+- (NSDictionary *)fetchNamedRow:(NSString *)sql {
+    return [self fetchNamedRowWith:sql, nil];
+}
+
+- (NSDictionary *)fetchNamedRowWith:(NSString *)sql, ... {
+    BxDatabaseConnection *connection = [self checkoutConnection];
+    if (connection == nil) {
+        return nil;
+    }
+    va_list args;
+    va_start(args, sql);
+    NSDictionary *row = [connection _fetchNamedRowWith:sql
+                                                  args:args];
+    va_end(args);
+    [self checkinConnection:connection];
+    return row;
+}
+
+- (NSArray *)fetchRow:(NSString *)sql {
+    return [self fetchRowWith:sql, nil];
+}
+
+- (NSArray *)fetchRowWith:(NSString *)sql, ... {
+    BxDatabaseConnection *connection = [self checkoutConnection];
+    if (connection == nil) {
+        return nil;
+    }
+    va_list args;
+    va_start(args, sql);
+    NSArray *row = [connection _fetchRowWith:sql
+                                        args:args];
+    va_end(args);
+    [self checkinConnection:connection];
+    return row;
+}
+
+- (BxDatabaseQuery *)_startQuery:(BxDatabaseQueryType)type
+                             sql:(NSString *)sql
+                            args:(va_list)args {
+    BxDatabaseQuery *query = [[BxDatabaseQuery alloc] _initWithType:type
+                                                                sql:sql
+                                                               args:args
+                                                               pool:self
+                                                         connection:nil];
+    NSInvocationOperation *operation = [[NSInvocationOperation alloc] initWithTarget:query
+                                                                            selector:@selector(_run)
+                                                                              object:nil];
+    [_asyncQueue addOperation:operation];
+    [operation release];
+    return [query autorelease];
+}
+
+- (BxDatabaseQuery *)executeAsyncWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseQuery *query = [self _startQuery:BxDatabaseQueryTypeExecute
+                                           sql:sql
+                                          args:args];
+    va_end(args);
+    return query;
+}
+
+- (BxDatabaseQuery *)fetchAllAsyncWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseQuery *query = [self _startQuery:BxDatabaseQueryTypeFetchAll
+                                           sql:sql
+                                          args:args];
+    va_end(args);
+    return query;
+}
+
+- (BxDatabaseQuery *)fetchNamedAllAsyncWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseQuery *query = [self _startQuery:BxDatabaseQueryTypeFetchNamedAll
+                                           sql:sql
+                                          args:args];
+    va_end(args);
+    return query;
+}
+
+- (BxDatabaseQuery *)fetchNamedRowAsyncWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseQuery *query = [self _startQuery:BxDatabaseQueryTypeFetchNamedRow
+                                           sql:sql
+                                          args:args];
+    va_end(args);
+    return query;
+}
+
+- (BxDatabaseQuery *)fetchRowAsyncWith:(NSString *)sql, ... {
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseQuery *query = [self _startQuery:BxDatabaseQueryTypeFetchRow
+                                           sql:sql
+                                          args:args];
+    va_end(args);
+    return query;
+}
+
+- (BxDatabaseStatement *)prepare:(NSString *)sql {
+    return [self prepareWith:sql, nil];
+}
+
+- (BxDatabaseStatement *)prepareWith:(NSString *)sql, ... {
+    BxDatabaseConnection *connection = [self checkoutConnection];
+    if (connection == nil) {
+        return nil;
+    }
+    va_list args;
+    va_start(args, sql);
+    BxDatabaseStatement *stmt = [connection _prepareWith:sql
+                                                    args:args];
+    va_end(args);
+    if (stmt == nil) {
+        self.lastError = connection.lastError;
+        [self checkinConnection:connection];
+    } else {
+        // checked back in when the statement closes
+        [stmt _setPool:self];
+    }
+    return stmt;
+}
+
+- (void)dealloc {
+    // not likely to reach here while the reaping thread is running...
+    [_connectionCallback release];
+    [_condition release];
+    [_idleConnections release];
+    [_idleSince release];
+    [_threadKey release];
+    [_lastError release];
+    [_asyncQueue release];
+    [super dealloc];
+}
+
+@end
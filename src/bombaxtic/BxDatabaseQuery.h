@@ -0,0 +1,115 @@
+/**
+ \brief A query running in the background whose result is collected later
+ \class BxDatabaseQuery
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+
+ BxDatabaseQuery is returned by the \c ...AsyncWith: methods of BxDatabasePool and
+ BxDatabaseConnection, which return as soon as the query has been handed to a worker
+ thread.  The request thread carries on and collects the query's \c result when it needs
+ it, waiting only if the query has not finished by then.
+
+ A pool runs up to \c maxSize queries at once, each on a connection of its own, so a
+ page that starts several independent queries waits about as long as the slowest one
+ instead of all of them in turn.  A single connection runs its queries one after another
+ on a worker thread, which frees the request thread but does not run queries in parallel.
+
+ Instead of waiting, a completion callback may be set which is sent on the worker thread
+ with the query as its only argument once the result is in.
+
+ Example of running queries in parallel:
+ \code
+ - (id)renderWithTransport:(BxTransport *)transport {
+     BxDatabaseQuery *cheeses = [_pool fetchAllAsyncWith:@"SELECT name FROM cheeses WHERE country=?", @"France", nil];
+     BxDatabaseQuery *wines = [_pool fetchAllAsyncWith:@"SELECT name FROM wines WHERE country=?", @"France", nil];
+     BxDatabaseQuery *count = [_pool fetchRowAsyncWith:@"SELECT COUNT(*) FROM visits", nil];
+     // all three are running now
+     [transport writeFormat:@"%@ and %@ (%@ visits)",
+                            [cheeses result],
+                            [wines result],
+                            [[count result] objectAtIndex:0]];
+     return self;
+ }
+ \endcode
+
+ */
+
+#import <Cocoa/Cocoa.h>
+
+@class BxCallback;
+@class BxDatabaseConnection;
+@class BxDatabasePool;
+
+enum BxDatabaseQueryType_enum {
+    BxDatabaseQueryTypeExecute,
+    BxDatabaseQueryTypeFetchAll,
+    BxDatabaseQueryTypeFetchNamedAll,
+    BxDatabaseQueryTypeFetchNamedRow,
+    BxDatabaseQueryTypeFetchRow
+} typedef BxDatabaseQueryType;
+
+@interface BxDatabaseQuery : NSObject {
+    BOOL _isDone;
+    BxDatabaseQueryType _type;
+    BxDatabasePool *_pool; // or _connection, whichever runs the query
+    BxDatabaseConnection *_connection;
+    BxCallback *_completionCallback;
+    NSCondition *_condition;
+    NSString *_sql;
+    NSArray *_values; // bound in order, NSNull for NULL
+    NSString *_lastError;
+    id _result;
+}
+
+/** \anchor queryResult
+ \brief Returns the result of the query, waiting for it to finish if necessary
+
+ The result is what the corresponding blocking method returns: an \c NSNumber boolean
+ for \c executeAsyncWith:, an array of rows for \c fetchAllAsyncWith: and
+ \c fetchNamedAllAsyncWith:, or a single row for \c fetchRowAsyncWith: and
+ \c fetchNamedRowAsyncWith:.
+
+ \return the result, or \c nil if the query failed, in which case \c lastError is set
+ \since 2.0
+ */
+- (id)result;
+
+/** \anchor waitUntilDate
+ \brief Waits for the query to finish until the given date at the latest
+ \return \c YES if the query has finished
+ \since 2.0
+ */
+- (BOOL)waitUntilDate:(NSDate *)date;
+
+/** \anchor setCompletionCallback
+ \brief Sets the callback sent with the query once it has finished
+
+ The callback is sent on the worker thread that ran the query, or right away on the
+ current thread if the query has already finished.
+
+ \param selector the callback, which takes the query as its only argument
+ \param target the object the callback is sent to, which is retained
+ \since 2.0
+ */
+- (BxDatabaseQuery *)setCompletionCallback:(SEL)selector
+                                    target:(id)target;
+
+/** \anchor queryIsDone
+ \c YES once the query has finished and its \c result is available without waiting
+ \since 2.0
+ */
+@property (readonly) BOOL isDone;
+
+/** \anchor queryLastError
+ The error of the query if it failed
+ \since 2.0
+ */
+@property (readonly) NSString *lastError;
+
+/** \anchor querySQL
+ The SQL being run
+ \since 2.0
+ */
+@property (readonly) NSString *sql;
+
+@end
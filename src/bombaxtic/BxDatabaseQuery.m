@@ -0,0 +1,194 @@
+#import "BxDatabaseQuery.h"
+#import "BxCallback.h"
+#import "BxDatabaseConnection_Private.h"
+#import <Bombaxtic/BxDatabasePool.h>
+
+@implementation BxDatabaseQuery
+
+@synthesize sql = _sql;
+
+// runs on the pool if given, otherwise on the connection
+- (id)_initWithType:(BxDatabaseQueryType)type
+                sql:(NSString *)sql
+               args:(va_list)args
+               pool:(BxDatabasePool *)pool
+         connection:(BxDatabaseConnection *)connection {
+    [super init];
+    _type = type;
+    _sql = [sql copy];
+    NSMutableArray *values = [[NSMutableArray alloc] initWithCapacity:8];
+    id value;
+    while ((value = va_arg(args, id))) {
+        [values addObject:value];
+    }
+    _values = values;
+    _pool = [pool retain];
+    _connection = [connection retain];
+    _condition = [[NSCondition alloc] init];
+    _isDone = NO;
+    _result = nil;
+    _lastError = nil;
+    _completionCallback = nil;
+    return self;
+}
+
+// prelocked when the connection is locking
+- (id)_resultFromConnection:(BxDatabaseConnection *)connection
+                      error:(NSString **)error {
+    BxDatabaseStatement *stmt = [connection prepare:_sql];
+    if (stmt == nil || ([_values count] > 0 && ! [stmt bindArray:_values]) || ! [stmt execute]) {
+        *error = connection.lastError;
+        [stmt close];
+        return nil;
+    }
+    id result = nil;
+    if (_type == BxDatabaseQueryTypeExecute) {
+        result = [NSNumber numberWithBool:YES];
+    } else if (_type == BxDatabaseQueryTypeFetchAll) {
+        result = [NSMutableArray arrayWithCapacity:128];
+        while (stmt.hasMoreRows) {
+            NSArray *row = [stmt fetchArray];
+            if (row == nil) {
+                *error = connection.lastError;
+                result = nil;
+                break;
+            }
+            [result addObject:row];
+        }
+    } else if (_type == BxDatabaseQueryTypeFetchNamedAll) {
+        result = [NSMutableArray arrayWithCapacity:128];
+        while (stmt.hasMoreRows) {
+            NSDictionary *dict = [stmt fetchDictionary];
+            if (dict == nil) {
+                *error = connection.lastError;
+                result = nil;
+                break;
+            }
+            [result addObject:dict];
+        }
+    } else if (_type == BxDatabaseQueryTypeFetchNamedRow) {
+        result = [stmt fetchDictionary];
+    } else if (_type == BxDatabaseQueryTypeFetchRow) {
+        result = [stmt fetchArray];
+    }
+    [stmt close];
+    return result;
+}
+
+- (void)_run {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    id result = nil;
+    NSString *error = nil;
+    BxDatabaseConnection *connection = nil;
+    BOOL isLocked = NO;
+    @try {
+        connection = _connection;
+        if (_pool) {
+            connection = [_pool checkoutConnection];
+            if (connection == nil) {
+                error = _pool.lastError;
+            }
+        }
+        if (connection) {
+            if (connection.isLocking) {
+                [connection.recursiveLock lock];
+                isLocked = YES;
+            }
+            result = [self _resultFromConnection:connection
+                                           error:&error];
+        }
+    } @catch (id exc) {
+        NSLog(@"Bombaxtic -> Exception while running an asynchronous query: %@", [exc description]);
+        error = [exc description];
+        result = nil;
+    } @finally {
+        // the worker thread is reused, so nothing may stay locked or checked out
+        if (isLocked) {
+            [connection.recursiveLock unlock];
+        }
+        if (_pool && connection) {
+            if (error) {
+                _pool.lastError = error;
+            }
+            [_pool checkinConnection:connection];
+        }
+    }
+    [_condition lock];
+    _result = [result retain];
+    _lastError = [error copy];
+    _isDone = YES;
+    BxCallback *callback = [_completionCallback retain];
+    [_condition broadcast];
+    [_condition unlock];
+    if (callback) {
+        @try {
+            [callback invokeWith:self];
+        } @catch (id exc) {
+            NSLog(@"Bombaxtic -> Exception in an asynchronous query callback: %@", [exc description]);
+        }
+        [callback release];
+    }
+    [pool release];
+}
+
+- (id)result {
+    [_condition lock];
+    while (! _isDone) {
+        [_condition wait];
+    }
+    [_condition unlock];
+    return _result;
+}
+
+- (BOOL)waitUntilDate:(NSDate *)date {
+    [_condition lock];
+    while (! _isDone && [_condition waitUntilDate:date]) {
+    }
+    BOOL isDone = _isDone;
+    [_condition unlock];
+    return isDone;
+}
+
+- (BxDatabaseQuery *)setCompletionCallback:(SEL)selector
+                                    target:(id)target {
+    BxCallback *callback = [[BxCallback alloc] initWithSelector:selector
+                                                         target:target];
+    [_condition lock];
+    BxCallback *oldCallback = _completionCallback;
+    _completionCallback = callback;
+    BOOL isDone = _isDone;
+    [_condition unlock];
+    [oldCallback release];
+    if (isDone) {
+        [callback invokeWith:self];
+    }
+    return self;
+}
+
+- (BOOL)isDone {
+    [_condition lock];
+    BOOL isDone = _isDone;
+    [_condition unlock];
+    return isDone;
+}
+
+- (NSString *)lastError {
+    [_condition lock];
+    NSString *lastError = [[_lastError retain] autorelease];
+    [_condition unlock];
+    return lastError;
+}
+
+- (void)dealloc {
+    [_sql release];
+    [_values release];
+    [_pool release];
+    [_connection release];
+    [_condition release];
+    [_completionCallback release];
+    [_result release];
+    [_lastError release];
+    [super dealloc];
+}
+
+@end
@@ -0,0 +1,44 @@
+/**
+ \brief Immutable dictionary of a single result row returned by the named fetch methods
+ \class BxDatabaseRow
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+
+ BxDatabaseRow is returned by BxDatabaseStatement's \c fetchDictionary and therefore by
+ BxDatabaseConnection's and BxDatabasePool's \c fetchNamedRow: and \c fetchNamedAll:
+ methods.  It is an \c NSDictionary subclass, so rows are used as before through
+ \c objectForKey:, key-value coding and fast enumeration over the column names.
+
+ All rows of a result set share one table of column names and indexes, which is built
+ when the first row is fetched, instead of each row holding its own copy of every key.
+ A row's values are copied into a single block allocated together with the row, and a
+ text value only becomes an NSString the first time it is accessed, so wide result sets
+ of which only a few columns are read stay cheap.
+
+ \note When several columns have the same name, the value of the last one is returned.
+ Rows may be read from several threads at once.
+
+ Example of reading a row:
+ \code
+ - (id)renderWithTransport:(BxTransport *)transport {
+     NSArray *rows = [_db fetchNamedAll:@"SELECT * FROM cheeses"];
+     for (NSDictionary *cheese in rows) {
+         [transport writeFormat:@"%@ from %@\n",
+                                [cheese objectForKey:@"name"],
+                                [cheese valueForKey:@"country"]];
+     }
+     return self;
+ }
+ \endcode
+
+ */
+
+#import <Cocoa/Cocoa.h>
+
+@interface BxDatabaseRow : NSDictionary {
+    NSArray *_keys; // column names in column order, shared by the result set
+    NSDictionary *_indexes; // column name -> NSNumber index, shared by the result set
+    int _columnCount;
+}
+
+@end
@@ -0,0 +1,124 @@
+#import "BxDatabaseRow.h"
+#import <libkern/OSAtomic.h>
+#import <objc/runtime.h>
+
+@implementation BxDatabaseRow
+
+// values[_columnCount], then text offsets[_columnCount + 1], then the text bytes
+static inline id *_BX_rowValues(BxDatabaseRow *row) {
+    return (id *) object_getIndexedIvars(row);
+}
+
+// objects may be NULL or hold nil for text columns; texts may be NULL or hold NULL for SQL NULLs
++ (BxDatabaseRow *)_rowWithKeys:(NSArray *)keys
+                        indexes:(NSDictionary *)indexes
+                    columnCount:(int)columnCount
+                        objects:(id *)objects
+                          texts:(const char **)texts
+                        lengths:(int *)lengths {
+    NSUInteger textLength = 0;
+    for (int i = 0; i < columnCount; i++) {
+        if ((objects == NULL || objects[i] == nil) && texts != NULL && texts[i] != NULL) {
+            textLength += lengths[i];
+        }
+    }
+    BxDatabaseRow *row = NSAllocateObject(self,
+                                          columnCount * sizeof(id) + (columnCount + 1) * sizeof(unsigned int) + textLength,
+                                          NULL);
+    return [[row _initWithKeys:keys
+                       indexes:indexes
+                   columnCount:columnCount
+                       objects:objects
+                         texts:texts
+                       lengths:lengths] autorelease];
+}
+
+- (id)_initWithKeys:(NSArray *)keys
+            indexes:(NSDictionary *)indexes
+        columnCount:(int)columnCount
+            objects:(id *)objects
+              texts:(const char **)texts
+            lengths:(int *)lengths {
+    [super init];
+    _keys = [keys retain];
+    _indexes = [indexes retain];
+    _columnCount = columnCount;
+    id *values = _BX_rowValues(self);
+    unsigned int *offsets = (unsigned int *) (values + columnCount);
+    char *bytes = (char *) (offsets + columnCount + 1);
+    unsigned int offset = 0;
+    for (int i = 0; i < columnCount; i++) {
+        offsets[i] = offset;
+        if (objects != NULL && objects[i] != nil) {
+            values[i] = [objects[i] retain];
+        } else if (texts == NULL || texts[i] == NULL) {
+            values[i] = [[NSNull null] retain];
+        } else {
+            // left nil until accessed
+            memcpy(&bytes[offset], texts[i], lengths[i]);
+            offset += lengths[i];
+        }
+    }
+    offsets[columnCount] = offset;
+    return self;
+}
+
+- (id)_valueAtColumn:(int)column {
+    id *values = _BX_rowValues(self);
+    id value = values[column];
+    if (value == nil) {
+        unsigned int *offsets = (unsigned int *) (values + _columnCount);
+        char *bytes = (char *) (offsets + _columnCount + 1);
+        value = [[NSString alloc] initWithBytes:&bytes[offsets[column]]
+                                         length:offsets[column + 1] - offsets[column]
+                                       encoding:NSUTF8StringEncoding];
+        if (value == nil) {
+            // not UTF-8, but every byte sequence is valid Latin-1
+            value = [[NSString alloc] initWithBytes:&bytes[offsets[column]]
+                                             length:offsets[column + 1] - offsets[column]
+                                           encoding:NSISOLatin1StringEncoding];
+        }
+        if (! OSAtomicCompareAndSwapPtrBarrier(nil, value, (void * volatile *) &values[column])) {
+            // another thread got there first
+            [value release];
+            value = values[column];
+        }
+    }
+    return value;
+}
+
+- (NSUInteger)count {
+    return [_keys count];
+}
+
+- (id)objectForKey:(id)key {
+    NSNumber *index = [_indexes objectForKey:key];
+    if (index == nil) {
+        return nil;
+    }
+    return [self _valueAtColumn:[index intValue]];
+}
+
+- (NSEnumerator *)keyEnumerator {
+    return [_keys objectEnumerator];
+}
+
+- (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state
+                                  objects:(id *)stackbuf
+                                    count:(NSUInteger)len {
+    return [_keys countByEnumeratingWithState:state
+                                      objects:stackbuf
+                                        count:len];
+}
+
+- (void)dealloc {
+    id *values = _BX_rowValues(self);
+    for (int i = 0; i < _columnCount; i++) {
+        [values[i] release];
+    }
+    [_keys release];
+    [_indexes release];
+    [super dealloc];
+}
+
+@end
@@ -56,20 +56,41 @@
 #import <Cocoa/Cocoa.h>
 
 @class BxDatabaseConnection;
+@class BxDatabasePool;
+@class BxTransport;
+
+enum BxDatabaseStreamFormat_enum {
+    BxDatabaseStreamFormatCSV,
+    BxDatabaseStreamFormatJSON
+} typedef BxDatabaseStreamFormat;
 
 @interface BxDatabaseStatement : NSObject <NSFastEnumeration> {
     BOOL _hasClosed;
     BOOL _hasResetted;
     BOOL _hasMoreRows;
     BOOL _isSelect;
+    BOOL _isCached; // kept by its connection, which it then does not retain
+    BOOL _fetchesTypedValues;
+    BOOL _hasTypedResults; // the fetch mode of the last execute
+    BOOL _streamsResults;
+    BOOL _copiesResults;
     BxDatabaseConnection *_connection;
-    char *_rawBindsBuffer;
-    char *_rawResultsBuffer;
+    BxDatabasePool *_pool; // lent the connection for as long as the statement is open
+    char *_rawBindsBuffer; // MySQL lengths or Oracle indicators of the bound values
+    char *_rawResultsBuffer; // MySQL lengths and flags or Oracle columns, each value in a buffer of its own
     int _rowsLeft;
     int _columnCount;
+    int _resultFormat; // PostgreSQL typed results: -1 until described, then 0 for text or 1 for binary
+    int _currentRow; // PostgreSQL row of _rawResults being read
+    NSUInteger _fetchSize;
     NSMutableArray *_bindNames;
-    NSMutableArray *_bindValues;
+    NSMutableArray *_bindValues; // the bound strings, or their bytes for MySQL and Oracle
     NSString *_statementName;
+    NSString *_sql; // PostgreSQL and MySQL, for cursors and multi-row inserts
+    NSString *_cursorName; // PostgreSQL, while a cursor is open
+    NSMutableArray *_enumeratedRows; // the batch of streamed rows being enumerated
+    NSArray *_rowKeys; // shared by the BxDatabaseRows of the current result set
+    NSDictionary *_rowIndexes;
     void *_rawBinds;
     void *_rawResults;
     void *_rawResultsInfo;
@@ -306,13 +327,59 @@
  */
 - (BOOL)executeWith:(id)binds, ...;
 
+/** \anchor executeBatch
+ \brief Executes the prepared statement once for each row of binds
+ 
+ Each row is either an \c NSArray bound in column order as with \c bindArray: or an
+ \c NSDictionary bound by name as with \c bindDictionary:.  Parameters a row leaves out
+ are bound to NULL.
+ 
+ SQLite executes every row inside one transaction unless one is already open.  PostgreSQL
+ and MySQL send a single row INSERT ... VALUES statement as multi-row INSERTs of up to 500
+ rows each, and if one fails execute its rows again one at a time to find the ones that
+ fail; other statements are executed row by row.  Oracle binds arrays of every parameter
+ and executes up to 500 rows per round trip, with errors reported for each row.
+ 
+ Inside an open transaction each PostgreSQL or MySQL INSERT runs under a savepoint, and a
+ MySQL connection in autocommit mode runs it in a transaction of its own, so that a failed
+ INSERT is rolled back before its rows are tried again and the application's transaction
+ stays usable.  When the rollback is not possible, e.g. on MySQL tables without
+ transactions such as MyISAM, every row of the failed INSERT is reported as failed and
+ none of them are executed again.  Rows are only reported as succeeded once their
+ savepoint has been released or their transaction committed.
+ 
+ Any result sets are discarded and every parameter is bound to NULL afterwards.
+ 
+ Example of importing rows:
+ \code
+ - (id)renderWithTransport:(BxTransport *)transport {
+     BxDatabaseStatement *stmt = [_db prepare:@"INSERT INTO cheeses (name, country) VALUES (?, ?)"];
+     NSArray *rows = [NSArray arrayWithObjects:
+                      [NSArray arrayWithObjects:@"brie", @"France", nil],
+                      [NSArray arrayWithObjects:@"gouda", @"Netherlands", nil],
+                      nil];
+     NSArray *statuses = [stmt executeBatch:rows];
+     if ([statuses containsObject:[NSNumber numberWithBool:NO]]) {
+         [transport writeFormat:@"Import failed: %@", _db.lastError];
+     }
+     return self;
+ }
+ \endcode
+ 
+ \param rows an array of \c NSArray or \c NSDictionary binds
+ \return an array of \c NSNumber booleans, \c YES for each row that succeeded, or \c nil if the statement is closed.  \c lastError is set for failed rows.
+ \since 2.0
+ */
+- (NSArray *)executeBatch:(NSArray *)rows;
+
 /** \anchor fetchArray
  \brief Returns the next row array for a SELECT statement
 
  Each column in the row is included in the same order as it is specified in
  the SELECT or through the natural order of the database in the case of '*'.
  
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
 
  Example of returning array rows:
  \code
@@ -337,9 +404,11 @@
 /** \anchor fetchDictionary
  \brief Returns the next row dictionary for a SELECT statement
  
- Each column is returned using the result set column name.
+ Each column is returned using the result set column name.  The row is an immutable
+ BxDatabaseRow, which shares its column names with the other rows of the result set.
  
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
  
  Example of returning array rows:
  \code
@@ -364,7 +433,8 @@
 /** \anchor fetchValue
  \brief Returns the the first column value in the next row for a SELECT statement
  
- Note: NULL values are returned as [NSNull null].  All other values are NSStrings.
+ Note: NULL values are returned as [NSNull null].  All other values are NSStrings unless
+ \c fetchesTypedValues is set.
  
  Example of returning a single value:
  \code
@@ -424,6 +494,46 @@
                      sql:(NSString *)sql
                     args:(va_list)args;
 
+/** \anchor streamTo
+ \brief Executes the statement and writes its rows to the transport as CSV or JSON
+ 
+ The rows are read through a cursor as with \c streamsResults and encoded from the
+ database's own buffers straight into the transport's output, so that no row or value
+ objects are created and tables of any size are exported with bounded memory.
+ 
+ CSV output starts with a line of column names, separates fields with commas, quotes
+ only fields that contain commas, quotes or line breaks, and ends lines with \c \\n.
+ NULLs are empty fields, while empty strings are written as \c "" as COPY does.  JSON
+ output is an array with an object per row keyed by column name, in which every value is
+ a string or \c null.
+ 
+ If \c copiesResults is set, a PostgreSQL statement without parameters is exported as
+ CSV by the server itself with COPY ... TO STDOUT.
+ 
+ \note The statement is always read as text, whatever \c fetchesTypedValues is set to.
+ The Content-Type header is left to the handler.
+ 
+ Example of exporting a table:
+ \code
+ - (id)renderWithTransport:(BxTransport *)transport {
+     [transport setHeader:@"Content-Type" value:@"text/csv; charset=utf-8"];
+     BxDatabaseStatement *stmt = [_db prepare:@"SELECT name, country FROM cheeses"];
+     if (! [stmt streamTo:transport
+                   format:BxDatabaseStreamFormatCSV]) {
+         [transport write:_db.lastError];
+     }
+     return self;
+ }
+ \endcode
+ 
+ \param transport the transport the rows are written to
+ \param format \c BxDatabaseStreamFormatCSV or \c BxDatabaseStreamFormatJSON
+ \return \c NO if any errors were encountered, in which case the output may be incomplete
+ \since 2.0
+ */
+- (BOOL)streamTo:(BxTransport *)transport
+          format:(BxDatabaseStreamFormat)format;
+
 
 /** \anchor hasMoreRows
  If \c YES there are additional rows available for \c fetchArray, \c fetchDictionary, and
@@ -466,6 +576,101 @@
  */
 @property (nonatomic, readonly) BxDatabaseConnection *connection;
 
+/** \anchor fetchesTypedValues
+ If \c YES, rows are fetched with the column types of the database instead of as NSStrings.
+ Defaults to the connection's \c fetchesTypedValues when the statement is created and
+ takes effect on the next \c execute.
+ 
+ Integer, floating point and boolean columns are returned as NSNumbers, exact decimals as
+ NSDecimalNumbers, binary columns as NSData and dates and timestamps as NSDates.  Dates
+ and timestamps without a time zone are taken to be in the local time zone.  All other
+ columns remain NSStrings and NULL values are still returned as [NSNull null].
+ 
+ \note SQLite columns are typed by the value stored in each row, with text in a column
+ declared as a DATE, DATETIME or TIMESTAMP returned as an NSDate when it is in the
+ "YYYY-MM-DD HH:MM:SS" format.  PostgreSQL results are transferred in binary when every
+ column of the statement has a binary form that can be read directly (e.g. not NUMERIC),
+ and otherwise converted from text.  Oracle NUMBER columns are returned as integers when
+ declared with a scale of 0 and a precision of at most 18 digits and as doubles otherwise.
+ 
+ Example of fetching typed values:
+ \code
+ - (id)renderWithTransport:(BxTransport *)transport {
+     BxDatabaseStatement *stmt = [_db prepare:@"SELECT name, price FROM cheeses"];
+     stmt.fetchesTypedValues = YES;
+     [stmt execute];
+     double total = 0;
+     for (NSArray *cheese in stmt) {
+         total += [[cheese objectAtIndex:1] doubleValue]; // an NSNumber
+     }
+     [transport writeFormat:@"Total: %.2f", total];
+     return self;
+ }
+ \endcode
+ 
+ \since 2.0
+ */
+@property (nonatomic, assign) BOOL fetchesTypedValues;
+
+/** \anchor streamsResults
+ If \c YES, the next \c execute reads a SELECT's rows from the database in batches of
+ \c fetchSize rows as they are fetched instead of all at once, so that result sets of any
+ size are read with bounded memory.  Defaults to \c NO.
+ 
+ PostgreSQL declares the statement as a cursor and reads it with FETCH.  When no transaction
+ is open, the cursor is declared \c WITH \c HOLD, so transactions begun and committed
+ while its rows are read neither close it nor are committed by it; the server then keeps
+ the complete result until the cursor is closed.  A cursor declared inside a transaction
+ ends with that transaction.
+ MySQL opens a read-only server-side cursor, so other statements may run on the connection
+ while rows are read.  Oracle prefetches \c fetchSize rows per round trip.  SQLite always
+ reads one row at a time.
+ 
+ When the statement is enumerated with \c for...in, each batch of rows is released when
+ the next batch is fetched, so rows that are kept beyond their loop iteration must be
+ retained.  A failed fetch ends the loop just like the last row, so a successful
+ \c execute clears the connection's \c lastError and it is only set again if the rows
+ could not all be read.
+ 
+ \note The cursor stays open until all rows are fetched or the statement is closed or
+ executed again.
+ 
+ Example of exporting a large table:
+ \code
+ - (id)renderWithTransport:(BxTransport *)transport {
+     BxDatabaseStatement *stmt = [_db prepare:@"SELECT name, country FROM cheeses"];
+     stmt.streamsResults = YES;
+     [stmt execute];
+     for (NSArray *cheese in stmt) {
+         [transport writeFormat:@"%@,%@\n", [cheese objectAtIndex:0], [cheese objectAtIndex:1]];
+     }
+     if (_db.lastError) {
+         [transport writeFormat:@"Export incomplete: %@\n", _db.lastError];
+     }
+     [stmt close];
+     return self;
+ }
+ \endcode
+ 
+ \since 2.0
+ */
+@property (nonatomic, assign) BOOL streamsResults;
+
+/** \anchor fetchSize
+ The number of rows read from the database at a time when \c streamsResults is set,
+ defaults to 256
+ \since 2.0
+ */
+@property (nonatomic, assign) NSUInteger fetchSize;
+
+/** \anchor copiesResults
+ If \c YES, \c streamTo:format: has PostgreSQL write CSV with COPY ... TO STDOUT when
+ the statement has no parameters.  This is the fastest export, but the SQL must be a
+ query COPY accepts.  Defaults to \c NO.
+ \since 2.0
+ */
+@property (nonatomic, assign) BOOL copiesResults;
+
 /** \anchor rawStatement
  This is the raw prepared statement object backing the instance.  Use of this 
  object is not recommended.
@@ -1,5 +1,8 @@
 #import "BxDatabaseStatement.h"
-#import <Bombaxtic/BxDatabaseConnection.h>
+#import "BxDatabaseConnection_Private.h"
+#import "BxDatabasePool.h"
+#import "BxDatabaseRow.h"
+#import "BxTransport_Private.h"
 #import "sqlite3.h"
 #import "mysql.h"
 #import "libpq-fe.h"
@@ -11,6 +14,674 @@
 @synthesize connection = _connection;
 @synthesize hasMoreRows = _hasMoreRows;
 @synthesize rawStatement = _rawStatement;
+@synthesize fetchesTypedValues = _fetchesTypedValues;
+@synthesize streamsResults = _streamsResults;
+@synthesize fetchSize = _fetchSize;
+@synthesize copiesResults = _copiesResults;
+
+// bind names by SQL text, shared by all connections
+#define BX_BIND_NAMES_CACHE_SIZE 512
+static NSMutableDictionary *_BX_bindNamesCache = nil;
+static NSLock *_BX_bindNamesCacheLock = nil;
+
++ (void)initialize {
+    if (self == [BxDatabaseStatement class]) {
+        _BX_bindNamesCache = [[NSMutableDictionary alloc] initWithCapacity:BX_BIND_NAMES_CACHE_SIZE];
+        _BX_bindNamesCacheLock = [[NSLock alloc] init];
+    }
+}
+
++ (NSArray *)_bindNamesForSQL:(NSString *)sql {
+    [_BX_bindNamesCacheLock lock];
+    NSArray *bindNames = [[_BX_bindNamesCache objectForKey:sql] retain];
+    [_BX_bindNamesCacheLock unlock];
+    if (bindNames) {
+        return [bindNames autorelease];
+    }
+    NSMutableArray *names = [NSMutableArray arrayWithCapacity:8];
+    BOOL isSingleQuoting = NO;
+    BOOL isValue = NO;
+    int valStart = 0;
+    int length = [sql length];
+    for (int i = 0; i < length; i++) {
+        unichar c = [sql characterAtIndex:i];
+        if (isSingleQuoting) {
+            if (c == '\'') {
+                isSingleQuoting = NO;
+            }
+        } else if (isValue) {
+            if (!(isalnum(c) || c == '_')) {
+                [names addObject:[sql substringWithRange:NSMakeRange(valStart, i - valStart)]];
+                isValue = NO;
+                if (c == '\'') {
+                    isSingleQuoting = YES;
+                }
+            }
+        } else if (c == ':' || c == '?' || c == '$') {
+            valStart = i + 1;
+            isValue = YES;
+        } else if (c == '\'') {
+            isSingleQuoting = YES;
+        }
+    }
+    if (isValue) {
+        [names addObject:[sql substringWithRange:NSMakeRange(valStart, length - valStart)]];
+    }
+    bindNames = [NSArray arrayWithArray:names];
+    [_BX_bindNamesCacheLock lock];
+    if ([_BX_bindNamesCache count] >= BX_BIND_NAMES_CACHE_SIZE) {
+        [_BX_bindNamesCache removeAllObjects];
+    }
+    [_BX_bindNamesCache setObject:bindNames
+                           forKey:sql];
+    [_BX_bindNamesCacheLock unlock];
+    return bindNames;
+}
+
+// PostgreSQL type oids from pg_type.h, which is not part of libpq
+#define BX_PG_BOOL_OID 16
+#define BX_PG_BYTEA_OID 17
+#define BX_PG_CHAR_OID 18
+#define BX_PG_NAME_OID 19
+#define BX_PG_INT8_OID 20
+#define BX_PG_INT2_OID 21
+#define BX_PG_INT4_OID 23
+#define BX_PG_TEXT_OID 25
+#define BX_PG_OID_OID 26
+#define BX_PG_FLOAT4_OID 700
+#define BX_PG_FLOAT8_OID 701
+#define BX_PG_BPCHAR_OID 1042
+#define BX_PG_VARCHAR_OID 1043
+#define BX_PG_DATE_OID 1082
+#define BX_PG_TIMESTAMP_OID 1114
+#define BX_PG_TIMESTAMPTZ_OID 1184
+#define BX_PG_NUMERIC_OID 1700
+
+// seconds from 1970-01-01 to 2000-01-01, where PostgreSQL's binary dates start
+#define BX_PG_EPOCH_OFFSET 946684800
+
+// the binary character set, which MySQL reports for BLOB and BINARY columns
+#define BX_MYSQL_BINARY_CHARSET 63
+
+// MySQL string columns are bound to buffers of between these sizes and fetched again when a value is longer
+#define BX_MYSQL_MIN_BUFFER_SIZE 32
+#define BX_MYSQL_MAX_BUFFER_SIZE 4096
+
+// the most bytes a character of the client character set may take
+#define BX_ORACLE_CHARSET_EXPANSION 4
+
+// the most bytes of a LONG or LONG RAW column that are fetched, which have no described size
+#define BX_ORACLE_LONG_SIZE 65535
+
+// executeBatch: sends at most this many rows, and parameters, per round trip
+#define BX_BATCH_MAX_ROWS 500
+#define BX_BATCH_MAX_PARAMETERS 65535
+
+// how executeBatch: makes a failed statement undoable before the rows are retried one at a time
+enum BxBatchScope_enum {
+    BxBatchScopeNone, // PostgreSQL outside a transaction, where a statement is atomic
+    BxBatchScopeSavepoint, // inside the application's transaction
+    BxBatchScopeTransaction, // MySQL in autocommit mode, where MyISAM statements are not atomic
+    BxBatchScopeFailed // the application's transaction has already failed
+} typedef BxBatchScope;
+
+// streamTo:format: writes to the transport whenever this much has been encoded
+#define BX_STREAM_BUFFER_SIZE 16384
+
+// rows are encoded into this by streamTo:format: before they are written
+struct BxStreamBuffer_struct {
+    char *bytes;
+    size_t length;
+    size_t capacity;
+} typedef BxStreamBuffer;
+
+// an Oracle result column, with data allocated to the size described for it
+struct BxOracleColumn_struct {
+    ub2 type; // as defined, not as described
+    ub2 length;
+    sb2 indicator;
+    ub4 size;
+    char *data;
+    OCILobLocator *lob; // CLOB and BLOB columns are read through their locators instead of data
+    char name[128];
+} typedef BxOracleColumn;
+
+// without an offset the fields are a local time
+static NSDate *_BX_dateFromFields(int year, int month, int day, int hour, int minute, double second,
+                                  BOOL hasOffset, long offset) {
+    struct tm tyme;
+    memset(&tyme, 0, sizeof(struct tm));
+    tyme.tm_year = year - 1900;
+    tyme.tm_mon = month - 1;
+    tyme.tm_mday = day;
+    tyme.tm_hour = hour;
+    tyme.tm_min = minute;
+    tyme.tm_sec = (int) second;
+    time_t seconds;
+    if (hasOffset) {
+        seconds = timegm(&tyme) - offset;
+    } else {
+        tyme.tm_isdst = -1;
+        seconds = mktime(&tyme);
+    }
+    return [NSDate dateWithTimeIntervalSince1970:seconds + (second - (int) second)];
+}
+
+// seconds since 1970 of a time without a zone, which is a local time
+static NSDate *_BX_dateFromWallClock(double wallClock) {
+    time_t seconds = (time_t) floor(wallClock);
+    struct tm tyme;
+    gmtime_r(&seconds, &tyme);
+    return _BX_dateFromFields(tyme.tm_year + 1900, tyme.tm_mon + 1, tyme.tm_mday,
+                              tyme.tm_hour, tyme.tm_min, tyme.tm_sec + (wallClock - seconds),
+                              NO, 0);
+}
+
+// "YYYY-MM-DD[ HH:MM:SS[.ffffff]][Z|+HH[:MM]]" as written by SQLite and PostgreSQL, otherwise nil
+static NSDate *_BX_dateFromString(const char *str) {
+    int year, month, day;
+    int hour = 0;
+    int minute = 0;
+    double second = 0;
+    int length = 0;
+    if (sscanf(str, "%4d-%2d-%2d%n", &year, &month, &day, &length) < 3) {
+        return nil;
+    }
+    str += length;
+    if ((*str == ' ' || *str == 'T') &&
+        sscanf(str + 1, "%2d:%2d:%lf%n", &hour, &minute, &second, &length) == 3) {
+        str += length + 1;
+    }
+    BOOL hasOffset = NO;
+    long offset = 0;
+    if (*str == 'Z') {
+        hasOffset = YES;
+        str++;
+    } else if (*str == '+' || *str == '-') {
+        int sign = *str == '-' ? -1 : 1;
+        int offsetHours = 0;
+        int offsetMinutes = 0;
+        if (sscanf(str + 1, "%2d%n", &offsetHours, &length) < 1) {
+            return nil;
+        }
+        str += length + 1;
+        if (*str == ':') {
+            str++;
+        }
+        if (sscanf(str, "%2d%n", &offsetMinutes, &length) == 1) {
+            str += length;
+        }
+        hasOffset = YES;
+        offset = sign * (offsetHours * 3600L + offsetMinutes * 60L);
+    }
+    if (*str != '\0') {
+        return nil;
+    }
+    return _BX_dateFromFields(year, month, day, hour, minute, second, hasOffset, offset);
+}
+
+// binary results are only requested when every column has one of these types
+static BOOL _BX_hasPostgreSQLBinaryFormat(Oid type,
+                                          BOOL hasIntegerTimestamps) {
+    switch (type) {
+        case BX_PG_BOOL_OID:
+        case BX_PG_BYTEA_OID:
+        case BX_PG_CHAR_OID:
+        case BX_PG_NAME_OID:
+        case BX_PG_INT8_OID:
+        case BX_PG_INT2_OID:
+        case BX_PG_INT4_OID:
+        case BX_PG_TEXT_OID:
+        case BX_PG_OID_OID:
+        case BX_PG_FLOAT4_OID:
+        case BX_PG_FLOAT8_OID:
+        case BX_PG_BPCHAR_OID:
+        case BX_PG_VARCHAR_OID:
+        case BX_PG_DATE_OID:
+            return YES;
+            
+        case BX_PG_TIMESTAMP_OID:
+        case BX_PG_TIMESTAMPTZ_OID:
+            return hasIntegerTimestamps;
+            
+        default:
+            return NO;
+    }
+}
+
+// values arrive in network byte order and possibly unaligned
+static id _BX_objectFromPostgreSQLBinary(Oid type,
+                                         const char *data,
+                                         int length) {
+    uint16_t int16;
+    uint32_t int32;
+    uint64_t int64;
+    float real32;
+    double real64;
+    switch (type) {
+        case BX_PG_BOOL_OID:
+            return [NSNumber numberWithBool:data[0] != 0];
+            
+        case BX_PG_INT2_OID:
+            memcpy(&int16, data, 2);
+            return [NSNumber numberWithShort:(short) NSSwapBigShortToHost(int16)];
+            
+        case BX_PG_INT4_OID:
+            memcpy(&int32, data, 4);
+            return [NSNumber numberWithInt:(int) NSSwapBigIntToHost(int32)];
+            
+        case BX_PG_OID_OID:
+            memcpy(&int32, data, 4);
+            return [NSNumber numberWithUnsignedInt:NSSwapBigIntToHost(int32)];
+            
+        case BX_PG_INT8_OID:
+            memcpy(&int64, data, 8);
+            return [NSNumber numberWithLongLong:(long long) NSSwapBigLongLongToHost(int64)];
+            
+        case BX_PG_FLOAT4_OID:
+            memcpy(&int32, data, 4);
+            int32 = NSSwapBigIntToHost(int32);
+            memcpy(&real32, &int32, 4);
+            return [NSNumber numberWithFloat:real32];
+            
+        case BX_PG_FLOAT8_OID:
+            memcpy(&int64, data, 8);
+            int64 = NSSwapBigLongLongToHost(int64);
+            memcpy(&real64, &int64, 8);
+            return [NSNumber numberWithDouble:real64];
+            
+        case BX_PG_DATE_OID:
+            memcpy(&int32, data, 4);
+            return _BX_dateFromWallClock(BX_PG_EPOCH_OFFSET + (int) NSSwapBigIntToHost(int32) * 86400.0);
+            
+        case BX_PG_TIMESTAMP_OID:
+            memcpy(&int64, data, 8);
+            return _BX_dateFromWallClock(BX_PG_EPOCH_OFFSET + (long long) NSSwapBigLongLongToHost(int64) / 1000000.0);
+            
+        case BX_PG_TIMESTAMPTZ_OID:
+            memcpy(&int64, data, 8);
+            return [NSDate dateWithTimeIntervalSince1970:BX_PG_EPOCH_OFFSET + (long long) NSSwapBigLongLongToHost(int64) / 1000000.0];
+            
+        case BX_PG_BYTEA_OID:
+            return [NSData dataWithBytes:data
+                                  length:length];
+            
+        default:
+            return [[[NSString alloc] initWithBytes:data
+                                             length:length
+                                           encoding:NSUTF8StringEncoding] autorelease];
+    }
+}
+
+static id _BX_objectFromPostgreSQLText(Oid type,
+                                       const char *data) {
+    NSDate *date;
+    switch (type) {
+        case BX_PG_BOOL_OID:
+            return [NSNumber numberWithBool:data[0] == 't'];
+            
+        case BX_PG_INT2_OID:
+        case BX_PG_INT4_OID:
+        case BX_PG_INT8_OID:
+            return [NSNumber numberWithLongLong:strtoll(data, NULL, 10)];
+            
+        case BX_PG_OID_OID:
+            return [NSNumber numberWithUnsignedLongLong:strtoull(data, NULL, 10)];
+            
+        case BX_PG_FLOAT4_OID:
+        case BX_PG_FLOAT8_OID:
+            return [NSNumber numberWithDouble:strtod(data, NULL)];
+            
+        case BX_PG_NUMERIC_OID:
+            return [NSDecimalNumber decimalNumberWithString:[NSString stringWithUTF8String:data]];
+            
+        case BX_PG_BYTEA_OID: {
+            size_t length;
+            unsigned char *bytes = PQunescapeBytea((const unsigned char *) data, &length);
+            if (bytes == NULL) {
+                return nil;
+            }
+            NSData *result = [NSData dataWithBytes:bytes
+                                            length:length];
+            PQfreemem(bytes);
+            return result;
+        }
+            
+        case BX_PG_DATE_OID:
+        case BX_PG_TIMESTAMP_OID:
+        case BX_PG_TIMESTAMPTZ_OID:
+            // e.g. 'infinity' stays a string
+            date = _BX_dateFromString(data);
+            if (date != nil) {
+                return date;
+            }
+            return [NSString stringWithUTF8String:data];
+            
+        default:
+            return [NSString stringWithUTF8String:data];
+    }
+}
+
+static enum enum_field_types _BX_typedMySQLBufferType(MYSQL_FIELD *field) {
+    switch (field->type) {
+        case MYSQL_TYPE_TINY:
+        case MYSQL_TYPE_SHORT:
+        case MYSQL_TYPE_INT24:
+        case MYSQL_TYPE_LONG:
+        case MYSQL_TYPE_LONGLONG:
+        case MYSQL_TYPE_YEAR:
+            return MYSQL_TYPE_LONGLONG;
+            
+        case MYSQL_TYPE_FLOAT:
+        case MYSQL_TYPE_DOUBLE:
+            return MYSQL_TYPE_DOUBLE;
+            
+        case MYSQL_TYPE_DATE:
+        case MYSQL_TYPE_DATETIME:
+        case MYSQL_TYPE_TIMESTAMP:
+            return MYSQL_TYPE_DATETIME;
+            
+        case MYSQL_TYPE_DECIMAL:
+        case MYSQL_TYPE_NEWDECIMAL:
+            return MYSQL_TYPE_NEWDECIMAL;
+            
+        case MYSQL_TYPE_TINY_BLOB:
+        case MYSQL_TYPE_MEDIUM_BLOB:
+        case MYSQL_TYPE_LONG_BLOB:
+        case MYSQL_TYPE_BLOB:
+        case MYSQL_TYPE_VAR_STRING:
+        case MYSQL_TYPE_STRING:
+            return field->charsetnr == BX_MYSQL_BINARY_CHARSET ? MYSQL_TYPE_BLOB : MYSQL_TYPE_STRING;
+            
+        default:
+            return MYSQL_TYPE_STRING;
+    }
+}
+
+// the initial size of a MySQL result buffer, from the longest value in the set if stored or else the column width
+static unsigned long _BX_mySQLBufferLength(MYSQL_FIELD *field,
+                                           enum enum_field_types bufferType) {
+    unsigned long length;
+    switch (bufferType) {
+        case MYSQL_TYPE_LONGLONG:
+            return sizeof(long long);
+            
+        case MYSQL_TYPE_DOUBLE:
+            return sizeof(double);
+            
+        case MYSQL_TYPE_DATETIME:
+            return sizeof(MYSQL_TIME);
+            
+        default:
+            if (field == NULL) {
+                return BX_MYSQL_MAX_BUFFER_SIZE;
+            }
+            length = field->max_length > 0 ? field->max_length : field->length;
+            if (length < BX_MYSQL_MIN_BUFFER_SIZE) {
+                return BX_MYSQL_MIN_BUFFER_SIZE;
+            }
+            return length > BX_MYSQL_MAX_BUFFER_SIZE ? BX_MYSQL_MAX_BUFFER_SIZE : length;
+    }
+}
+
+// sets the name, the type to define an Oracle column as and the size of its data
+static void _BX_describeOracleColumn(OCIParam *param,
+                                     OCIError *oraErr,
+                                     BOOL isTyped,
+                                     BxOracleColumn *column) {
+    ub2 dType = 0;
+    ub2 dataSize = 0;
+    sb2 precision = 0;
+    sb1 scale = -1;
+    text *name;
+    ub4 nameLength = 0;
+    ub4 size;
+    OCIAttrGet(param, OCI_DTYPE_PARAM, &dType, NULL, OCI_ATTR_DATA_TYPE, oraErr);
+    OCIAttrGet(param, OCI_DTYPE_PARAM, &dataSize, NULL, OCI_ATTR_DATA_SIZE, oraErr);
+    OCIAttrGet(param, OCI_DTYPE_PARAM, &name, &nameLength, OCI_ATTR_NAME, oraErr);
+    if (nameLength >= sizeof(column->name)) {
+        nameLength = sizeof(column->name) - 1;
+    }
+    memcpy(column->name, name, nameLength);
+    column->name[nameLength] = 0;
+    column->type = SQLT_CHR;
+    switch (dType) {
+        case SQLT_CLOB:
+        case SQLT_BLOB:
+            column->type = dType;
+            column->size = 0;
+            return;
+            
+        case SQLT_NUM:
+            if (isTyped) {
+                OCIAttrGet(param, OCI_DTYPE_PARAM, &precision, NULL, OCI_ATTR_PRECISION, oraErr);
+                OCIAttrGet(param, OCI_DTYPE_PARAM, &scale, NULL, OCI_ATTR_SCALE, oraErr);
+                column->type = scale == 0 && precision > 0 && precision <= 18 ? SQLT_INT : SQLT_BDOUBLE;
+            }
+            break;
+            
+        case SQLT_IBFLOAT:
+        case SQLT_IBDOUBLE:
+            if (isTyped) {
+                column->type = SQLT_BDOUBLE;
+            }
+            break;
+            
+        case SQLT_DAT:
+        case SQLT_TIMESTAMP:
+        case SQLT_TIMESTAMP_TZ:
+        case SQLT_TIMESTAMP_LTZ:
+            if (isTyped) {
+                column->type = SQLT_ODT;
+            }
+            break;
+            
+        case SQLT_BIN:
+        case SQLT_LBI:
+            if (isTyped) {
+                column->type = dType;
+            }
+            break;
+    }
+    switch (column->type) {
+        case SQLT_INT:
+            size = sizeof(long long);
+            break;
+            
+        case SQLT_BDOUBLE:
+            size = sizeof(double);
+            break;
+            
+        case SQLT_ODT:
+            size = sizeof(OCIDate);
+            break;
+            
+        case SQLT_BIN:
+            size = dataSize;
+            break;
+            
+        case SQLT_LBI:
+            size = BX_ORACLE_LONG_SIZE;
+            break;
+            
+        default:
+            if (dType == SQLT_LNG || dType == SQLT_LBI) {
+                size = BX_ORACLE_LONG_SIZE;
+            } else if (dType == SQLT_BIN) {
+                // two hex digits per byte
+                size = dataSize * 2 + 1;
+            } else if (dType == SQLT_CHR || dType == SQLT_AFC || dType == SQLT_VCS || dType == SQLT_AVC) {
+                size = dataSize * BX_ORACLE_CHARSET_EXPANSION + 1;
+            } else {
+                // numbers, dates, intervals and rowids as text
+                size = 64;
+            }
+            break;
+    }
+    // the fetched length is a ub2
+    column->size = size > BX_ORACLE_LONG_SIZE ? BX_ORACLE_LONG_SIZE : (size < 1 ? 1 : size);
+}
+
+// the SQL of a single row INSERT ... VALUES with its values repeated for rowCount rows, or nil if it is any other statement
+static NSString *_BX_multiRowInsertSQL(NSString *sql,
+                                       NSUInteger parameterCount,
+                                       NSUInteger rowCount) {
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    NSString *trimmed = [sql stringByTrimmingCharactersInSet:whitespace];
+    if ([trimmed hasSuffix:@";"]) {
+        trimmed = [[trimmed substringToIndex:[trimmed length] - 1] stringByTrimmingCharactersInSet:whitespace];
+    }
+    if (parameterCount == 0 ||
+        ! [[trimmed uppercaseString] hasPrefix:@"INSERT"] ||
+        ! [trimmed hasSuffix:@")"]) {
+        return nil;
+    }
+    // the parenthesis opening the last value list
+    NSInteger start = -1;
+    int depth = 0;
+    BOOL isSingleQuoting = NO;
+    for (NSInteger i = [trimmed length] - 1; i >= 0 && start < 0; i--) {
+        unichar c = [trimmed characterAtIndex:i];
+        if (c == '\'') {
+            isSingleQuoting = ! isSingleQuoting;
+        } else if (! isSingleQuoting && c == ')') {
+            depth++;
+        } else if (! isSingleQuoting && c == '(') {
+            depth--;
+            if (depth == 0) {
+                start = i;
+            }
+        }
+    }
+    if (start < 0) {
+        return nil;
+    }
+    NSString *head = [[trimmed substringToIndex:start] stringByTrimmingCharactersInSet:whitespace];
+    if (! [[head uppercaseString] hasSuffix:@"VALUES"]) {
+        return nil;
+    }
+    NSString *values = [trimmed substringFromIndex:start];
+    NSUInteger length = [values length];
+    NSMutableString *multiRowSQL = [NSMutableString stringWithCapacity:[head length] + (length + 2) * rowCount];
+    [multiRowSQL appendString:head];
+    [multiRowSQL appendString:@" "];
+    for (NSUInteger row = 0; row < rowCount; row++) {
+        if (row > 0) {
+            [multiRowSQL appendString:@", "];
+        }
+        // PostgreSQL's numbered parameters continue from the previous row's, MySQL's ? stay as they are
+        NSUInteger parameters = 0;
+        NSUInteger copied = 0;
+        isSingleQuoting = NO;
+        for (NSUInteger i = 0; i < length; i++) {
+            unichar c = [values characterAtIndex:i];
+            if (c == '\'') {
+                isSingleQuoting = ! isSingleQuoting;
+            } else if (! isSingleQuoting && c == '?') {
+                parameters++;
+            } else if (! isSingleQuoting && c == '$') {
+                NSUInteger end = i + 1;
+                NSUInteger number = 0;
+                while (end < length && [values characterAtIndex:end] >= '0' && [values characterAtIndex:end] <= '9') {
+                    number = number * 10 + [values characterAtIndex:end] - '0';
+                    end++;
+                }
+                if (end > i + 1) {
+                    [multiRowSQL appendString:[values substringWithRange:NSMakeRange(copied, i - copied)]];
+                    [multiRowSQL appendFormat:@"$%lu", (unsigned long) (number + row * parameterCount)];
+                    copied = end;
+                    i = end - 1;
+                    parameters++;
+                }
+            }
+        }
+        [multiRowSQL appendString:[values substringFromIndex:copied]];
+        if (parameters != parameterCount) {
+            // some parameters are outside the values or used twice
+            return nil;
+        }
+    }
+    return multiRowSQL;
+}
+
+static void _BX_appendBytes(BxStreamBuffer *buffer,
+                            const char *bytes,
+                            size_t length) {
+    if (buffer->length + length > buffer->capacity) {
+        buffer->capacity = MAX(buffer->capacity * 2, buffer->length + length);
+        buffer->bytes = realloc(buffer->bytes, buffer->capacity);
+    }
+    memcpy(&buffer->bytes[buffer->length], bytes, length);
+    buffer->length += length;
+}
+
+// quoted only if it has to be, as PostgreSQL's COPY does
+static void _BX_appendCSVField(BxStreamBuffer *buffer,
+                               const char *text,
+                               size_t length) {
+    // an empty string is quoted so that it differs from NULL, as with COPY
+    BOOL isQuoted = length == 0;
+    for (size_t i = 0; i < length && ! isQuoted; i++) {
+        isQuoted = text[i] == ',' || text[i] == '"' || text[i] == '\n' || text[i] == '\r';
+    }
+    if (! isQuoted) {
+        _BX_appendBytes(buffer, text, length);
+        return;
+    }
+    _BX_appendBytes(buffer, "\"", 1);
+    size_t copied = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '"') {
+            // doubled
+            _BX_appendBytes(buffer, &text[copied], i + 1 - copied);
+            copied = i;
+        }
+    }
+    _BX_appendBytes(buffer, &text[copied], length - copied);
+    _BX_appendBytes(buffer, "\"", 1);
+}
+
+// UTF-8 is passed through, only quotes, backslashes and control characters are escaped
+static void _BX_appendJSONString(BxStreamBuffer *buffer,
+                                 const char *text,
+                                 size_t length) {
+    char escape[8];
+    size_t copied = 0;
+    _BX_appendBytes(buffer, "\"", 1);
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char) text[i];
+        if (c == '"' || c == '\\' || c < 0x20) {
+            _BX_appendBytes(buffer, &text[copied], i - copied);
+            if (c == '"' || c == '\\') {
+                escape[0] = '\\';
+                escape[1] = c;
+                _BX_appendBytes(buffer, escape, 2);
+            } else {
+                snprintf(escape, sizeof(escape), "\\u%04x", c);
+                _BX_appendBytes(buffer, escape, 6);
+            }
+            copied = i + 1;
+        }
+    }
+    _BX_appendBytes(buffer, &text[copied], length - copied);
+    _BX_appendBytes(buffer, "\"", 1);
+}
+
+// upper case hex digits as Oracle converts RAW values to text
+static NSString *_BX_hexStringFromData(NSData *data) {
+    static const char digits[] = "0123456789ABCDEF";
+    const unsigned char *bytes = [data bytes];
+    NSUInteger length = [data length];
+    char *hex = malloc(length * 2 + 1);
+    for (NSUInteger i = 0; i < length; i++) {
+        hex[i * 2] = digits[bytes[i] >> 4];
+        hex[i * 2 + 1] = digits[bytes[i] & 15];
+    }
+    hex[length * 2] = 0;
+    NSString *str = [NSString stringWithUTF8String:hex];
+    free(hex);
+    return str;
+}
 
 
 enum BxDatabaseStatementFetchType_enum {
@@ -77,53 +748,51 @@ enum BxDatabaseStatementFetchType_enum {
         column--;
         MYSQL_BIND *binds = (MYSQL_BIND *) _rawBinds;
         if (value == nil) {
+            [_bindValues replaceObjectAtIndex:column
+                                   withObject:[NSNull null]];
             binds[column].buffer_type = MYSQL_TYPE_NULL;
         } else {
+            // the bytes are kept in _bindValues until the next bind of this column
+            NSData *bytes = [value dataUsingEncoding:NSUTF8StringEncoding];
+            [_bindValues replaceObjectAtIndex:column
+                                   withObject:bytes];
+            unsigned long *lengths = (unsigned long *) _rawBindsBuffer;
+            lengths[column] = [bytes length];
             binds[column].buffer_type = MYSQL_TYPE_STRING;
-            int len = [value length];
-            if (len > 65525) {
-                len = 65525;
-            }
-            strncpy(&(_rawBindsBuffer[65536 * column]), [value UTF8String], len);
-            binds[column].buffer = &(_rawBindsBuffer[65536 * column]);
-            binds[column].buffer_length = len;
-            _rawBindsBuffer[65536 * column + 65526] = 0;
-            binds[column].is_null = &(_rawBindsBuffer[65536 * column + 65526]);
-            *((unsigned long *) &(_rawBindsBuffer[65536 * column + 65528])) = len;
-            binds[column].length = (unsigned long *) &(_rawBindsBuffer[65536 * column + 65528]);
+            binds[column].buffer = (void *) [bytes bytes];
+            binds[column].buffer_length = lengths[column];
+            binds[column].is_null = NULL;
+            binds[column].length = &lengths[column];
         }
     } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
         OCIStmt *stmt = (OCIStmt *) _rawStatement;
         OCIError *oraErr = (OCIError *) [_connection _ociError];
         text errorBuf[512];
         int rc;
-        int len;
+        column--;
+        // the NUL terminated bytes are kept in _bindValues until the next bind of this column
+        NSData *bytes = nil;
         if (value == nil) {
-            len = 0;
+            [_bindValues replaceObjectAtIndex:column
+                                   withObject:[NSNull null]];
         } else {
-            len = [value length];
-            if (len > 65518) {
-                len = 65518;
-            }
+            const char *utf8 = [value UTF8String];
+            bytes = [NSData dataWithBytes:utf8
+                                   length:strlen(utf8) + 1];
+            [_bindValues replaceObjectAtIndex:column
+                                   withObject:bytes];
         }
-        column--;
-        // 0-65529 char* buffer, 65530-65531 indicator, 65532-65533 len, 65534-65535 res
-        if (value != nil) {
-            strncpy(&(_rawBindsBuffer[65536 * column]), [value UTF8String], len);
-            _rawBindsBuffer[65536 * column + len] = 0;
-        }
-        *((sb2 *) &(_rawBindsBuffer[65536 * column + 65530])) = (sb2) (value == nil ? -1 : 0);        
-        *((ub2 *) &(_rawBindsBuffer[65536 * column + 65532])) = (ub2) 0;
-        *((ub2 *) &(_rawBindsBuffer[65536 * column + 65534])) = (ub2) 0;
+        sb2 *indicators = (sb2 *) _rawBindsBuffer;
+        indicators[column] = value == nil ? -1 : 0;
         OCIBind **binds = (OCIBind **) _rawBinds;
         if (rc = OCIBindByPos(stmt,
                               &(binds[column]),
                               oraErr,
                               column + 1,
-                              &(_rawBindsBuffer[65536 * column]),
-                              value == nil ? 0 : [value length] + 1,
+                              (void *) [bytes bytes],
+                              [bytes length],
                               SQLT_STR,
-                              (sb2 *) &(_rawBindsBuffer[65536 * column + 65530]),
+                              &indicators[column],
                               0,
                               0,
                               0,
@@ -148,19 +817,53 @@ enum BxDatabaseStatementFetchType_enum {
     }
 }
 
+// prelocked; the whole value of a CLOB in the client character set or of a BLOB
+- (NSData *)_lobDataForColumn:(BxOracleColumn *)oraColumn {
+    OCISvcCtx *oraSvc = (OCISvcCtx *) _connection.rawConnection;
+    OCIError *oraErr = (OCIError *) [_connection _ociError];
+    oraub8 length = 0;
+    if (OCILobGetLength2(oraSvc, oraErr, oraColumn->lob, &length) != OCI_SUCCESS) {
+        return nil;
+    }
+    // a CLOB's length is in characters
+    oraub8 bufferLength = oraColumn->type == SQLT_CLOB ? length * BX_ORACLE_CHARSET_EXPANSION : length;
+    oraub8 byteAmount = oraColumn->type == SQLT_CLOB ? 0 : length;
+    oraub8 charAmount = oraColumn->type == SQLT_CLOB ? length : 0;
+    NSMutableData *data = [NSMutableData dataWithLength:bufferLength];
+    if (length > 0 && OCILobRead2(oraSvc,
+                                  oraErr,
+                                  oraColumn->lob,
+                                  &byteAmount,
+                                  &charAmount,
+                                  1,
+                                  [data mutableBytes],
+                                  bufferLength,
+                                  OCI_ONE_PIECE,
+                                  NULL,
+                                  NULL,
+                                  0,
+                                  SQLCS_IMPLICIT) != OCI_SUCCESS) {
+        return nil;
+    }
+    [data setLength:byteAmount];
+    return data;
+}
+
 - (NSString *)_convertToStringColumn:(int)column
                                 name:(NSString **)name {
     column--;
-    ub2 dType = *((ub2 *) &(_rawResultsBuffer[column * 65536]));
+    BxOracleColumn *oraColumn = &((BxOracleColumn *) _rawResultsBuffer)[column];
+    ub2 dType = oraColumn->type;
     if (name != nil) {
-        *name = [NSString stringWithUTF8String:(char *) &_rawResultsBuffer[column * 65536 + 2]];
+        *name = [NSString stringWithUTF8String:oraColumn->name];
     }
-    sb2 nullIndicator = *((sb2 *) &(_rawResultsBuffer[column * 65536 + 128]));
-    void *data = &_rawResultsBuffer[column * 65536 + 130];
+    sb2 nullIndicator = oraColumn->indicator;
+    void *data = oraColumn->data;
     if (nullIndicator == -1) {
         return nil;
     }
-    ub2 len = *((ub2 *) &(_rawResultsBuffer[column * 65536 + 126]));
+    ub2 len = oraColumn->length;
+    NSData *lobData;
     struct tm tyme;    
     switch (dType) {
 		case SQLT_UIN:
@@ -205,7 +908,16 @@ enum BxDatabaseStatementFetchType_enum {
 			break;
             
 		case SQLT_CLOB:
+            lobData = [self _lobDataForColumn:oraColumn];
+            return lobData == nil ? nil : [[[NSString alloc] initWithData:lobData
+                                                                 encoding:NSUTF8StringEncoding] autorelease];
+			break;
+            
 		case SQLT_BLOB:
+            lobData = [self _lobDataForColumn:oraColumn];
+            return lobData == nil ? nil : _BX_hexStringFromData(lobData);
+			break;
+            
 		case SQLT_CHR:
 		case SQLT_STR:
 		case SQLT_VST:
@@ -221,6 +933,288 @@ enum BxDatabaseStatementFetchType_enum {
     }            
 }
 
+// prelocked; NSNull for NULL or nil if the value could not be read, column starts at 0
+- (id)_typedValueForColumn:(int)column {
+    if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
+        sqlite3_stmt *stmt = (sqlite3_stmt *) _rawStatement;
+        const void *blob;
+        const char *declType;
+        const char *text;
+        NSDate *date;
+        switch (sqlite3_column_type(stmt, column)) {
+            case SQLITE_NULL:
+                return [NSNull null];
+                
+            case SQLITE_INTEGER:
+                return [NSNumber numberWithLongLong:sqlite3_column_int64(stmt, column)];
+                
+            case SQLITE_FLOAT:
+                return [NSNumber numberWithDouble:sqlite3_column_double(stmt, column)];
+                
+            case SQLITE_BLOB:
+                blob = sqlite3_column_blob(stmt, column);
+                return [NSData dataWithBytes:blob
+                                      length:sqlite3_column_bytes(stmt, column)];
+                
+            default:
+                text = (const char *) sqlite3_column_text(stmt, column);
+                declType = sqlite3_column_decltype(stmt, column);
+                if (declType != NULL && (strcasestr(declType, "DATE") || strcasestr(declType, "TIME"))) {
+                    date = _BX_dateFromString(text);
+                    if (date != nil) {
+                        return date;
+                    }
+                }
+                return [NSString stringWithUTF8String:text];
+        }
+    } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+        PGresult *res = (PGresult *) _rawResults;
+        if (PQgetisnull(res, _currentRow, column)) {
+            return [NSNull null];
+        } else if (PQfformat(res, column) == 1) {
+            return _BX_objectFromPostgreSQLBinary(PQftype(res, column),
+                                                  PQgetvalue(res, _currentRow, column),
+                                                  PQgetlength(res, _currentRow, column));
+        } else {
+            return _BX_objectFromPostgreSQLText(PQftype(res, column),
+                                                PQgetvalue(res, _currentRow, column));
+        }
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
+        MYSQL_BIND *result = &(((MYSQL_BIND *) _rawResults)[column]);
+        if (*(result->is_null)) {
+            return [NSNull null];
+        }
+        long long integer;
+        double real;
+        MYSQL_TIME *tyme;
+        NSString *str;
+        switch (result->buffer_type) {
+            case MYSQL_TYPE_LONGLONG:
+                integer = *((long long *) result->buffer);
+                if (result->is_unsigned) {
+                    return [NSNumber numberWithUnsignedLongLong:(unsigned long long) integer];
+                }
+                return [NSNumber numberWithLongLong:integer];
+                
+            case MYSQL_TYPE_DOUBLE:
+                real = *((double *) result->buffer);
+                return [NSNumber numberWithDouble:real];
+                
+            case MYSQL_TYPE_DATETIME:
+                tyme = (MYSQL_TIME *) result->buffer;
+                if (tyme->year == 0 && tyme->month == 0) {
+                    // MySQL's zero date
+                    return [NSNull null];
+                }
+                return _BX_dateFromFields(tyme->year, tyme->month, tyme->day,
+                                          tyme->hour, tyme->minute, tyme->second + tyme->second_part / 1000000.0,
+                                          NO, 0);
+                
+            case MYSQL_TYPE_BLOB:
+                return [NSData dataWithBytes:result->buffer
+                                      length:*(result->length)];
+                
+            default:
+                str = [[[NSString alloc] initWithBytes:result->buffer
+                                                length:*(result->length)
+                                              encoding:NSUTF8StringEncoding] autorelease];
+                if (str != nil && result->buffer_type == MYSQL_TYPE_NEWDECIMAL) {
+                    return [NSDecimalNumber decimalNumberWithString:str];
+                }
+                return str;
+        }
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
+        BxOracleColumn *oraColumn = &((BxOracleColumn *) _rawResultsBuffer)[column];
+        ub2 dType = oraColumn->type;
+        ub2 len = oraColumn->length;
+        void *data = oraColumn->data;
+        if (oraColumn->indicator == -1) {
+            return [NSNull null];
+        }
+        NSData *lobData;
+        long long integer;
+        double real;
+        sb2 year;
+        ub1 month, day, hour, minute, second;
+        switch (dType) {
+            case SQLT_INT:
+                memcpy(&integer, data, sizeof(long long));
+                return [NSNumber numberWithLongLong:integer];
+                
+            case SQLT_BDOUBLE:
+                memcpy(&real, data, sizeof(double));
+                return [NSNumber numberWithDouble:real];
+                
+            case SQLT_ODT:
+                OCIDateGetDate((OCIDate *) data, &year, &month, &day);
+                OCIDateGetTime((OCIDate *) data, &hour, &minute, &second);
+                return _BX_dateFromFields(year, month, day, hour, minute, second, NO, 0);
+                
+            case SQLT_BIN:
+            case SQLT_LBI:
+                return [NSData dataWithBytes:data
+                                      length:len];
+                
+            case SQLT_BLOB:
+                return [self _lobDataForColumn:oraColumn];
+                
+            case SQLT_CLOB:
+                lobData = [self _lobDataForColumn:oraColumn];
+                return lobData == nil ? nil : [[[NSString alloc] initWithData:lobData
+                                                                     encoding:NSUTF8StringEncoding] autorelease];
+                
+            default:
+                return [[[NSString alloc] initWithBytes:data
+                                                 length:len
+                                               encoding:NSUTF8StringEncoding] autorelease];
+        }
+    }
+    return nil;
+}
+
+// prelocked; column starts at 0
+- (NSString *)_nameForColumn:(int)column {
+    if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
+        const char *name = sqlite3_column_name((sqlite3_stmt *) _rawStatement, column);
+        return name == NULL ? nil : [NSString stringWithUTF8String:name];
+    } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+        return [NSString stringWithUTF8String:PQfname((PGresult *) _rawResults, column)];
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
+        if (_rawResultsInfo == NULL) {
+            _rawResultsInfo = mysql_stmt_result_metadata((MYSQL_STMT *) _rawStatement);
+        }
+        MYSQL_FIELD *field = mysql_fetch_field_direct((MYSQL_RES *) _rawResultsInfo, column);
+        return [NSString stringWithUTF8String:field->name];
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
+        return [NSString stringWithUTF8String:((BxOracleColumn *) _rawResultsBuffer)[column].name];
+    }
+    return nil;
+}
+
+// prelocked; the column table is built once per result set and shared by all of its rows
+- (BxDatabaseRow *)_rowWithObjects:(id *)objects
+                             texts:(const char **)texts
+                           lengths:(int *)lengths
+                             count:(int)count {
+    if (_rowKeys == nil) {
+        NSMutableArray *keys = [NSMutableArray arrayWithCapacity:count];
+        NSMutableDictionary *indexes = [NSMutableDictionary dictionaryWithCapacity:count];
+        for (int i = 0; i < count; i++) {
+            NSString *key = [self _nameForColumn:i];
+            if (key != nil) {
+                if ([indexes objectForKey:key] == nil) {
+                    [keys addObject:key];
+                }
+                [indexes setObject:[NSNumber numberWithInt:i]
+                            forKey:key];
+            }
+        }
+        _rowKeys = [keys copy];
+        _rowIndexes = [indexes copy];
+    }
+    return [BxDatabaseRow _rowWithKeys:_rowKeys
+                               indexes:_rowIndexes
+                           columnCount:count
+                               objects:objects
+                                 texts:texts
+                               lengths:lengths];
+}
+
+// prelocked; reads the current row without moving on to the next
+- (id)_fetchTypedRow:(BxDatabaseStatementFetchType)fetchType {
+    int count = 0;
+    if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
+        count = sqlite3_column_count((sqlite3_stmt *) _rawStatement);
+    } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+        if (_rawResults == NULL || _rowsLeft < 1) {
+            return nil;
+        }
+        _currentRow = PQntuples((PGresult *) _rawResults) - _rowsLeft;
+        _rowsLeft--;
+        count = PQnfields((PGresult *) _rawResults);
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
+        count = mysql_stmt_field_count((MYSQL_STMT *) _rawStatement);
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
+        count = _columnCount;
+    }
+    if (count < 1) {
+        return nil;
+    }
+    id value;
+    if (fetchType == BxDatabaseStatementFetchTypeValue) {
+        value = [self _typedValueForColumn:0];
+        if (value == nil) {
+            _connection.lastError = @"Error fetching results";
+        }
+        return value;
+    } else if (fetchType == BxDatabaseStatementFetchTypeDictionary) {
+        id objects[count];
+        for (int i = 0; i < count; i++) {
+            objects[i] = [self _typedValueForColumn:i];
+            if (objects[i] == nil) {
+                _connection.lastError = @"Error fetching results";
+                return nil;
+            }
+        }
+        return [self _rowWithObjects:objects
+                               texts:NULL
+                             lengths:NULL
+                               count:count];
+    } else { // BxDatabaseStatementFetchTypeArray
+        NSMutableArray *array = [NSMutableArray arrayWithCapacity:count];
+        for (int i = 0; i < count; i++) {
+            value = [self _typedValueForColumn:i];
+            if (value == nil) {
+                _connection.lastError = @"Error fetching results";
+                return nil;
+            }
+            [array addObject:value];
+        }
+        return array;
+    }
+}
+
+// prelocked; moves on to the next row once the current one has been read
+- (void)_advanceRow {
+    if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
+        int code = sqlite3_step((sqlite3_stmt *) _rawStatement);
+        if (code == SQLITE_DONE || code == SQLITE_ROW) {
+            _hasMoreRows = code == SQLITE_ROW;
+        } else {
+            _connection.lastError = [NSString stringWithUTF8String:sqlite3_errmsg((sqlite3 *) _connection.rawConnection)];
+        }
+    } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+        if (_rowsLeft == 0 && _cursorName != nil) {
+            [self _fetchCursorRows];
+        } else {
+            _hasMoreRows = _rowsLeft > 0;
+        }
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
+        MYSQL_STMT *stmt = (MYSQL_STMT *) _rawStatement;
+        int code = [self _fetchMySQLRow];
+        if (code == 0) {
+            _hasMoreRows = YES;
+        } else if (code == MYSQL_NO_DATA) {
+            _hasMoreRows = NO;
+        } else {
+            _hasMoreRows = NO;
+            _connection.lastError = [NSString stringWithUTF8String:mysql_stmt_error(stmt)];
+        }
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
+        int rc = OCIStmtFetch2((OCIStmt *) _rawStatement,
+                               (OCIError *) [_connection _ociError],
+                               1,
+                               OCI_DEFAULT,
+                               0,
+                               OCI_DEFAULT);            
+        if (rc == OCI_SUCCESS || rc == OCI_SUCCESS_WITH_INFO) {
+            _hasMoreRows = YES;
+        } else {
+            _hasMoreRows = NO;
+        }
+    }
+}
+
 - (id)_fetchRow:(BxDatabaseStatementFetchType)fetchType {
     if (! _hasMoreRows) {
         return nil;
@@ -229,7 +1223,9 @@ enum BxDatabaseStatementFetchType_enum {
         [_connection.recursiveLock lock];
     }
     id result = nil;
-    if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
+    if (_hasTypedResults) {
+        result = [self _fetchTypedRow:fetchType];
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
         sqlite3_stmt *stmt = (sqlite3_stmt *) _rawStatement;
         char *cStr;
         if (fetchType == BxDatabaseStatementFetchTypeValue) {
@@ -241,23 +1237,16 @@ enum BxDatabaseStatementFetchType_enum {
             }
         } else if (fetchType == BxDatabaseStatementFetchTypeDictionary) {
             int count = sqlite3_column_count(stmt);
-            NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:count];
+            const char *texts[count + 1];
+            int lengths[count + 1];
             for (int i = 0; i < count; i++) {
-                cStr = (char *) sqlite3_column_name(stmt, i);
-                if (cStr == NULL) {
-                    break;
-                }   
-                NSString *key = [NSString stringWithUTF8String:cStr];
-                cStr = (char *) sqlite3_column_text(stmt, i);
-                if (cStr == NULL) {
-                    [dict setObject:[NSNull null]
-                             forKey:key];
-                } else {
-                    [dict setObject:[NSString stringWithUTF8String:cStr]
-                             forKey:key];
-                }
+                texts[i] = (const char *) sqlite3_column_text(stmt, i);
+                lengths[i] = sqlite3_column_bytes(stmt, i);
             }
-            result = dict;
+            result = [self _rowWithObjects:NULL
+                                     texts:texts
+                                   lengths:lengths
+                                     count:count];
         } else { // BxDatabaseStatementFetchTypeArray
             int count = sqlite3_column_count(stmt);
             NSMutableArray *array = [NSMutableArray arrayWithCapacity:count];
@@ -271,54 +1260,45 @@ enum BxDatabaseStatementFetchType_enum {
             }
             result = array;
         }
-        
-        int code = sqlite3_step(stmt);
-        if (code == SQLITE_DONE || code == SQLITE_ROW) {
-            _hasMoreRows = code == SQLITE_ROW;
-        } else {
-            _connection.lastError = [NSString stringWithUTF8String:sqlite3_errmsg((sqlite3 *) _connection.rawConnection)];
-        }
     } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
         PGresult *res = (PGresult *) _rawResults;
         if (res == NULL || _rowsLeft < 1) {
             result = nil;
         } else {
+            _currentRow = PQntuples(res) - _rowsLeft;
             _rowsLeft--;
             int columns = PQnfields(res);
             if (columns < 0) {
                 result = nil;
             } else if (fetchType == BxDatabaseStatementFetchTypeValue) {
-                if (PQgetisnull(res, _rowsLeft, 0)) {
+                if (PQgetisnull(res, _currentRow, 0)) {
                     result = [NSNull null];
                 } else {
-                    result = [NSString stringWithUTF8String:PQgetvalue(res, _rowsLeft, 0)];
+                    result = [NSString stringWithUTF8String:PQgetvalue(res, _currentRow, 0)];
                 }
             } else if (fetchType == BxDatabaseStatementFetchTypeDictionary) {
-                NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:columns];
+                const char *texts[columns + 1];
+                int lengths[columns + 1];
                 for (int i = 0; i < columns; i++) {
-                    NSString *key = [NSString stringWithUTF8String:PQfname(res, i)];
-                    if (PQgetisnull(res, _rowsLeft, i)) {
-                        [dict setObject:[NSNull null]
-                                 forKey:key];
-                    } else {
-                        [dict setObject:[NSString stringWithUTF8String:PQgetvalue(res, _rowsLeft, i)]
-                                 forKey:key];
-                    }
+                    texts[i] = PQgetisnull(res, _currentRow, i) ? NULL : PQgetvalue(res, _currentRow, i);
+                    lengths[i] = PQgetlength(res, _currentRow, i);
                 }
-                result = dict;
+                result = [self _rowWithObjects:NULL
+                                         texts:texts
+                                       lengths:lengths
+                                         count:columns];
             } else { // BxDatabaseStatementFetchTypeArray
                 NSMutableArray *array = [NSMutableArray arrayWithCapacity:columns];
                 for (int i = 0; i < columns; i++) {
-                    if (PQgetisnull(res, _rowsLeft, i)) {
+                    if (PQgetisnull(res, _currentRow, i)) {
                         [array addObject:[NSNull null]];
                     } else {
-                        [array addObject:[NSString stringWithUTF8String:PQgetvalue(res, _rowsLeft, i)]];
+                        [array addObject:[NSString stringWithUTF8String:PQgetvalue(res, _currentRow, i)]];
                     }
                 }
                 result = array;
             }
         }            
-        _hasMoreRows = _rowsLeft > 0;
     } else if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
         MYSQL_STMT *stmt = (MYSQL_STMT *) _rawStatement;
         MYSQL_BIND *results = (MYSQL_BIND *) _rawResults;
@@ -334,34 +1314,16 @@ enum BxDatabaseStatementFetchType_enum {
                 }
             }
         } else if (fetchType == BxDatabaseStatementFetchTypeDictionary) {
-            MYSQL_RES *info;
-            if (_rawResultsInfo == NULL) {
-                info = mysql_stmt_result_metadata(stmt);
-                _rawResultsInfo = info;
-            } else {
-                info = (MYSQL_RES *) _rawResultsInfo;
-            }
-            NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:count];
+            const char *texts[count + 1];
+            int lengths[count + 1];
             for (int i = 0; i < count; i++) {
-                MYSQL_FIELD *field = mysql_fetch_field_direct(info, i);
-                NSString *key = [NSString stringWithUTF8String:field->name];
-                if (*(results[i].is_null)) {
-                    [dict setObject:[NSNull null]
-                             forKey:key];
-                } else {
-                    NSString *str = [[[NSString alloc] initWithBytes:results[i].buffer
-                                                              length:*(results[i].length)
-                                                            encoding:NSUTF8StringEncoding] autorelease];
-                    if (str == nil) {
-                        dict = nil;
-                        break;
-                    } else {                        
-                        [dict setObject:str
-                                 forKey:key];
-                    }
-                }
+                texts[i] = *(results[i].is_null) ? NULL : (const char *) results[i].buffer;
+                lengths[i] = (int) *(results[i].length);
             }
-            result = dict;
+            result = [self _rowWithObjects:NULL
+                                     texts:texts
+                                   lengths:lengths
+                                     count:count];
         } else { // BxDatabaseStatementFetchTypeArray
             NSMutableArray *array = [NSMutableArray arrayWithCapacity:count];
             for (int i = 0; i < count; i++) {
@@ -382,20 +1344,7 @@ enum BxDatabaseStatementFetchType_enum {
             }
             result = array;
         }
-        
-        int code = mysql_stmt_fetch(stmt);
-        if (code == 0) {
-            _hasMoreRows = YES;
-        } else if (code == MYSQL_NO_DATA) {
-            _hasMoreRows = NO;
-        } else {
-            _hasMoreRows = NO;
-            _connection.lastError = [NSString stringWithUTF8String:mysql_stmt_error(stmt)];
-        }
     } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
-        OCIStmt *stmt = (OCIStmt *) _rawStatement;
-        OCIError *oraErr = (OCIError *) [_connection _ociError];
-        
         NSString *strResult;
         if (fetchType == BxDatabaseStatementFetchTypeValue) {
             NSString *name = nil;
@@ -412,26 +1361,28 @@ enum BxDatabaseStatementFetchType_enum {
                 result = strResult;
             }
         } else if (fetchType == BxDatabaseStatementFetchTypeDictionary) {
-            NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:_columnCount];
+            // every column but the LOBs is defined as SQLT_CHR when fetching strings
+            BxOracleColumn *oraColumns = (BxOracleColumn *) _rawResultsBuffer;
+            id objects[_columnCount + 1];
+            const char *texts[_columnCount + 1];
+            int lengths[_columnCount + 1];
             for (int i = 0; i < _columnCount; i++) {
-                NSString *key = nil;
-                strResult = [self _convertToStringColumn:i + 1
-                                                    name:&key];
-                if (strResult == nil) {
-                    if (key == nil) {
+                objects[i] = nil;
+                texts[i] = oraColumns[i].indicator == -1 ? NULL : oraColumns[i].data;
+                lengths[i] = oraColumns[i].length;
+                if (oraColumns[i].indicator != -1 && oraColumns[i].lob != NULL) {
+                    objects[i] = [self _convertToStringColumn:i + 1
+                                                         name:NULL];
+                    if (objects[i] == nil) {
                         _connection.lastError = @"Error fetching results";
-                        dict = nil;
-                        break;
-                    } else {
-                        [dict setObject:[NSNull null]
-                                 forKey:key];
+                        objects[i] = [NSNull null];
                     }
-                } else {
-                    [dict setObject:strResult
-                             forKey:key];
                 }
             }
-            result = dict;
+            result = [self _rowWithObjects:objects
+                                     texts:texts
+                                   lengths:lengths
+                                     count:_columnCount];
         } else { // BxDatabaseStatementFetchTypeArray
             NSMutableArray *array = [NSMutableArray arrayWithCapacity:_columnCount];
             for (int i = 0; i < _columnCount; i++) {
@@ -452,22 +1403,8 @@ enum BxDatabaseStatementFetchType_enum {
             }
             result = array;
         }
-        
-        for (int i = 0; i < _columnCount; i++) {
-            memset(&_rawResultsBuffer[i * 65536 + 130], 0, 256);
-        }
-        int rc = OCIStmtFetch2(stmt,
-                               oraErr,
-                               1,
-                               OCI_DEFAULT,
-                               0,
-                               OCI_DEFAULT);            
-        if (rc == OCI_SUCCESS || rc == OCI_SUCCESS_WITH_INFO) {
-            _hasMoreRows = YES;
-        } else {
-            _hasMoreRows = NO;
-        }
     }
+    [self _advanceRow];
     if (_connection.isLocking) {
         [_connection.recursiveLock unlock];
     }
@@ -598,6 +1535,65 @@ enum BxDatabaseStatementFetchType_enum {
     return result;
 }
 
+// the connection keeps the statement from now on, so the statement must not keep the connection
+- (void)_setCached {
+    if (! _isCached) {
+        _isCached = YES;
+        [_connection release];
+    }
+}
+
+// prelocked; lets go of any unfetched rows and locks held since the last execute
+- (BOOL)_reset {
+    if (_hasClosed) {
+        return NO;
+    }
+    _hasMoreRows = NO;
+    if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
+        if (! _hasResetted) {
+            sqlite3_reset((sqlite3_stmt *) _rawStatement);
+            _hasResetted = YES;
+        }
+    } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+        [self _closeCursor];
+        if (_rawResults) {
+            PQclear((PGresult *) _rawResults);
+            _rawResults = NULL;
+        }
+        _rowsLeft = 0;
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
+        mysql_stmt_free_result((MYSQL_STMT *) _rawStatement);
+    }
+    return YES;
+}
+
+// prelocked; binds a nil-terminated list of values and NULL for every parameter after it
+- (BOOL)_rebindArgs:(va_list)args {
+    BOOL result = YES;
+    BOOL isEnd = NO;
+    for (int i = 0; i < [_bindValues count]; i++) {
+        NSString *obj = nil;
+        if (! isEnd) {
+            obj = va_arg(args, NSString *);
+            isEnd = obj == nil;
+        }
+        if (! [self _prelockedBindValue:obj
+                              forColumn:i + 1]) {
+            result = NO;
+        }
+    }
+    return result;
+}
+
+- (void)setFetchSize:(NSUInteger)fetchSize {
+    _fetchSize = fetchSize > 0 ? fetchSize : 1;
+}
+
+- (void)_setPool:(BxDatabasePool *)pool {
+    [_pool release];
+    _pool = [pool retain];
+}
+
 - (BOOL)close {
     if (! _hasClosed) {
         if (_connection.isLocking) {
@@ -610,28 +1606,26 @@ enum BxDatabaseStatementFetchType_enum {
                 _connection.lastError = [NSString stringWithUTF8String:sqlite3_errmsg(conn)];
             }
         } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+            [self _closeCursor];
             if (_rawResults) {
                 PQclear(_rawResults);
             }
             [_statementName release];
+            [_sql release];
         } else if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
             MYSQL_STMT *stmt = (MYSQL_STMT *) _rawStatement;
             mysql_stmt_close(stmt);
             if (_rawBinds) {
                 free(_rawBinds);
             }
-            if (_rawResults) {
-                free(_rawResults);
-            }
-            if (_rawResultsBuffer) {
-                free(_rawResultsBuffer);
-            }
+            [self _unbindResults];
             if (_rawBindsBuffer) {
                 free(_rawBindsBuffer);
             }
             if (_rawResultsInfo) {
                 mysql_free_result((MYSQL_RES *) _rawResultsInfo);
             }
+            [_sql release];
         } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
             OCIStmt *stmt = (OCIStmt *) _rawStatement;
             OCIError *oraErr = (OCIError *) [_connection _ociError];
@@ -653,18 +1647,27 @@ enum BxDatabaseStatementFetchType_enum {
                 }
                 free(_rawResults);
             }
-            if (_rawResultsBuffer) {
-                free(_rawResultsBuffer);
-            }
+            [self _unbindResults];
             if (_rawBindsBuffer) {
                 free(_rawBindsBuffer);
             }
             OCIStmtRelease(stmt, oraErr, NULL, 0, OCI_DEFAULT);
             OCIHandleFree(stmt, OCI_HTYPE_STMT);
         }
-        [_connection release];
+        [_pool checkinConnection:_connection];
+        [_pool release];
+        _pool = nil;
+        if (! _isCached) {
+            [_connection release];
+        }
         [_bindNames release];
         [_bindValues release];
+        [_rowKeys release];
+        _rowKeys = nil;
+        [_rowIndexes release];
+        _rowIndexes = nil;
+        [_enumeratedRows release];
+        _enumeratedRows = nil;
         _hasClosed = YES;
         if (_connection.isLocking) {
             [_connection.recursiveLock unlock];
@@ -678,8 +1681,24 @@ enum BxDatabaseStatementFetchType_enum {
                                     count:(NSUInteger)len {
     int count = 0;
     NSArray *row = nil;
-    for (count = 0; count < len && (row = [self fetchArray]) != nil; count++) {
-        stackbuf[count] = row;
+    if (_streamsResults) {
+        // each batch lives until the next one is fetched, so memory stays bounded however many rows there are
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        NSMutableArray *rows = [[NSMutableArray alloc] initWithCapacity:len];
+        while ([rows count] < len && (row = [self fetchArray]) != nil) {
+            [rows addObject:row];
+        }
+        [pool release];
+        [_enumeratedRows release];
+        _enumeratedRows = rows;
+        for (count = 0; count < [rows count]; count++) {
+            stackbuf[count] = [rows objectAtIndex:count];
+        }
+        row = [rows lastObject];
+    } else {
+        for (count = 0; count < len && (row = [self fetchArray]) != nil; count++) {
+            stackbuf[count] = row;
+        }
     }
     state->state = (unsigned long) row;
     state->itemsPtr = stackbuf;
@@ -688,6 +1707,136 @@ enum BxDatabaseStatementFetchType_enum {
     return count;
 }
 
+// prelocked; never ends a transaction, whoever began it
+- (void)_closeCursor {
+    if (_cursorName == nil) {
+        return;
+    }
+    PGconn *conn = (PGconn *) _connection.rawConnection;
+    PGresult *res = PQexec(conn, [[NSString stringWithFormat:@"CLOSE %@", _cursorName] UTF8String]);
+    PQclear(res);
+    [_cursorName release];
+    _cursorName = nil;
+}
+
+// prelocked; replaces the current results with the next fetchSize rows of the cursor
+- (BOOL)_fetchCursorRows {
+    PGconn *conn = (PGconn *) _connection.rawConnection;
+    if (_rawResults != NULL) {
+        PQclear((PGresult *) _rawResults);
+        _rawResults = NULL;
+    }
+    NSString *fetch = [NSString stringWithFormat:@"FETCH FORWARD %lu FROM %@", (unsigned long) _fetchSize, _cursorName];
+    PGresult *res = PQexecParams(conn,
+                                 [fetch UTF8String],
+                                 0,
+                                 NULL,
+                                 NULL,
+                                 NULL,
+                                 NULL,
+                                 _hasTypedResults ? _resultFormat : 0);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        PQclear(res);
+        _connection.lastError = [NSString stringWithUTF8String:PQerrorMessage(conn)];
+        [self _closeCursor];
+        _rowsLeft = 0;
+        _hasMoreRows = NO;
+        return NO;
+    }
+    _rawResults = (void *) res;
+    _rowsLeft = PQntuples(res);
+    _hasMoreRows = _rowsLeft > 0;
+    if ((NSUInteger) _rowsLeft < _fetchSize) {
+        // the last rows are already here
+        [self _closeCursor];
+    }
+    return YES;
+}
+
+// prelocked; declares the statement's SQL as a cursor, which outlives transactions
+// begun and committed while it is read if none was open when it was declared
+- (BOOL)_openCursorWithValues:(char **)values
+                      lengths:(int *)lengths
+                      formats:(int *)formats {
+    PGconn *conn = (PGconn *) _connection.rawConnection;
+    // outside a transaction, DECLARE commits at once and WITH HOLD keeps the cursor readable
+    const char *hold = PQtransactionStatus(conn) == PQTRANS_IDLE ? "WITH HOLD " : "";
+    _cursorName = [[NSString alloc] initWithFormat:@"bx_cursor_%lx", (unsigned long) self];
+    NSString *declare = [NSString stringWithFormat:@"DECLARE %@ NO SCROLL CURSOR %sFOR %@", _cursorName, hold, _sql];
+    PGresult *res = PQexecParams(conn,
+                       [declare UTF8String],
+                       [_bindValues count],
+                       NULL,
+                       (const char **) values,
+                       lengths,
+                       formats,
+                       0);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        PQclear(res);
+        _connection.lastError = [NSString stringWithUTF8String:PQerrorMessage(conn)];
+        [_cursorName release];
+        _cursorName = nil;
+        return NO;
+    }
+    PQclear(res);
+    return [self _fetchCursorRows];
+}
+
+// prelocked; MySQL and Oracle results are bound to buffers by type, so changing modes binds them again
+- (void)_unbindResults {
+    if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
+        if (_rawResults) {
+            MYSQL_BIND *results = (MYSQL_BIND *) _rawResults;
+            for (int i = 0; i < _columnCount; i++) {
+                free(results[i].buffer);
+            }
+            free(_rawResults);
+            _rawResults = NULL;
+        }
+        if (_rawResultsBuffer) {
+            free(_rawResultsBuffer);
+            _rawResultsBuffer = NULL;
+        }
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
+        // the defines are kept and redefined in place
+        if (_rawResultsBuffer) {
+            BxOracleColumn *oraColumns = (BxOracleColumn *) _rawResultsBuffer;
+            for (int i = 0; i < _columnCount; i++) {
+                free(oraColumns[i].data);
+                if (oraColumns[i].lob != NULL) {
+                    OCIDescriptorFree(oraColumns[i].lob, OCI_DTYPE_LOB);
+                }
+            }
+            free(_rawResultsBuffer);
+            _rawResultsBuffer = NULL;
+        }
+    }
+}
+
+// prelocked; 0, MYSQL_NO_DATA or 1 on error, fetching values too long for their buffers again into bigger ones
+- (int)_fetchMySQLRow {
+    MYSQL_STMT *stmt = (MYSQL_STMT *) _rawStatement;
+    MYSQL_BIND *results = (MYSQL_BIND *) _rawResults;
+    int code = mysql_stmt_fetch(stmt);
+    if (code == MYSQL_DATA_TRUNCATED) {
+        code = 0;
+        for (int i = 0; i < _columnCount && code == 0; i++) {
+            if (*(results[i].error) && *(results[i].length) > results[i].buffer_length) {
+                results[i].buffer_length = *(results[i].length);
+                results[i].buffer = realloc(results[i].buffer, results[i].buffer_length);
+                if (mysql_stmt_fetch_column(stmt, &results[i], i, 0) != 0) {
+                    code = 1;
+                }
+            }
+        }
+        // the statement keeps its own copy of the bindings
+        if (code == 0 && mysql_stmt_bind_result(stmt, results) != 0) {
+            code = 1;
+        }
+    }
+    return code;
+}
+
 - (BOOL)execute {
     if (_hasClosed) {
         return NO;
@@ -697,6 +1846,14 @@ enum BxDatabaseStatementFetchType_enum {
     }
     _hasMoreRows = NO;
     BOOL result = YES;
+    [_rowKeys release];
+    _rowKeys = nil;
+    [_rowIndexes release];
+    _rowIndexes = nil;
+    if (_hasTypedResults != _fetchesTypedValues) {
+        [self _unbindResults];
+        _hasTypedResults = _fetchesTypedValues;
+    }
     if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
         sqlite3_stmt *stmt = (sqlite3_stmt *) _rawStatement;
         int code = sqlite3_step(stmt);
@@ -727,32 +1884,53 @@ enum BxDatabaseStatementFetchType_enum {
             }
         }
         PGresult *res;
+        [self _closeCursor];
         if (_rawResults != NULL) {
             res = (PGresult *) _rawResults;
             PQclear(res);
             res = NULL;
+            _rawResults = NULL;
+        }
+        _rowsLeft = 0;
+        if (_hasTypedResults && _resultFormat < 0) {
+            const char *integerDatetimes = PQparameterStatus(conn, "integer_datetimes");
+            BOOL hasIntegerTimestamps = integerDatetimes != NULL && strcmp(integerDatetimes, "on") == 0;
+            res = PQdescribePrepared(conn, [_statementName UTF8String]);
+            _resultFormat = PQresultStatus(res) == PGRES_COMMAND_OK ? 1 : 0;
+            for (int i = 0; _resultFormat == 1 && i < PQnfields(res); i++) {
+                if (! _BX_hasPostgreSQLBinaryFormat(PQftype(res, i), hasIntegerTimestamps)) {
+                    _resultFormat = 0;
+                }
+            }
+            PQclear(res);
+        }
+        if (_streamsResults && _isSelect) {
+            result = [self _openCursorWithValues:values
+                                         lengths:lengths
+                                         formats:formats];
+        } else {
+            res = PQexecPrepared(conn,
+                                 (char *) [_statementName UTF8String],
+                                 [_bindValues count],
+                                 (const char **) values,
+                                 lengths,
+                                 formats,
+                                 _hasTypedResults ? _resultFormat : 0);
+            ExecStatusType status = PQresultStatus(res);
+            if (status == PGRES_TUPLES_OK || status == PGRES_COMMAND_OK) {
+                _rowsLeft = PQntuples(res);
+                _rawResults = (void *) res;
+                _hasMoreRows = _rowsLeft > 0;
+            } else {
+                PQclear(res);
+                _connection.lastError = [NSString stringWithUTF8String:PQerrorMessage(conn)];
+                _hasMoreRows = NO;
+                result = NO;
+            }
         }
-        res = PQexecPrepared(conn,
-                             (char *) [_statementName UTF8String],
-                             [_bindValues count],
-                             (const char **) values,
-                             lengths,
-                             formats,
-                             0);
         free(values);
         free(formats);
         free(lengths);
-        ExecStatusType status = PQresultStatus(res);
-        if (status == PGRES_TUPLES_OK || status == PGRES_COMMAND_OK) {
-            _rowsLeft = PQntuples(res);
-            _rawResults = (void *) res;
-            _hasMoreRows = _rowsLeft > 0;
-        } else {
-            PQclear(res);
-            _connection.lastError = [NSString stringWithUTF8String:PQerrorMessage(conn)];
-            _hasMoreRows = NO;
-            result = NO;
-        }
     } else if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
         MYSQL_STMT *stmt = (MYSQL_STMT *) _rawStatement;
         if ([_bindNames count] > 0) {
@@ -762,6 +1940,13 @@ enum BxDatabaseStatementFetchType_enum {
                 result = NO;
             }
         }
+        // a read-only cursor keeps the rows on the server until they are fetched
+        unsigned long cursorType = _streamsResults ? CURSOR_TYPE_READ_ONLY : CURSOR_TYPE_NO_CURSOR;
+        mysql_stmt_attr_set(stmt, STMT_ATTR_CURSOR_TYPE, &cursorType);
+        if (_streamsResults) {
+            unsigned long prefetchRows = _fetchSize;
+            mysql_stmt_attr_set(stmt, STMT_ATTR_PREFETCH_ROWS, &prefetchRows);
+        }
         if (result == YES && mysql_stmt_execute(stmt) != 0) {
             _connection.lastError = [NSString stringWithUTF8String:mysql_stmt_error(stmt)];
             result = NO;
@@ -771,24 +1956,39 @@ enum BxDatabaseStatementFetchType_enum {
                 if (_rawResults == NULL) {
                     MYSQL_BIND *results = calloc(count, sizeof(MYSQL_BIND));
                     _rawResults = results;
-                    _rawResultsBuffer = calloc(count, 65536);
+                    _columnCount = count;
+                    // lengths, then NULL flags, then truncation flags
+                    _rawResultsBuffer = calloc(count, sizeof(unsigned long) + 2 * sizeof(my_bool));
+                    unsigned long *lengths = (unsigned long *) _rawResultsBuffer;
+                    my_bool *nulls = (my_bool *) (lengths + count);
+                    my_bool *errors = nulls + count;
+                    if (_rawResultsInfo == NULL) {
+                        _rawResultsInfo = mysql_stmt_result_metadata(stmt);
+                    }
                     for (int i = 0; i < count; i++) {
-                        results[i].buffer_type = MYSQL_TYPE_STRING;
-                        results[i].buffer = &(_rawResultsBuffer[i * 65536]);
-                        results[i].buffer_length = 65525;
-                        _rawResultsBuffer[65536 * i + 65526] = 0;
-                        results[i].is_null = &(_rawResultsBuffer[65536 * i + 65526]);
-                        *((unsigned long *) &(_rawResultsBuffer[65536 * i + 65528])) = 0;
-                        results[i].length = (unsigned long *) &(_rawResultsBuffer[65536 * i + 65528]);
+                        MYSQL_FIELD *field = NULL;
+                        if (_rawResultsInfo != NULL) {
+                            field = mysql_fetch_field_direct((MYSQL_RES *) _rawResultsInfo, i);
+                        }
+                        if (_hasTypedResults && field != NULL) {
+                            results[i].buffer_type = _BX_typedMySQLBufferType(field);
+                            results[i].is_unsigned = (field->flags & UNSIGNED_FLAG) != 0;
+                        } else {
+                            results[i].buffer_type = MYSQL_TYPE_STRING;
+                        }
+                        results[i].buffer_length = _BX_mySQLBufferLength(field, results[i].buffer_type);
+                        results[i].buffer = malloc(results[i].buffer_length);
+                        results[i].is_null = &nulls[i];
+                        results[i].length = &lengths[i];
+                        results[i].error = &errors[i];
                     }
                     if (mysql_stmt_bind_result(stmt, results) != 0) {
                         _connection.lastError = [NSString stringWithUTF8String:mysql_stmt_error(stmt)];
                         result = NO;
-                        free(results);
-                        _rawResults = NULL;
+                        [self _unbindResults];
                     }
                 }
-                int code = mysql_stmt_fetch(stmt);
+                int code = result ? [self _fetchMySQLRow] : 1;
                 if (code == 0) {
                     _hasMoreRows = YES;
                 } else if (code == MYSQL_NO_DATA) {
@@ -809,6 +2009,8 @@ enum BxDatabaseStatementFetchType_enum {
         
         text errorBuf[512];
         int rc;
+        ub4 prefetchRows = _streamsResults ? _fetchSize : 1;
+        OCIAttrSet(stmt, OCI_HTYPE_STMT, &prefetchRows, 0, OCI_ATTR_PREFETCH_ROWS, oraErr);
         if (rc = OCIStmtExecute(oraSvc,
                                 stmt,
                                 oraErr,
@@ -826,54 +2028,47 @@ enum BxDatabaseStatementFetchType_enum {
             _columnCount = count;
             if (count > 0) {
                 if (_rawResultsBuffer == NULL) {
-
-                    _rawResultsBuffer = calloc(count, 65536); // 0 - 1 type, 2 - 127 name, 128 - 129 ind, 130 - 65535 data
+                    BxOracleColumn *oraColumns = calloc(count, sizeof(BxOracleColumn));
+                    _rawResultsBuffer = (char *) oraColumns;
+                    OCIEnv *oraEnv = (OCIEnv *) [_connection _ociEnv];
                     OCIParam *param;
-                    _rawResults = calloc(count + 1, sizeof(OCIDefine *));
+                    if (_rawResults == NULL) {
+                        _rawResults = calloc(count + 1, sizeof(OCIDefine *));
+                    }
                     OCIDefine **defines = (OCIDefine **) _rawResults;
                     
                     for (int i = 1; i <= count; i++) {
                         OCIParamGet(stmt, OCI_HTYPE_STMT, oraErr, (void **) &param, i);
-                        ub2 dType;
                         int index = i - 1;
-//                        OCIAttrGet(param,
-//                                   OCI_DTYPE_PARAM,
-//                                   &dType,
-//                                   NULL,
-//                                   OCI_ATTR_DATA_TYPE,
-//                                   oraErr);
-                        dType = SQLT_CHR;
-                        *((ub2 *) &(_rawResultsBuffer[index * 65536])) = dType;
-                        text *name;
-                        ub4 len;
-                        OCIAttrGet(param,
-                                   OCI_DTYPE_PARAM,
-                                   &name,
-                                   &len,
-                                   OCI_ATTR_NAME, //OCI_ATTR_NAME,
-                                   oraErr);
-                        // tbd free name?
-                        strncpy(&(_rawResultsBuffer[65536 * index + 2]), name, len);
-                        
-                        _rawResultsBuffer[index * 65536 + 2 + len] = 0;
-                        _rawResultsBuffer[index * 65536 + 125] = 0;
-                        text errorBuf[512];
-                        
+                        BxOracleColumn *oraColumn = &oraColumns[index];
+                        _BX_describeOracleColumn(param, oraErr, _hasTypedResults, oraColumn);
+                        OCIDescriptorFree(param, OCI_DTYPE_PARAM);
+                        void *value;
+                        sb4 valueSize;
+                        if (oraColumn->type == SQLT_CLOB || oraColumn->type == SQLT_BLOB) {
+                            // fetched as locators and read on demand
+                            OCIDescriptorAlloc(oraEnv, (void **) &oraColumn->lob, OCI_DTYPE_LOB, 0, NULL);
+                            value = &oraColumn->lob;
+                            valueSize = -1;
+                        } else {
+                            oraColumn->data = malloc(oraColumn->size);
+                            value = oraColumn->data;
+                            valueSize = oraColumn->size;
+                        }
                         if (OCIDefineByPos(stmt,
                                            &(defines[index]),
                                            oraErr,
                                            i,
-                                           &_rawResultsBuffer[index * 65536 + 130],
-                                           65405,
-                                           dType,
-                                           &_rawResultsBuffer[index * 65536 + 128],
-                                           (ub2 *) &_rawResultsBuffer[index * 65536 + 126],
+                                           value,
+                                           valueSize,
+                                           oraColumn->type,
+                                           &oraColumn->indicator,
+                                           &oraColumn->length,
                                            NULL,
                                            OCI_DEFAULT)) {
                             OCIErrorGet(oraErr, (ub4) 1, NULL, &rc, errorBuf, 512, OCI_HTYPE_ERROR);
                             _connection.lastError = [NSString stringWithUTF8String:(char *) errorBuf];
                         }
-                        OCIDescriptorFree(param, OCI_DTYPE_PARAM);
                     }
                 }
                 rc = OCIStmtFetch2(stmt,
@@ -892,6 +2087,10 @@ enum BxDatabaseStatementFetchType_enum {
             }
         }
     }
+    if (result && _streamsResults) {
+        // fetching ends the same way on an error as at the last row, so only lastError tells them apart
+        _connection.lastError = nil;
+    }
     if (_connection.isLocking) {
         [_connection.recursiveLock unlock];
     }
@@ -918,6 +2117,512 @@ enum BxDatabaseStatementFetchType_enum {
     return result;
 }
 
+// a row of executeBatch: as its values in parameter order, NSNull for those it leaves out
+- (NSArray *)_batchValuesForRow:(id)row {
+    NSUInteger count = [_bindNames count];
+    NSMutableArray *values = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        id value = nil;
+        if ([row isKindOfClass:[NSDictionary class]]) {
+            value = [row objectForKey:[_bindNames objectAtIndex:i]];
+        } else if (i < [row count]) {
+            value = [row objectAtIndex:i];
+        }
+        [values addObject:value == nil ? [NSNull null] : value];
+    }
+    return values;
+}
+
+// prelocked; executes each row with its own round trip
+- (void)_executeBatchRows:(NSArray *)rows
+                 statuses:(NSMutableArray *)statuses {
+    for (NSArray *values in rows) {
+        BOOL isDone = [self bindArray:values] && [self execute];
+        [statuses addObject:[NSNumber numberWithBool:isDone]];
+    }
+}
+
+// prelocked; PostgreSQL and MySQL statements that control a batch, NO if they failed or, for
+// MySQL, warned that changes to non-transactional tables could not be rolled back
+- (BOOL)_executeBatchControl:(const char *)sql {
+    if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+        PGconn *conn = (PGconn *) _connection.rawConnection;
+        PGresult *res = PQexec(conn, sql);
+        BOOL result = PQresultStatus(res) == PGRES_COMMAND_OK;
+        PQclear(res);
+        if (! result) {
+            _connection.lastError = [NSString stringWithUTF8String:PQerrorMessage(conn)];
+        }
+        return result;
+    } else {
+        MYSQL *conn = (MYSQL *) _connection.rawConnection;
+        if (mysql_real_query(conn, sql, strlen(sql)) != 0) {
+            _connection.lastError = [NSString stringWithUTF8String:mysql_error(conn)];
+            return NO;
+        } else if (mysql_warning_count(conn) != 0) {
+            _connection.lastError = [NSString stringWithFormat:@"%s raised warnings", sql];
+            return NO;
+        }
+        return YES;
+    }
+}
+
+// prelocked
+- (BxBatchScope)_beginBatchScope {
+    if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+        PGTransactionStatusType status = PQtransactionStatus((PGconn *) _connection.rawConnection);
+        if (status == PQTRANS_IDLE) {
+            return BxBatchScopeNone;
+        } else if (status != PQTRANS_INTRANS) {
+            return BxBatchScopeFailed;
+        }
+    } else {
+        unsigned int status = ((MYSQL *) _connection.rawConnection)->server_status;
+        if ((status & SERVER_STATUS_AUTOCOMMIT) && ! (status & SERVER_STATUS_IN_TRANS)) {
+            return [self _executeBatchControl:"START TRANSACTION"] ? BxBatchScopeTransaction : BxBatchScopeFailed;
+        }
+    }
+    return [self _executeBatchControl:"SAVEPOINT bx_batch"] ? BxBatchScopeSavepoint : BxBatchScopeFailed;
+}
+
+// prelocked; NO if what the statement did could not be kept when it succeeded, or undone when it
+// failed, in which case none of its rows can be reported as stored
+- (BOOL)_endBatchScope:(BxBatchScope)scope
+             succeeded:(BOOL)isDone {
+    if (scope == BxBatchScopeTransaction) {
+        return [self _executeBatchControl:isDone ? "COMMIT" : "ROLLBACK"];
+    } else if (scope == BxBatchScopeSavepoint) {
+        return [self _executeBatchControl:isDone ? "RELEASE SAVEPOINT bx_batch" : "ROLLBACK TO SAVEPOINT bx_batch"];
+    } else if (scope == BxBatchScopeNone) {
+        return YES;
+    }
+    return NO;
+}
+
+// prelocked; executes each row with its own round trip, undoing a failed row so that the rest can
+// still run, and failing the row and every remaining one once its scope cannot be ended
+- (void)_executeScopedBatchRows:(NSArray *)rows
+                       statuses:(NSMutableArray *)statuses {
+    NSUInteger index = 0;
+    for (NSArray *values in rows) {
+        BxBatchScope scope = [self _beginBatchScope];
+        BOOL isDone = scope != BxBatchScopeFailed && [self bindArray:values] && [self execute];
+        if (! [self _endBatchScope:scope
+                         succeeded:isDone]) {
+            break;
+        }
+        [statuses addObject:[NSNumber numberWithBool:isDone]];
+        index++;
+    }
+    for (; index < [rows count]; index++) {
+        [statuses addObject:[NSNumber numberWithBool:NO]];
+    }
+}
+
+// prelocked; executes the rows of a single row INSERT as one statement with a value list per row
+- (void)_executeMultiRowInsert:(NSArray *)rows
+                      statuses:(NSMutableArray *)statuses {
+    NSUInteger parameterCount = [_bindValues count];
+    NSUInteger chunkSize = parameterCount == 0 ? 0 : MIN(BX_BATCH_MAX_ROWS, BX_BATCH_MAX_PARAMETERS / parameterCount);
+    if (chunkSize < 2 || _BX_multiRowInsertSQL(_sql, parameterCount, 1) == nil) {
+        [self _executeScopedBatchRows:rows
+                             statuses:statuses];
+        return;
+    }
+    // every full chunk reuses one statement
+    BxDatabaseStatement *chunkStmt = nil;
+    NSUInteger chunkStmtRows = 0;
+    for (NSUInteger start = 0; start < [rows count]; start += chunkSize) {
+        NSArray *chunk = [rows subarrayWithRange:NSMakeRange(start, MIN(chunkSize, [rows count] - start))];
+        if (chunkStmt == nil || chunkStmtRows != [chunk count]) {
+            [chunkStmt close];
+            [chunkStmt release];
+            chunkStmtRows = [chunk count];
+            chunkStmt = [[BxDatabaseStatement alloc] initWithConnection:_connection
+                                                                    sql:_BX_multiRowInsertSQL(_sql, parameterCount, chunkStmtRows),
+                                                                        nil];
+        }
+        NSMutableArray *values = [NSMutableArray arrayWithCapacity:parameterCount * [chunk count]];
+        for (NSArray *rowValues in chunk) {
+            [values addObjectsFromArray:rowValues];
+        }
+        BxBatchScope scope = [self _beginBatchScope];
+        BOOL isDone = scope != BxBatchScopeFailed && chunkStmt != nil && [chunkStmt bindArray:values] && [chunkStmt execute];
+        if (! [self _endBatchScope:scope
+                         succeeded:isDone]) {
+            // some rows may have been stored, or the transaction is lost, so the chunk failed as a whole
+            for (NSUInteger i = 0; i < [chunk count]; i++) {
+                [statuses addObject:[NSNumber numberWithBool:NO]];
+            }
+        } else if (isDone) {
+            for (NSUInteger i = 0; i < [chunk count]; i++) {
+                [statuses addObject:[NSNumber numberWithBool:YES]];
+            }
+        } else {
+            // the chunk was undone, so find the rows that fail one at a time
+            [self _executeScopedBatchRows:chunk
+                                 statuses:statuses];
+        }
+    }
+    [chunkStmt close];
+    [chunkStmt release];
+}
+
+// prelocked; binds an array of every parameter and executes all rows in one round trip
+- (void)_executeOracleArrayBatch:(NSArray *)rows
+                        statuses:(NSMutableArray *)statuses {
+    OCIStmt *stmt = (OCIStmt *) _rawStatement;
+    OCIEnv *oraEnv = (OCIEnv *) [_connection _ociEnv];
+    OCIError *oraErr = (OCIError *) [_connection _ociError];
+    OCISvcCtx *oraSvc = (OCISvcCtx *) _connection.rawConnection;
+    OCIBind **binds = (OCIBind **) _rawBinds;
+    text errorBuf[512];
+    int rc;
+    ub4 rowCount = [rows count];
+    int count = [_bindValues count];
+    // each column's values are NUL terminated at the width of its longest
+    char *buffers[count + 1];
+    sb2 *indicators[count + 1];
+    BOOL isBound = YES;
+    for (int column = 0; column < count; column++) {
+        sb4 width = 1;
+        for (NSArray *values in rows) {
+            id value = [values objectAtIndex:column];
+            if (value != [NSNull null]) {
+                width = MAX(width, (sb4) [[value description] lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + 1);
+            }
+        }
+        buffers[column] = calloc(rowCount, width);
+        indicators[column] = calloc(rowCount, sizeof(sb2));
+        for (ub4 row = 0; row < rowCount; row++) {
+            id value = [[rows objectAtIndex:row] objectAtIndex:column];
+            if (value == [NSNull null]) {
+                indicators[column][row] = -1;
+            } else {
+                const char *utf8 = [[value description] UTF8String];
+                memcpy(&buffers[column][row * width], utf8, strlen(utf8));
+            }
+        }
+        if (OCIBindByPos(stmt,
+                         &(binds[column]),
+                         oraErr,
+                         column + 1,
+                         buffers[column],
+                         width,
+                         SQLT_STR,
+                         indicators[column],
+                         0,
+                         0,
+                         0,
+                         NULL,
+                         OCI_DEFAULT)) {
+            isBound = NO;
+        }
+    }
+    rc = isBound ? OCIStmtExecute(oraSvc, stmt, oraErr, rowCount, 0, NULL, NULL, OCI_BATCH_ERRORS) : OCI_ERROR;
+    ub4 errorCount = 0;
+    if (isBound) {
+        OCIAttrGet(stmt, OCI_HTYPE_STMT, &errorCount, NULL, OCI_ATTR_NUM_DML_ERRORS, oraErr);
+    }
+    // without row errors a failure is the whole batch's
+    BOOL isDone = rc == OCI_SUCCESS || rc == OCI_SUCCESS_WITH_INFO || errorCount > 0;
+    if (! isDone) {
+        OCIErrorGet(oraErr, 1, NULL, &rc, errorBuf, 512, OCI_HTYPE_ERROR);
+        _connection.lastError = [NSString stringWithUTF8String:(char *) errorBuf];
+    }
+    NSUInteger firstStatus = [statuses count];
+    for (ub4 row = 0; row < rowCount; row++) {
+        [statuses addObject:[NSNumber numberWithBool:isDone]];
+    }
+    if (errorCount > 0) {
+        OCIError *rowErr;
+        OCIHandleAlloc(oraEnv, (void **) &rowErr, OCI_HTYPE_ERROR, 0, NULL);
+        for (ub4 i = 0; i < errorCount; i++) {
+            ub4 offset = 0;
+            OCIParamGet(oraErr, OCI_HTYPE_ERROR, oraErr, (void **) &rowErr, i);
+            OCIAttrGet(rowErr, OCI_HTYPE_ERROR, &offset, NULL, OCI_ATTR_DML_ROW_OFFSET, oraErr);
+            OCIErrorGet(rowErr, 1, NULL, &rc, errorBuf, 512, OCI_HTYPE_ERROR);
+            _connection.lastError = [NSString stringWithUTF8String:(char *) errorBuf];
+            if (offset < rowCount) {
+                [statuses replaceObjectAtIndex:firstStatus + offset
+                                    withObject:[NSNumber numberWithBool:NO]];
+            }
+        }
+        OCIHandleFree(rowErr, OCI_HTYPE_ERROR);
+    }
+    // the parameters go back to single values before the buffers are freed
+    for (int column = 0; column < count; column++) {
+        [self _prelockedBindValue:nil
+                        forColumn:column + 1];
+        free(buffers[column]);
+        free(indicators[column]);
+    }
+}
+
+- (NSArray *)executeBatch:(NSArray *)rows {
+    if (_hasClosed) {
+        return nil;
+    }
+    if (_connection.isLocking) {
+        [_connection.recursiveLock lock];
+    }
+    NSMutableArray *statuses = [NSMutableArray arrayWithCapacity:[rows count]];
+    NSMutableArray *batch = [NSMutableArray arrayWithCapacity:[rows count]];
+    for (id row in rows) {
+        [batch addObject:[self _batchValuesForRow:row]];
+    }
+    if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
+        // one transaction instead of one per row unless the application has its own open
+        BOOL isWrapping = sqlite3_get_autocommit((sqlite3 *) _connection.rawConnection) != 0;
+        if (isWrapping) {
+            isWrapping = [_connection beginTransaction];
+        }
+        [self _executeBatchRows:batch
+                       statuses:statuses];
+        if (isWrapping) {
+            [_connection commitTransaction];
+        }
+    } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL ||
+               _connection.connectionType == BxDatabaseConnectionTypeMySQL) {
+        [self _executeMultiRowInsert:batch
+                            statuses:statuses];
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
+        if (_isSelect || [_bindValues count] == 0) {
+            [self _executeBatchRows:batch
+                           statuses:statuses];
+        } else {
+            for (NSUInteger start = 0; start < [batch count]; start += BX_BATCH_MAX_ROWS) {
+                [self _executeOracleArrayBatch:[batch subarrayWithRange:NSMakeRange(start, MIN(BX_BATCH_MAX_ROWS, [batch count] - start))]
+                                      statuses:statuses];
+            }
+        }
+    }
+    [self _reset];
+    for (int i = 0; i < [_bindValues count]; i++) {
+        [self _prelockedBindValue:nil
+                        forColumn:i + 1];
+    }
+    if (_connection.isLocking) {
+        [_connection.recursiveLock unlock];
+    }
+    return statuses;
+}
+
+// prelocked; the current row's text of a column fetched as strings or NULL for NULL, column starts at 0
+- (const char *)_textForColumn:(int)column
+                        length:(int *)length {
+    if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
+        sqlite3_stmt *stmt = (sqlite3_stmt *) _rawStatement;
+        const char *text = (const char *) sqlite3_column_text(stmt, column);
+        *length = sqlite3_column_bytes(stmt, column);
+        return text;
+    } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+        PGresult *res = (PGresult *) _rawResults;
+        if (PQgetisnull(res, _currentRow, column)) {
+            return NULL;
+        }
+        *length = PQgetlength(res, _currentRow, column);
+        return PQgetvalue(res, _currentRow, column);
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
+        MYSQL_BIND *result = &(((MYSQL_BIND *) _rawResults)[column]);
+        if (*(result->is_null)) {
+            return NULL;
+        }
+        *length = (int) *(result->length);
+        return (const char *) result->buffer;
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
+        BxOracleColumn *oraColumn = &((BxOracleColumn *) _rawResultsBuffer)[column];
+        if (oraColumn->indicator == -1) {
+            return NULL;
+        }
+        if (oraColumn->lob != NULL) {
+            const char *text = [[self _convertToStringColumn:column + 1
+                                                        name:NULL] UTF8String];
+            *length = text == NULL ? 0 : strlen(text);
+            return text;
+        }
+        *length = oraColumn->length;
+        return oraColumn->data;
+    }
+    return NULL;
+}
+
+// prelocked; PostgreSQL writes the CSV itself, which it cannot do with parameters
+- (BOOL)_copyTo:(BxTransport *)transport {
+    PGconn *conn = (PGconn *) _connection.rawConnection;
+    [self _reset];
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    NSString *sql = [_sql stringByTrimmingCharactersInSet:whitespace];
+    if ([sql hasSuffix:@";"]) {
+        sql = [sql substringToIndex:[sql length] - 1];
+    }
+    NSString *copy = [NSString stringWithFormat:@"COPY (%@) TO STDOUT WITH CSV HEADER", sql];
+    PGresult *res = PQexec(conn, [copy UTF8String]);
+    if (PQresultStatus(res) != PGRES_COPY_OUT) {
+        PQclear(res);
+        _connection.lastError = [NSString stringWithUTF8String:PQerrorMessage(conn)];
+        return NO;
+    }
+    PQclear(res);
+    char *data;
+    int length;
+    while ((length = PQgetCopyData(conn, &data, 0)) > 0) {
+        [transport _writeBytes:data
+                        length:length];
+        PQfreemem(data);
+    }
+    BOOL result = YES;
+    while ((res = PQgetResult(conn)) != NULL) {
+        if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+            result = NO;
+        }
+        PQclear(res);
+    }
+    if (length == -2 || ! result) {
+        _connection.lastError = [NSString stringWithUTF8String:PQerrorMessage(conn)];
+        result = NO;
+    }
+    return result;
+}
+
+// prelocked; encodes the rows of the last execute from the database's buffers
+- (void)_writeRowsTo:(BxTransport *)transport
+              format:(BxDatabaseStreamFormat)format {
+    int count = 0;
+    if (_connection.connectionType == BxDatabaseConnectionTypeSQLite) {
+        count = sqlite3_column_count((sqlite3_stmt *) _rawStatement);
+    } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+        count = _rawResults == NULL ? 0 : PQnfields((PGresult *) _rawResults);
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeMySQL) {
+        count = mysql_stmt_field_count((MYSQL_STMT *) _rawStatement);
+    } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
+        count = _columnCount;
+    }
+    BxStreamBuffer buffer;
+    buffer.capacity = BX_STREAM_BUFFER_SIZE;
+    buffer.length = 0;
+    buffer.bytes = malloc(buffer.capacity);
+    // the CSV header, or each JSON key followed by its colon
+    BxStreamBuffer keys;
+    keys.capacity = 256;
+    keys.length = 0;
+    keys.bytes = malloc(keys.capacity);
+    size_t keyOffsets[count + 1];
+    for (int i = 0; i < count; i++) {
+        const char *name = [[self _nameForColumn:i] UTF8String];
+        if (name == NULL) {
+            name = "";
+        }
+        keyOffsets[i] = keys.length;
+        if (format == BxDatabaseStreamFormatCSV) {
+            if (i > 0) {
+                _BX_appendBytes(&keys, ",", 1);
+            }
+            _BX_appendCSVField(&keys, name, strlen(name));
+        } else {
+            _BX_appendJSONString(&keys, name, strlen(name));
+            _BX_appendBytes(&keys, ":", 1);
+        }
+    }
+    keyOffsets[count] = keys.length;
+    if (format == BxDatabaseStreamFormatCSV) {
+        _BX_appendBytes(&buffer, keys.bytes, keys.length);
+        _BX_appendBytes(&buffer, "\n", 1);
+    } else {
+        _BX_appendBytes(&buffer, "[", 1);
+    }
+    NSUInteger rows = 0;
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    while (_hasMoreRows) {
+        if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
+            _currentRow = PQntuples((PGresult *) _rawResults) - _rowsLeft;
+            _rowsLeft--;
+        }
+        if (format == BxDatabaseStreamFormatJSON) {
+            _BX_appendBytes(&buffer, rows > 0 ? ",\n{" : "\n{", rows > 0 ? 3 : 2);
+        }
+        for (int i = 0; i < count; i++) {
+            int length = 0;
+            const char *text = [self _textForColumn:i
+                                             length:&length];
+            if (format == BxDatabaseStreamFormatCSV) {
+                if (i > 0) {
+                    _BX_appendBytes(&buffer, ",", 1);
+                }
+                if (text != NULL) {
+                    _BX_appendCSVField(&buffer, text, length);
+                }
+            } else {
+                if (i > 0) {
+                    _BX_appendBytes(&buffer, ",", 1);
+                }
+                _BX_appendBytes(&buffer, &keys.bytes[keyOffsets[i]], keyOffsets[i + 1] - keyOffsets[i]);
+                if (text == NULL) {
+                    _BX_appendBytes(&buffer, "null", 4);
+                } else {
+                    _BX_appendJSONString(&buffer, text, length);
+                }
+            }
+        }
+        _BX_appendBytes(&buffer, format == BxDatabaseStreamFormatCSV ? "\n" : "}", 1);
+        if (buffer.length >= BX_STREAM_BUFFER_SIZE) {
+            [transport _writeBytes:buffer.bytes
+                            length:buffer.length];
+            buffer.length = 0;
+        }
+        rows++;
+        if (rows % _fetchSize == 0) {
+            [pool release];
+            pool = [[NSAutoreleasePool alloc] init];
+        }
+        [self _advanceRow];
+    }
+    [pool release];
+    if (format == BxDatabaseStreamFormatJSON) {
+        _BX_appendBytes(&buffer, rows > 0 ? "\n]\n" : "]\n", rows > 0 ? 3 : 2);
+    }
+    [transport _writeBytes:buffer.bytes
+                    length:buffer.length];
+    free(buffer.bytes);
+    free(keys.bytes);
+}
+
+- (BOOL)streamTo:(BxTransport *)transport
+          format:(BxDatabaseStreamFormat)format {
+    if (_hasClosed) {
+        return NO;
+    }
+    if (_connection.isLocking) {
+        [_connection.recursiveLock lock];
+    }
+    BOOL result;
+    if (_copiesResults &&
+        format == BxDatabaseStreamFormatCSV &&
+        _connection.connectionType == BxDatabaseConnectionTypePostgreSQL &&
+        [_bindValues count] == 0) {
+        result = [self _copyTo:transport];
+    } else {
+        // always read as text through a cursor, whatever the statement is set to
+        BOOL streamsResults = _streamsResults;
+        BOOL fetchesTypedValues = _fetchesTypedValues;
+        _streamsResults = YES;
+        _fetchesTypedValues = NO;
+        result = [self execute];
+        _streamsResults = streamsResults;
+        _fetchesTypedValues = fetchesTypedValues;
+        if (result) {
+            // execute cleared lastError, so errors while reading on are only seen there
+            [self _writeRowsTo:transport
+                        format:format];
+            result = _connection.lastError == nil;
+        }
+    }
+    if (_connection.isLocking) {
+        [_connection.recursiveLock unlock];
+    }
+    return result;
+}
+
 - (NSArray *)fetchArray {
     if (_hasClosed) {
         return nil;
@@ -970,40 +2675,24 @@ enum BxDatabaseStatementFetchType_enum {
     _hasMoreRows = NO;
     _hasResetted = YES;    
     _connection = [connection retain];
-    _bindNames = [[NSMutableArray alloc] initWithCapacity:8];
+    _pool = nil;
+    _isCached = NO;
+    _fetchesTypedValues = connection.fetchesTypedValues;
+    _hasTypedResults = NO;
+    _resultFormat = -1;
+    _rowKeys = nil;
+    _rowIndexes = nil;
+    _streamsResults = NO;
+    _fetchSize = 256;
+    _currentRow = 0;
+    _cursorName = nil;
+    _enumeratedRows = nil;
+    _bindNames = [[NSMutableArray alloc] initWithArray:[BxDatabaseStatement _bindNamesForSQL:sql]];
     _rawBinds = NULL;
     _rawBindsBuffer = NULL;
     _rawResults = NULL;
     _rawResultsBuffer = NULL;
     _rawResultsInfo = NULL;
-    BOOL isSingleQuoting = NO;
-    BOOL isValue = NO;
-    int valStart = 0;
-    int length = [sql length];
-    for (int i = 0; i < length; i++) {
-        unichar c = [sql characterAtIndex:i];
-        if (isSingleQuoting) {
-            if (c == '\'') {
-                isSingleQuoting = NO;
-            }
-        } else if (isValue) {
-            if (!(isalnum(c) || c == '_')) {
-                [_bindNames addObject:[sql substringWithRange:NSMakeRange(valStart, i - valStart)]];
-                isValue = NO;
-                if (c == '\'') {
-                    isSingleQuoting = YES;
-                }
-            }
-        } else if (c == ':' || c == '?' || c == '$') {
-            valStart = i + 1;
-            isValue = YES;
-        } else if (c == '\'') {
-            isSingleQuoting = YES;
-        }
-    }
-    if (isValue) {
-        [_bindNames addObject:[sql substringWithRange:NSMakeRange(valStart, length - valStart)]];        
-    }
     _bindValues = [[NSMutableArray alloc] initWithCapacity:[_bindNames count]];
     for (int i = 0; i < [_bindNames count]; i++) {
         [_bindValues addObject:[NSNull null]];
@@ -1026,6 +2715,15 @@ enum BxDatabaseStatementFetchType_enum {
         _rawStatement = (void *) stmt;
     } else if (_connection.connectionType == BxDatabaseConnectionTypePostgreSQL) {
         _statementName = [[NSString alloc] initWithFormat:@"BX%uBX", [sql hash]];
+        _sql = [sql copy];
+        _isSelect = NO;
+        NSString *trimmedSQL = [sql stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+        for (NSString *keyword in [NSArray arrayWithObjects:@"SELECT", @"WITH", @"VALUES", @"TABLE", nil]) {
+            if ([trimmedSQL rangeOfString:keyword
+                                  options:NSAnchoredSearch | NSCaseInsensitiveSearch].location != NSNotFound) {
+                _isSelect = YES;
+            }
+        }
         NSMutableSet *statements = [_connection _statements];
         if (! [statements member:_statementName]) {
             PGconn *conn = (PGconn *) _connection.rawConnection;
@@ -1072,8 +2770,9 @@ enum BxDatabaseStatementFetchType_enum {
             for (int i = 0; i < count; i++) {
                 binds[i].buffer_type = MYSQL_TYPE_NULL;
             }
-            _rawBindsBuffer = calloc(count, 65536); // 0-65525 char* buffer, 65526 = bool, 65528-65535 = long
+            _rawBindsBuffer = calloc(count, sizeof(unsigned long)); // value lengths
         }
+        _sql = [sql copy];
         _rawStatement = (void *) stmt;
     } else if (_connection.connectionType == BxDatabaseConnectionTypeOracle) {
         OCIStmt *stmt;
@@ -1105,7 +2804,7 @@ enum BxDatabaseStatementFetchType_enum {
             [_connection release];
             return nil;
         }
-        _rawBindsBuffer = calloc([_bindValues count], 65535); // 0-65529 char* buffer, 65530-65531 indicator, 65532-65533 len, 65534-65535 res
+        _rawBindsBuffer = calloc([_bindValues count], sizeof(sb2)); // value indicators
         _rawBinds = calloc([_bindValues count], sizeof(OCIBind *));
         _isSelect = [sql rangeOfString:@"SELECT"
                                options:NSCaseInsensitiveSearch].location != NSNotFound;
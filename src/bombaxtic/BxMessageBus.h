@@ -0,0 +1,69 @@
+/**
+ \brief Carries ClientLib messages between the processes of a multi-process location
+ \class BxMessageBus
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ Without a bus, BxClientLibHandler broadcasts and session messages only reach the
+ sessions held by the process that sent them.  Every process that creates a bus on the
+ same directory binds a unix domain datagram socket there, named after its process id,
+ and forwards what it broadcasts or sends to all of the other sockets it finds.  No
+ broker is involved; a process that exits simply stops being found and any socket it
+ left behind is removed by the first sibling that fails to reach it.
+ 
+ Messages published within \c flushInterval of each other are sent together in as few
+ datagrams as possible.  A datagram that a sibling is too busy to receive is dropped and
+ counted rather than holding up the sender.
+ 
+ A session message is delivered by every process that holds a session with the same
+ cookie.  If the location shares sessions through a BxSessionStore and clients are not
+ pinned to one process (e.g. with the IP hash load balancing option), a client may
+ therefore receive the same message from more than one process.
+ 
+ Example of joining the processes of a location:
+ \code
+ - (id)setup {
+     BxMessageBus *bus = [[BxMessageBus alloc] initWithPath:@"/tmp/myapp-bus"
+                                                      error:nil];
+     [BxClientLibHandler setMessageBus:bus];
+     [bus release];
+     return self;
+ }
+ \endcode
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+#import <libkern/OSAtomic.h>
+
+@class BxClientLibHandler;
+@class BxMessage;
+
+@interface BxMessageBus : NSObject {
+    BxClientLibHandler *_handler; // not retained, it owns the bus
+    NSString *_path;
+    NSString *_socketPath;
+    int _receiveSocket;
+    int _sendSocket;
+    NSCondition *_outboxCondition;
+    NSMutableArray *_outbox; // encoded entries waiting for the sender thread
+    NSArray *_peers; // socket paths of the sibling processes
+    NSTimeInterval _peersScanned;
+    NSTimeInterval _flushInterval;
+    volatile int64_t _publishedCount;
+    volatile int64_t _receivedCount;
+    volatile int64_t _droppedDatagramCount;
+}
+
+// path is a directory shared by the sibling processes only, created if needed
+- (id)initWithPath:(NSString *)path
+             error:(NSString **)error;
+
+// "published" and "received" messages and "droppedDatagrams" since startup, and "peers"
+- (NSDictionary *)statistics;
+
+// how long the first message of a batch waits for others, defaults to 0.002 seconds
+@property (assign) NSTimeInterval flushInterval;
+@property (readonly) NSString *path;
+
+@end
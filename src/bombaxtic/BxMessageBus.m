@@ -0,0 +1,287 @@
+#import "BxMessageBus.h"
+#import "BxClientLibHandler.h"
+#import "BxWireFormat.h"
+#import <Bombaxtic/BxMessage.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// the socket buffers are raised so a full datagram fits; the default is much smaller for local sockets
+#define BX_MESSAGE_BUS_MAX_DATAGRAM (64 * 1024)
+#define BX_MESSAGE_BUS_RECEIVE_BUFFER (1024 * 1024)
+#define BX_MESSAGE_BUS_DATAGRAM_HEADER_LENGTH (BX_WIRE_HEADER_LENGTH + 8)
+// how often the directory is listed for processes that started since
+#define BX_MESSAGE_BUS_PEER_SCAN_INTERVAL 1
+
+@implementation BxMessageBus
+
+@synthesize flushInterval = _flushInterval;
+@synthesize path = _path;
+
+static BOOL _BX_socketAddress(NSString *path, struct sockaddr_un *address) {
+    const char *fileSystemPath = [path fileSystemRepresentation];
+    if (strlen(fileSystemPath) >= sizeof(address->sun_path)) {
+        return NO;
+    }
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    strncpy(address->sun_path, fileSystemPath, sizeof(address->sun_path) - 1);
+    return YES;
+}
+
+- (id)initWithPath:(NSString *)path
+             error:(NSString **)error {
+    [super init];
+    _receiveSocket = -1;
+    _sendSocket = -1;
+    NSString *failure = nil;
+    struct sockaddr_un address;
+    int bufferSize;
+    _path = [path copy];
+    _socketPath = [[path stringByAppendingPathComponent:[NSString stringWithFormat:@"%d.sock", getpid()]] retain];
+    if (! [[NSFileManager defaultManager] createDirectoryAtPath:path
+                                    withIntermediateDirectories:YES
+                                                     attributes:nil
+                                                          error:nil]) {
+        failure = [NSString stringWithFormat:@"Could not create the message bus directory '%@'", path];
+    } else if (! _BX_socketAddress(_socketPath, &address)) {
+        failure = [NSString stringWithFormat:@"The message bus path '%@' is too long for a socket", path];
+    } else if ((_receiveSocket = socket(AF_UNIX, SOCK_DGRAM, 0)) < 0 ||
+               (_sendSocket = socket(AF_UNIX, SOCK_DGRAM, 0)) < 0) {
+        failure = [NSString stringWithFormat:@"Could not create the message bus sockets: %s", strerror(errno)];
+    } else {
+        // a previous process with the same id did not clean up
+        unlink(address.sun_path);
+        if (bind(_receiveSocket, (struct sockaddr *) &address, sizeof(address)) < 0) {
+            failure = [NSString stringWithFormat:@"Could not bind the message bus socket '%@': %s", _socketPath, strerror(errno)];
+        }
+    }
+    if (failure) {
+        if (error != nil && error != NULL) {
+            *error = failure;
+        }
+        [self release];
+        return nil;
+    }
+    bufferSize = BX_MESSAGE_BUS_RECEIVE_BUFFER;
+    setsockopt(_receiveSocket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    bufferSize = BX_MESSAGE_BUS_MAX_DATAGRAM + 1024;
+    setsockopt(_sendSocket, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+    // a sibling that is not keeping up costs it the datagram, never the sender its time
+    fcntl(_sendSocket, F_SETFL, fcntl(_sendSocket, F_GETFL) | O_NONBLOCK);
+    _outboxCondition = [[NSCondition alloc] init];
+    _outbox = [[NSMutableArray alloc] initWithCapacity:64];
+    _peers = [[NSArray alloc] init];
+    _peersScanned = 0;
+    _flushInterval = 0.002;
+    _publishedCount = 0;
+    _receivedCount = 0;
+    _droppedDatagramCount = 0;
+    [NSThread detachNewThreadSelector:@selector(_receiveThreadMain:)
+                             toTarget:self
+                           withObject:nil];
+    [NSThread detachNewThreadSelector:@selector(_sendThreadMain:)
+                             toTarget:self
+                           withObject:nil];
+    return self;
+}
+
+- (void)_setHandler:(BxClientLibHandler *)handler {
+    _handler = handler;
+}
+
+// a nil cookie broadcasts the message
+- (void)_publishMessage:(BxMessage *)message
+                 cookie:(NSString *)cookie {
+    NSMutableData *entry = [NSMutableData dataWithCapacity:[message.data length] + 128];
+    _BX_wireAppendString(entry, cookie);
+    [message _appendWireFormat:entry];
+    if ([entry length] + BX_MESSAGE_BUS_DATAGRAM_HEADER_LENGTH > BX_MESSAGE_BUS_MAX_DATAGRAM) {
+        NSLog(@"Bombaxtic -> Message of kind '%@' is too large for the message bus (%d bytes)", message.kind, (int) [entry length]);
+        return;
+    }
+    OSAtomicIncrement64(&_publishedCount);
+    [_outboxCondition lock];
+    [_outbox addObject:entry];
+    if ([_outbox count] == 1) {
+        [_outboxCondition signal];
+    }
+    [_outboxCondition unlock];
+}
+
+- (NSArray *)_scanPeers {
+    NSMutableArray *peers = [NSMutableArray arrayWithCapacity:8];
+    for (NSString *fileName in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:_path
+                                                                                   error:nil]) {
+        NSString *peer = [_path stringByAppendingPathComponent:fileName];
+        if ([fileName hasSuffix:@".sock"] && ! [peer isEqualToString:_socketPath]) {
+            [peers addObject:peer];
+        }
+    }
+    return peers;
+}
+
+// only called from the send thread
+- (NSArray *)_currentPeers {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if (now - _peersScanned >= BX_MESSAGE_BUS_PEER_SCAN_INTERVAL) {
+        [_peers release];
+        _peers = [[self _scanPeers] copy];
+        _peersScanned = now;
+    }
+    return _peers;
+}
+
+- (void)_sendDatagram:(NSData *)datagram {
+    struct sockaddr_un address;
+    BOOL hasStalePeers = NO;
+    for (NSString *peer in [self _currentPeers]) {
+        if (! _BX_socketAddress(peer, &address)) {
+            continue;
+        }
+        if (sendto(_sendSocket, [datagram bytes], [datagram length], 0,
+                   (struct sockaddr *) &address, sizeof(address)) < 0) {
+            if (errno == ECONNREFUSED || errno == ENOENT) {
+                // nothing is bound to it, the process has gone
+                unlink(address.sun_path);
+                hasStalePeers = YES;
+            } else {
+                OSAtomicIncrement64(&_droppedDatagramCount);
+            }
+        }
+    }
+    if (hasStalePeers) {
+        _peersScanned = 0;
+    }
+}
+
+- (void)_sendEntries:(NSArray *)entries {
+    NSMutableData *datagram = nil;
+    uint32_t count = 0;
+    for (NSData *entry in entries) {
+        if (datagram && [datagram length] + [entry length] > BX_MESSAGE_BUS_MAX_DATAGRAM) {
+            uint32_t bigEndianCount = htonl(count);
+            [datagram replaceBytesInRange:NSMakeRange(BX_WIRE_HEADER_LENGTH + 4, 4)
+                                withBytes:&bigEndianCount];
+            [self _sendDatagram:datagram];
+            datagram = nil;
+        }
+        if (datagram == nil) {
+            datagram = [NSMutableData dataWithCapacity:BX_MESSAGE_BUS_MAX_DATAGRAM];
+            _BX_wireAppendHeader(datagram, BX_WIRE_TYPE_BUS);
+            _BX_wireAppendUInt32(datagram, (uint32_t) getpid());
+            _BX_wireAppendUInt32(datagram, 0);
+            count = 0;
+        }
+        [datagram appendData:entry];
+        count++;
+    }
+    if (datagram) {
+        uint32_t bigEndianCount = htonl(count);
+        [datagram replaceBytesInRange:NSMakeRange(BX_WIRE_HEADER_LENGTH + 4, 4)
+                            withBytes:&bigEndianCount];
+        [self _sendDatagram:datagram];
+    }
+}
+
+- (void)_sendThreadMain:(id)arg {
+    while (YES) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        @try {
+            [_outboxCondition lock];
+            while ([_outbox count] == 0) {
+                [_outboxCondition wait];
+            }
+            [_outboxCondition unlock];
+            // give the rest of the batch a moment to arrive
+            if (_flushInterval > 0) {
+                [NSThread sleepForTimeInterval:_flushInterval];
+            }
+            [_outboxCondition lock];
+            NSArray *entries = _outbox;
+            _outbox = [[NSMutableArray alloc] initWithCapacity:64];
+            [_outboxCondition unlock];
+            [self _sendEntries:entries];
+            [entries release];
+        } @catch (id exc) {
+            NSLog(@"Bombaxtic -> Exception while sending to the message bus: %@", [exc description]);
+        }
+        [pool release];
+    }
+}
+
+- (void)_receiveDatagram:(NSData *)datagram {
+    NSUInteger offset = BX_WIRE_HEADER_LENGTH;
+    uint32_t pid;
+    uint32_t count;
+    if (! _BX_wireHasHeader(datagram, BX_WIRE_TYPE_BUS) ||
+        ! _BX_wireReadUInt32(datagram, &offset, &pid) ||
+        ! _BX_wireReadUInt32(datagram, &offset, &count)) {
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        NSString *cookie;
+        BxMessage *message;
+        if (! _BX_wireReadString(datagram, &offset, &cookie) ||
+            (message = [BxMessage _messageWithWireData:datagram
+                                                offset:&offset]) == nil) {
+            NSLog(@"Bombaxtic -> Discarding a corrupt message bus datagram from process %u", pid);
+            return;
+        }
+        OSAtomicIncrement64(&_receivedCount);
+        [_handler _receiveMessage:message
+                           cookie:cookie];
+    }
+}
+
+- (void)_receiveThreadMain:(id)arg {
+    char *buffer = malloc(BX_MESSAGE_BUS_MAX_DATAGRAM);
+    while (YES) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        @try {
+            ssize_t length = recv(_receiveSocket, buffer, BX_MESSAGE_BUS_MAX_DATAGRAM, 0);
+            if (length > 0) {
+                // copied, the messages keep slices of it
+                [self _receiveDatagram:[NSData dataWithBytes:buffer
+                                                      length:length]];
+            } else if (length < 0 && errno != EINTR) {
+                NSLog(@"Bombaxtic -> Could not receive from the message bus: %s", strerror(errno));
+                [NSThread sleepForTimeInterval:1];
+            }
+        } @catch (id exc) {
+            NSLog(@"Bombaxtic -> Exception while receiving from the message bus: %@", [exc description]);
+        }
+        [pool release];
+    }
+}
+
+- (NSDictionary *)statistics {
+    return [NSDictionary dictionaryWithObjectsAndKeys:
+            [NSNumber numberWithLongLong:_publishedCount], @"published",
+            [NSNumber numberWithLongLong:_receivedCount], @"received",
+            [NSNumber numberWithLongLong:_droppedDatagramCount], @"droppedDatagrams",
+            [NSNumber numberWithUnsignedInteger:[[self _scanPeers] count]], @"peers",
+            nil];
+}
+
+- (void)dealloc {
+    // not likely to reach here while the threads are running...
+    if (_receiveSocket >= 0) {
+        close(_receiveSocket);
+        unlink([_socketPath fileSystemRepresentation]);
+    }
+    if (_sendSocket >= 0) {
+        close(_sendSocket);
+    }
+    [_path release];
+    [_socketPath release];
+    [_outboxCondition release];
+    [_outbox release];
+    [_peers release];
+    [super dealloc];
+}
+
+@end
@@ -0,0 +1,53 @@
+/**
+ \brief Runs ClientLib message observers on a bounded pool of threads
+ \class BxMessageDispatcher
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ Messages received from a client are queued on their session and the request returns right
+ away.  At most one operation drains a given session at a time, so observers see that
+ session's messages in the order they arrived, while different sessions are dispatched in
+ parallel up to the pool size.  Whatever has queued up by the time a drain runs is handed
+ to batched observers as one array.  A session holds at most \c limit messages waiting for
+ its observers, and \c policy decides what happens to a message that would exceed it, as
+ for the messages waiting for the client.
+ 
+ The time spent in each observer method is recorded for statistics.
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+#import <Bombaxtic/BxClientLibHandler.h>
+
+@class BxCallback;
+@class BxClientLibHandler;
+@class BxMessage;
+@class BxSession;
+
+@interface BxMessageDispatcher : NSObject {
+    BxClientLibHandler *_handler; // not retained, it owns the dispatcher
+    NSOperationQueue *_queue;
+    NSLock *_statisticsLock;
+    NSMutableDictionary *_statistics; // observer method -> NSMutableDictionary
+}
+
+- (id)initWithHandler:(BxClientLibHandler *)handler
+ maxConcurrentDispatches:(NSUInteger)maxConcurrentDispatches;
+
+// NO if the session's queue is full and the policy is to invalidate it; dropped is set to 0 or 1
+- (BOOL)dispatchMessage:(BxMessage *)message
+                session:(BxSession *)session
+                  limit:(NSUInteger)limit
+                 policy:(BxPendingMessagePolicy)policy
+                dropped:(NSUInteger *)dropped;
+
+// called by BxMessageObservers for every callback it runs
+- (id)invokeCallback:(BxCallback *)callback
+                with:(id)result;
+
+// observer method -> "invocations", "totalTime" and "maxTime", in seconds
+- (NSDictionary *)statistics;
+
+@property (assign) NSUInteger maxConcurrentDispatches;
+
+@end
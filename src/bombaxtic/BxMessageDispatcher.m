@@ -0,0 +1,112 @@
+#import "BxMessageDispatcher.h"
+#import "BxCallback.h"
+#import "BxClientLibHandler.h"
+#import "BxMessageObservers.h"
+#import <Bombaxtic/BxMessage.h>
+#import "BxSession_Private.h"
+
+@implementation BxMessageDispatcher
+
+- (id)initWithHandler:(BxClientLibHandler *)handler
+ maxConcurrentDispatches:(NSUInteger)maxConcurrentDispatches {
+    [super init];
+    _handler = handler;
+    _queue = [[NSOperationQueue alloc] init];
+    [_queue setMaxConcurrentOperationCount:MAX(maxConcurrentDispatches, 1)];
+    _statisticsLock = [[NSLock alloc] init];
+    _statistics = [[NSMutableDictionary alloc] initWithCapacity:16];
+    return self;
+}
+
+- (void)_drainSession:(BxSession *)session {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    NSArray *messages;
+    while ((messages = [session _takeInboundMessages])) {
+        [[_handler _globalMessageObservers] invokeWithMessages:messages
+                                                    dispatcher:self];
+        [session _notifyMessageObservers:messages
+                              dispatcher:self];
+        [pool release];
+        pool = [[NSAutoreleasePool alloc] init];
+    }
+    [pool release];
+}
+
+- (BOOL)dispatchMessage:(BxMessage *)message
+                session:(BxSession *)session
+                  limit:(NSUInteger)limit
+                 policy:(BxPendingMessagePolicy)policy
+                dropped:(NSUInteger *)dropped {
+    BOOL isScheduling;
+    BOOL result = [session _addInboundMessage:message
+                                        limit:limit
+                                       policy:policy
+                                      dropped:dropped
+                                   scheduling:&isScheduling];
+    if (isScheduling) {
+        NSInvocationOperation *operation = [[NSInvocationOperation alloc] initWithTarget:self
+                                                                                selector:@selector(_drainSession:)
+                                                                                  object:session];
+        [_queue addOperation:operation];
+        [operation release];
+    }
+    return result;
+}
+
+- (id)invokeCallback:(BxCallback *)callback
+                with:(id)result {
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    @try {
+        [callback invokeWith:result];
+    } @catch (id exc) {
+        NSLog(@"Bombaxtic -> Exception in message observer: %@", [exc description]);
+    }
+    NSTimeInterval duration = [NSDate timeIntervalSinceReferenceDate] - start;
+    NSString *observerMethod = [NSString stringWithFormat:@"-[%@ %@]",
+                                [callback.target class], NSStringFromSelector(callback.selector)];
+    [_statisticsLock lock];
+    NSMutableDictionary *statistics = [_statistics objectForKey:observerMethod];
+    if (statistics == nil) {
+        statistics = [NSMutableDictionary dictionaryWithCapacity:3];
+        [_statistics setObject:statistics
+                        forKey:observerMethod];
+    }
+    [statistics setObject:[NSNumber numberWithUnsignedLongLong:[[statistics objectForKey:@"invocations"] unsignedLongLongValue] + 1]
+                   forKey:@"invocations"];
+    [statistics setObject:[NSNumber numberWithDouble:[[statistics objectForKey:@"totalTime"] doubleValue] + duration]
+                   forKey:@"totalTime"];
+    if (duration > [[statistics objectForKey:@"maxTime"] doubleValue]) {
+        [statistics setObject:[NSNumber numberWithDouble:duration]
+                       forKey:@"maxTime"];
+    }
+    [_statisticsLock unlock];
+    return self;
+}
+
+- (NSDictionary *)statistics {
+    [_statisticsLock lock];
+    NSMutableDictionary *statistics = [NSMutableDictionary dictionaryWithCapacity:[_statistics count]];
+    for (NSString *observerMethod in _statistics) {
+        [statistics setObject:[NSDictionary dictionaryWithDictionary:[_statistics objectForKey:observerMethod]]
+                       forKey:observerMethod];
+    }
+    [_statisticsLock unlock];
+    return statistics;
+}
+
+- (NSUInteger)maxConcurrentDispatches {
+    return [_queue maxConcurrentOperationCount];
+}
+
+- (void)setMaxConcurrentDispatches:(NSUInteger)maxConcurrentDispatches {
+    [_queue setMaxConcurrentOperationCount:MAX(maxConcurrentDispatches, 1)];
+}
+
+- (void)dealloc {
+    [_queue release];
+    [_statisticsLock release];
+    [_statistics release];
+    [super dealloc];
+}
+
+@end
@@ -0,0 +1,40 @@
+/**
+ \brief Immutable set of message observer callbacks, keyed by message kind
+ \class BxMessageObservers
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ Instances are never modified; adding or removing an observer returns a new set.  Owners
+ swap in the new set under a short lock and readers invoke whatever set they picked up
+ without holding any lock while the callbacks run.
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+
+@class BxCallback;
+@class BxMessage;
+@class BxMessageDispatcher;
+
+@interface BxMessageObservers : NSObject {
+    NSDictionary *_callbacks; // kind or NSNull -> NSArray of BxCallback
+    NSDictionary *_batchCallbacks; // kind or NSNull -> NSArray of BxCallback invoked with an NSArray of messages
+}
+
+// a nil kind observes messages of every kind
+- (BxMessageObservers *)observersByAddingCallback:(BxCallback *)callback
+                                             kind:(NSString *)kind;
+
+- (BxMessageObservers *)observersByAddingCallback:(BxCallback *)callback
+                                             kind:(NSString *)kind
+                                          batched:(BOOL)isBatched;
+
+// a nil kind removes the target from every kind
+- (BxMessageObservers *)observersByRemovingTarget:(id)target
+                                             kind:(NSString *)kind;
+
+// messages are in arrival order; each callback runs through the dispatcher
+- (id)invokeWithMessages:(NSArray *)messages
+              dispatcher:(BxMessageDispatcher *)dispatcher;
+
+@end
@@ -0,0 +1,131 @@
+#import "BxMessageObservers.h"
+#import "BxCallback.h"
+#import "BxMessageDispatcher.h"
+#import <Bombaxtic/BxMessage.h>
+
+@implementation BxMessageObservers
+
+- (id)init {
+    [super init];
+    _callbacks = [[NSDictionary alloc] init];
+    _batchCallbacks = [[NSDictionary alloc] init];
+    return self;
+}
+
+- (id)_initWithCallbacks:(NSDictionary *)callbacks
+          batchCallbacks:(NSDictionary *)batchCallbacks {
+    [super init];
+    _callbacks = [callbacks copy];
+    _batchCallbacks = [batchCallbacks copy];
+    return self;
+}
+
+static NSDictionary *_BX_callbacksByAdding(NSDictionary *callbacks, BxCallback *callback, NSString *kind) {
+    id key = kind;
+    if (kind == nil) {
+        key = [NSNull null];
+    }
+    NSMutableDictionary *added = [[callbacks mutableCopy] autorelease];
+    NSArray *observers = [added objectForKey:key];
+    if (observers) {
+        observers = [observers arrayByAddingObject:callback];
+    } else {
+        observers = [NSArray arrayWithObject:callback];
+    }
+    [added setObject:observers
+              forKey:key];
+    return added;
+}
+
+static NSDictionary *_BX_callbacksByRemoving(NSDictionary *callbacks, id target, NSString *kind) {
+    NSMutableDictionary *remainder = [NSMutableDictionary dictionaryWithCapacity:[callbacks count]];
+    for (id key in callbacks) {
+        NSArray *observers = [callbacks objectForKey:key];
+        if (kind == nil || [kind isEqual:key]) {
+            NSMutableArray *remaining = [NSMutableArray arrayWithCapacity:[observers count]];
+            for (BxCallback *callback in observers) {
+                if (callback.target != target) {
+                    [remaining addObject:callback];
+                }
+            }
+            observers = remaining;
+        }
+        if ([observers count] > 0) {
+            [remainder setObject:observers
+                          forKey:key];
+        }
+    }
+    return remainder;
+}
+
+- (BxMessageObservers *)observersByAddingCallback:(BxCallback *)callback
+                                             kind:(NSString *)kind {
+    return [self observersByAddingCallback:callback
+                                      kind:kind
+                                   batched:NO];
+}
+
+- (BxMessageObservers *)observersByAddingCallback:(BxCallback *)callback
+                                             kind:(NSString *)kind
+                                          batched:(BOOL)isBatched {
+    NSDictionary *callbacks = _callbacks;
+    NSDictionary *batchCallbacks = _batchCallbacks;
+    if (isBatched) {
+        batchCallbacks = _BX_callbacksByAdding(batchCallbacks, callback, kind);
+    } else {
+        callbacks = _BX_callbacksByAdding(callbacks, callback, kind);
+    }
+    return [[[BxMessageObservers alloc] _initWithCallbacks:callbacks
+                                            batchCallbacks:batchCallbacks] autorelease];
+}
+
+- (BxMessageObservers *)observersByRemovingTarget:(id)target
+                                             kind:(NSString *)kind {
+    return [[[BxMessageObservers alloc] _initWithCallbacks:_BX_callbacksByRemoving(_callbacks, target, kind)
+                                            batchCallbacks:_BX_callbacksByRemoving(_batchCallbacks, target, kind)] autorelease];
+}
+
+- (id)invokeWithMessages:(NSArray *)messages
+              dispatcher:(BxMessageDispatcher *)dispatcher {
+    if ([_callbacks count] > 0) {
+        for (BxMessage *message in messages) {
+            for (BxCallback *callback in [_callbacks objectForKey:[NSNull null]]) {
+                [dispatcher invokeCallback:callback
+                                      with:message];
+            }
+            if (message.kind) {
+                for (BxCallback *callback in [_callbacks objectForKey:message.kind]) {
+                    [dispatcher invokeCallback:callback
+                                          with:message];
+                }
+            }
+        }
+    }
+    for (id key in _batchCallbacks) {
+        NSArray *batch = messages;
+        if (key != [NSNull null]) {
+            NSMutableArray *matching = [NSMutableArray arrayWithCapacity:[messages count]];
+            for (BxMessage *message in messages) {
+                if ([key isEqual:message.kind]) {
+                    [matching addObject:message];
+                }
+            }
+            batch = matching;
+        }
+        if ([batch count] > 0) {
+            for (BxCallback *callback in [_batchCallbacks objectForKey:key]) {
+                [dispatcher invokeCallback:callback
+                                      with:batch];
+            }
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    [_callbacks release];
+    [_batchCallbacks release];
+    [super dealloc];
+}
+
+@end
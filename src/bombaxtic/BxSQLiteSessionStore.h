@@ -0,0 +1,61 @@
+/**
+ \brief Session store shared by all BxApp processes on a host through a SQLite file
+ \class BxSQLiteSessionStore
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ Sessions are written to a SQLite database using the bundled SQLite library.  Saves and
+ \c lastActivated updates are cached in memory and written back in a single transaction
+ every \c flushInterval seconds, so a request never waits on the database unless it
+ creates a session or asks for a session that another process created.  Sessions idle
+ for longer than \c timeout are deleted during the flush.
+
+ Every row carries a version which a save increments.  A session known to the process is
+ checked against its row on each request and reloaded when another process has saved it
+ since, which costs one indexed read on a connection of its own that does not wait for a
+ flush in progress.  A flush only writes a session whose row still has
+ the version the process last read; otherwise the save is logged and dropped, and the
+ newer state is loaded on the next request.
+ 
+ The session state dictionary is archived with \c NSKeyedArchiver and must only contain
+ objects that support \c NSCoding.
+ 
+ Example of sharing ClientLib sessions between processes:
+ \code
+ - (id)setup {
+     BxSQLiteSessionStore *store = [[BxSQLiteSessionStore alloc] initWithPath:@"/tmp/myapp-sessions.sqlite3"
+                                                                        error:nil];
+     [BxClientLibHandler setSessionStore:store];
+     [store release];
+     return self;
+ }
+ \endcode
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+#import <Bombaxtic/BxSessionStore.h>
+
+@class BxDatabaseConnection;
+
+@interface BxSQLiteSessionStore : NSObject <BxSessionStore> {
+    BxDatabaseConnection *_db;
+    BxDatabaseConnection *_refreshDb; // reads only, so refreshes never wait on a flush
+    NSLock *_pendingLock;
+    NSMutableDictionary *_pendingSaves; // cookie -> (BxSession, state snapshot)
+    NSMutableDictionary *_pendingTouches; // cookie -> BxSession
+    NSMutableDictionary *_versions; // cookie -> NSNumber version last read or written
+    NSTimeInterval _flushInterval;
+    NSTimeInterval _timeout;
+}
+
+- (id)initWithPath:(NSString *)path
+             error:(NSString **)error;
+
+// writes all cached saves and touches immediately
+- (BOOL)flush;
+
+@property (assign) NSTimeInterval flushInterval;
+@property (assign) NSTimeInterval timeout;
+
+@end
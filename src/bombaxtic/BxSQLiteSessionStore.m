@@ -0,0 +1,300 @@
+#import "BxSQLiteSessionStore.h"
+#import <Bombaxtic/BxDatabaseConnection.h>
+#import <Bombaxtic/BxDatabaseStatement.h>
+#import "BxSession_Private.h"
+#import <Bombaxtic/BxUtil.h>
+#import "sqlite3.h"
+
+@implementation BxSQLiteSessionStore
+
+@synthesize flushInterval = _flushInterval;
+@synthesize timeout = _timeout;
+
+- (id)initWithPath:(NSString *)path
+             error:(NSString **)error {
+    [super init];
+    _db = [[BxDatabaseConnection alloc] initWithSQLiteFile:path
+                                                   locking:YES
+                                                     error:error];
+    if (_db == nil) {
+        [self release];
+        return nil;
+    }
+    // several processes share the file, so wait on their transactions instead of failing
+    sqlite3_busy_timeout((sqlite3 *) _db.rawConnection, 5000);
+    // WAL lets sibling processes read while a flush is being written; SQLite builds
+    // without WAL support answer with their current mode and keep a persistent journal
+    NSString *journalMode = [[_db fetchRow:@"PRAGMA journal_mode=WAL"] lastObject];
+    if (! [journalMode isKindOfClass:[NSString class]] ||
+        [journalMode caseInsensitiveCompare:@"wal"] != NSOrderedSame) {
+        [_db fetchRow:@"PRAGMA journal_mode=PERSIST"];
+    }
+    [_db execute:@"PRAGMA synchronous=NORMAL"];
+    if (! [_db execute:@"CREATE TABLE IF NOT EXISTS BxSessions (cookie TEXT PRIMARY KEY, ipAddress TEXT, lastActivated REAL, state TEXT, version INTEGER NOT NULL DEFAULT 1)"] ||
+        ! [_db execute:@"CREATE INDEX IF NOT EXISTS BxSessionsLastActivated ON BxSessions (lastActivated)"]) {
+        if (error != nil && error != NULL) {
+            *error = _db.lastError;
+        }
+        [self release];
+        return nil;
+    }
+    _refreshDb = [[BxDatabaseConnection alloc] initWithSQLiteFile:path
+                                                          locking:YES
+                                                            error:error];
+    if (_refreshDb == nil) {
+        [self release];
+        return nil;
+    }
+    // a refresh is skipped rather than hold up a request while a sibling commits
+    sqlite3_busy_timeout((sqlite3 *) _refreshDb.rawConnection, 250);
+    _pendingLock = [[NSLock alloc] init];
+    _pendingSaves = [[NSMutableDictionary alloc] initWithCapacity:64];
+    _pendingTouches = [[NSMutableDictionary alloc] initWithCapacity:256];
+    _versions = [[NSMutableDictionary alloc] initWithCapacity:256];
+    _flushInterval = 1;
+    _timeout = 1800;
+    [NSThread detachNewThreadSelector:@selector(_flushThreadMain:)
+                             toTarget:self
+                           withObject:nil];
+    return self;
+}
+
+- (void)_flushThreadMain:(id)arg {
+    while (YES) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        @try {
+            [NSThread sleepForTimeInterval:_flushInterval];
+            [self flush];
+        } @catch (id exc) {
+            NSLog(@"Bombaxtic -> Exception while flushing sessions: %@", [exc description]);
+        }
+        [pool release];
+    }
+}
+
+- (NSString *)_archiveState:(NSDictionary *)state {
+    NSData *data = [NSKeyedArchiver archivedDataWithRootObject:state];
+    data = [BxUtil base64EncodeData:data];
+    return [[[NSString alloc] initWithData:data
+                                  encoding:NSASCIIStringEncoding] autorelease];
+}
+
+- (NSMutableDictionary *)_unarchiveState:(NSString *)str {
+    NSDictionary *state = nil;
+    if ([str isKindOfClass:[NSString class]] && [str length] > 0) {
+        NSData *data = [BxUtil base64DecodeData:[str dataUsingEncoding:NSASCIIStringEncoding]];
+        @try {
+            state = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+        } @catch (id exc) {
+            state = nil;
+        }
+    }
+    if ([state isKindOfClass:[NSDictionary class]]) {
+        return [[state mutableCopy] autorelease];
+    } else {
+        return [NSMutableDictionary dictionaryWithCapacity:16];
+    }
+}
+
+- (long long)_versionForCookie:(NSString *)cookie {
+    [_pendingLock lock];
+    long long version = [[_versions objectForKey:cookie] longLongValue];
+    [_pendingLock unlock];
+    return version;
+}
+
+- (void)_setVersion:(long long)version
+          forCookie:(NSString *)cookie {
+    [_pendingLock lock];
+    [_versions setObject:[NSNumber numberWithLongLong:version]
+                  forKey:cookie];
+    [_pendingLock unlock];
+}
+
+- (BOOL)addSession:(BxSession *)session {
+    NSString *lastActivated = [NSString stringWithFormat:@"%f", session.lastActivated];
+    NSString *state = [self _archiveState:[[session.state copy] autorelease]];
+    if (! [_db executeWith:@"INSERT OR REPLACE INTO BxSessions (cookie, ipAddress, lastActivated, state, version) VALUES (?, ?, ?, ?, 1)",
+           session.cookie, session.ipAddress, lastActivated, state, nil]) {
+        return NO;
+    }
+    [self _setVersion:1
+            forCookie:session.cookie];
+    return YES;
+}
+
+- (BOOL)flush {
+    [_pendingLock lock];
+    NSMutableDictionary *saves = _pendingSaves;
+    NSMutableDictionary *touches = _pendingTouches;
+    _pendingSaves = [[NSMutableDictionary alloc] initWithCapacity:64];
+    _pendingTouches = [[NSMutableDictionary alloc] initWithCapacity:256];
+    [_pendingLock unlock];
+    
+    BOOL result = YES;
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    NSMutableDictionary *written = [NSMutableDictionary dictionaryWithCapacity:[saves count]];
+    [_db.recursiveLock lock];
+    [_db beginTransaction];
+    if ([saves count] > 0) {
+        // only over the version this process last saw, so a sibling's newer save is never lost
+        BxDatabaseStatement *stmt = [_db prepare:@"UPDATE BxSessions SET ipAddress=?, lastActivated=?, state=?, version=version+1 WHERE cookie=? AND version=?"];
+        for (NSString *cookie in saves) {
+            NSArray *entry = [saves objectForKey:cookie];
+            BxSession *session = [entry objectAtIndex:0];
+            long long version = [self _versionForCookie:cookie];
+            if (! [stmt executeWith:session.ipAddress,
+                   [NSString stringWithFormat:@"%f", session.lastActivated],
+                   [self _archiveState:[entry objectAtIndex:1]],
+                   cookie,
+                   [NSString stringWithFormat:@"%lld", version],
+                   nil]) {
+                result = NO;
+            } else if (sqlite3_changes((sqlite3 *) _db.rawConnection) == 1) {
+                [written setObject:[NSNumber numberWithLongLong:version + 1]
+                            forKey:cookie];
+            }
+            // otherwise changed by a sibling since it was read, or deleted, and reloaded
+            // on the next request
+        }
+        [stmt close];
+    }
+    if ([touches count] > 0) {
+        BxDatabaseStatement *stmt = [_db prepare:@"UPDATE BxSessions SET lastActivated=? WHERE cookie=? AND lastActivated<?"];
+        for (NSString *cookie in touches) {
+            if ([saves objectForKey:cookie] != nil) {
+                continue;
+            }
+            BxSession *session = [touches objectForKey:cookie];
+            NSString *lastActivated = [NSString stringWithFormat:@"%f", session.lastActivated];
+            if (! [stmt executeWith:lastActivated, cookie, lastActivated, nil]) {
+                result = NO;
+            }
+        }
+        [stmt close];
+    }
+    if (! [_db executeWith:@"DELETE FROM BxSessions WHERE lastActivated<?",
+           [NSString stringWithFormat:@"%f", now - _timeout], nil]) {
+        result = NO;
+    }
+    if (result) {
+        result = [_db commitTransaction];
+    }
+    if (result) {
+        [_pendingLock lock];
+        for (NSString *cookie in written) {
+            // removed meanwhile if the session expired
+            if ([_versions objectForKey:cookie] != nil) {
+                [_versions setObject:[written objectForKey:cookie]
+                              forKey:cookie];
+            }
+        }
+        [_pendingLock unlock];
+    } else {
+        NSLog(@"Bombaxtic -> Could not flush sessions: %@", _db.lastError);
+        [_db rollbackTransaction];
+    }
+    [_db.recursiveLock unlock];
+    [saves release];
+    [touches release];
+    return result;
+}
+
+- (BxSession *)loadSessionForCookie:(NSString *)cookie
+                            handler:(BxClientLibHandler *)handler {
+    if (cookie == nil) {
+        return nil;
+    }
+    // a cached save is newer than anything on disk
+    [_pendingLock lock];
+    BxSession *session = [[[[_pendingSaves objectForKey:cookie] objectAtIndex:0] retain] autorelease];
+    [_pendingLock unlock];
+    if (session != nil) {
+        return session;
+    }
+    NSDictionary *row = [_db fetchNamedRowWith:@"SELECT ipAddress, lastActivated, state, version FROM BxSessions WHERE cookie=?", cookie, nil];
+    if (row == nil) {
+        return nil;
+    }
+    NSTimeInterval lastActivated = [[row objectForKey:@"lastActivated"] doubleValue];
+    if (lastActivated + _timeout <= [NSDate timeIntervalSinceReferenceDate]) {
+        return nil;
+    }
+    NSString *ipAddress = [row objectForKey:@"ipAddress"];
+    if (! [ipAddress isKindOfClass:[NSString class]]) {
+        ipAddress = nil;
+    }
+    [self _setVersion:[[row objectForKey:@"version"] longLongValue]
+            forCookie:cookie];
+    return [[[BxSession alloc] _initWithCookie:cookie
+                                     ipAddress:ipAddress
+                                         state:[self _unarchiveState:[row objectForKey:@"state"]]
+                                 lastActivated:lastActivated
+                                       handler:handler] autorelease];
+}
+
+- (BOOL)refreshSession:(BxSession *)session {
+    NSString *cookie = session.cookie;
+    [_pendingLock lock];
+    NSNumber *version = [[[_versions objectForKey:cookie] retain] autorelease];
+    BOOL isSavePending = [_pendingSaves objectForKey:cookie] != nil;
+    [_pendingLock unlock];
+    if (version == nil || isSavePending) {
+        // not from this store, or a newer copy than the row is about to be written
+        return YES;
+    }
+    NSArray *row = [_refreshDb fetchRowWith:@"SELECT version, state FROM BxSessions WHERE cookie=? AND version<>?",
+                           cookie, [version stringValue], nil];
+    if (row == nil) {
+        return YES;
+    }
+    [session.state setDictionary:[self _unarchiveState:[row objectAtIndex:1]]];
+    [self _setVersion:[[row objectAtIndex:0] longLongValue]
+            forCookie:cookie];
+    return YES;
+}
+
+- (void)releaseSessionForCookie:(NSString *)cookie {
+    [_pendingLock lock];
+    [_versions removeObjectForKey:cookie];
+    [_pendingLock unlock];
+}
+
+- (BOOL)removeSessionForCookie:(NSString *)cookie {
+    [_pendingLock lock];
+    [_pendingSaves removeObjectForKey:cookie];
+    [_pendingTouches removeObjectForKey:cookie];
+    [_versions removeObjectForKey:cookie];
+    [_pendingLock unlock];
+    return [_db executeWith:@"DELETE FROM BxSessions WHERE cookie=?", cookie, nil];
+}
+
+- (BOOL)saveSession:(BxSession *)session {
+    NSArray *entry = [NSArray arrayWithObjects:session, [[session.state copy] autorelease], nil];
+    [_pendingLock lock];
+    [_pendingSaves setObject:entry
+                      forKey:session.cookie];
+    [_pendingLock unlock];
+    return YES;
+}
+
+- (BOOL)touchSession:(BxSession *)session {
+    [_pendingLock lock];
+    [_pendingTouches setObject:session
+                        forKey:session.cookie];
+    [_pendingLock unlock];
+    return YES;
+}
+
+- (void)dealloc {
+    // not likely to reach here while the flush thread is running...
+    [_db release];
+    [_refreshDb release];
+    [_pendingLock release];
+    [_pendingSaves release];
+    [_pendingTouches release];
+    [_versions release];
+    [super dealloc];
+}
+
+@end
@@ -8,11 +8,28 @@
 
 #import <Cocoa/Cocoa.h>
 
+@class BxBroadcastLog;
+@class BxClientLibClassBinding;
 @class BxClientLibHandler;
+@class BxMessageObservers;
+@class BxTransport;
 
 @interface BxSession : NSObject {
     BxClientLibHandler *_handler;
-    NSMutableDictionary *_remotedObjects;
+    NSLock *_messagesLock;
+    BxMessageObservers *_messageObservers;
+    NSMutableArray *_pendingMessages;
+    NSMutableArray *_deliveryCallbacks; // BxCallback with a pending message as its token
+    NSMutableArray *_inboundMessages; // received from the client, waiting for the observers
+    BOOL _isInboundDispatchScheduled;
+    BxTransport *_parkedTransport; // a suspended long poll waiting for messages
+    BOOL _parkedUsesWireFormat;
+    NSTimeInterval _parkedDeadline;
+    unsigned long long _broadcastCursor; // next BxBroadcastLog sequence to deliver
+    unsigned long long _droppedMessageCount;
+    NSLock *_remotedObjectsLock;
+    NSMutableDictionary *_remotedObjects; // oid -> instance created or shared for the client
+    NSMutableDictionary *_remotedObjectBindings; // oid -> BxClientLibClassBinding
     NSMutableDictionary *_state;
     NSString *_cookie;
     NSString *_ipAddress;
@@ -23,6 +40,10 @@
 @property (readonly) NSMutableDictionary *state;
 @property (readonly) NSString *cookie;
 @property (readonly) NSString *ipAddress;
+// messages sent to this session that have been dropped because its queue was full
+@property (readonly) unsigned long long droppedMessageCount;
+// messages sent to this session and not yet collected, broadcasts excluded
+@property (readonly) NSUInteger pendingMessageCount;
 @property (readonly, nonatomic) NSTimeInterval lastActivated;
 
 @end
@@ -1,5 +1,11 @@
-#import "BxSession.h"
+#import "BxSession_Private.h"
 #import "BxUtil.h"
+#import "BxBroadcastLog.h"
+#import "BxCallback.h"
+#import "BxClientLibClassBinding.h"
+#import "BxClientLibHandler.h"
+#import "BxMessage.h"
+#import "BxMessageObservers.h"
 
 @implementation BxSession
 
@@ -12,8 +18,30 @@
 @synthesize lastActivated = _lastActivated;
 
 
+- (id)_initMessages {
+    _messagesLock = [[NSLock alloc] init];
+    _messageObservers = [[BxMessageObservers alloc] init];
+    _pendingMessages = [[NSMutableArray alloc] initWithCapacity:4];
+    _deliveryCallbacks = [[NSMutableArray alloc] initWithCapacity:4];
+    _inboundMessages = [[NSMutableArray alloc] initWithCapacity:4];
+    _isInboundDispatchScheduled = NO;
+    _parkedTransport = nil;
+    _broadcastCursor = 0;
+    _droppedMessageCount = 0;
+    return self;
+}
+
+- (id)_initRemotedObjects {
+    _remotedObjectsLock = [[NSLock alloc] init];
+    _remotedObjects = [[NSMutableDictionary alloc] initWithCapacity:4];
+    _remotedObjectBindings = [[NSMutableDictionary alloc] initWithCapacity:4];
+    return self;
+}
+
 - (id)initWithIpAddress:(NSString *)ipAddress
                 handler:(BxHandler *)handler {
+    [self _initMessages];
+    [self _initRemotedObjects];
     _state = [[NSMutableDictionary alloc] initWithCapacity:16];
     _handler = [handler retain];
     _ipAddress = [ipAddress retain];
@@ -22,7 +50,340 @@
     return self;
 }
 
+- (id)_initWithCookie:(NSString *)cookie
+            ipAddress:(NSString *)ipAddress
+                state:(NSMutableDictionary *)state
+        lastActivated:(NSTimeInterval)lastActivated
+              handler:(BxHandler *)handler {
+    [self _initMessages];
+    [self _initRemotedObjects];
+    _state = [state retain];
+    _handler = [handler retain];
+    _ipAddress = [ipAddress retain];
+    _lastActivated = lastActivated;
+    _cookie = [cookie retain];
+    return self;
+}
+
+- (id)_touch:(NSTimeInterval)now {
+    _lastActivated = now;
+    return self;
+}
+
+// the lock is only held to swap the observer set, never while callbacks run
+- (id)_addMessageObserver:(BxCallback *)callback
+                     kind:(NSString *)kind
+                  batched:(BOOL)isBatched {
+    [_messagesLock lock];
+    BxMessageObservers *observers = [_messageObservers observersByAddingCallback:callback
+                                                                            kind:kind
+                                                                         batched:isBatched];
+    [_messageObservers release];
+    _messageObservers = [observers retain];
+    [_messagesLock unlock];
+    return self;
+}
+
+- (id)_removeMessageObserver:(id)observer
+                        kind:(NSString *)kind {
+    [_messagesLock lock];
+    BxMessageObservers *observers = [_messageObservers observersByRemovingTarget:observer
+                                                                            kind:kind];
+    [_messageObservers release];
+    _messageObservers = [observers retain];
+    [_messagesLock unlock];
+    return self;
+}
+
+// observer callbacks hold the session as their token, so this breaks the cycle on expiry
+- (id)_removeAllMessageObservers {
+    BxMessageObservers *observers = [[BxMessageObservers alloc] init];
+    [_messagesLock lock];
+    [_messageObservers release];
+    _messageObservers = observers;
+    [_messagesLock unlock];
+    return self;
+}
+
+- (id)_notifyMessageObservers:(NSArray *)messages
+                   dispatcher:(BxMessageDispatcher *)dispatcher {
+    [_messagesLock lock];
+    BxMessageObservers *observers = [_messageObservers retain];
+    [_messagesLock unlock];
+    [observers invokeWithMessages:messages
+                       dispatcher:dispatcher];
+    [observers release];
+    return self;
+}
+
+// NO if the queue is full and the policy is to invalidate the session; scheduling is set to YES if
+// the caller must schedule a dispatch, of which only one is ever outstanding so messages stay in order
+- (BOOL)_addInboundMessage:(BxMessage *)message
+                     limit:(NSUInteger)limit
+                    policy:(BxPendingMessagePolicy)policy
+                   dropped:(NSUInteger *)dropped
+                scheduling:(BOOL *)isScheduling {
+    *isScheduling = NO;
+    [_messagesLock lock];
+    BOOL isQueued = [self _makeRoomInQueue:_inboundMessages
+                                forMessage:message
+                                     limit:limit
+                                    policy:policy
+                                   dropped:dropped];
+    if (isQueued) {
+        [_inboundMessages addObject:message];
+        *isScheduling = ! _isInboundDispatchScheduled;
+        _isInboundDispatchScheduled = YES;
+    }
+    [_messagesLock unlock];
+    return isQueued || policy != BxPendingMessagePolicyInvalidateSession;
+}
+
+// nil once the inbound queue is empty, at which point the next message schedules a new dispatch
+- (NSArray *)_takeInboundMessages {
+    NSArray *messages = nil;
+    [_messagesLock lock];
+    if ([_inboundMessages count] > 0) {
+        messages = [_inboundMessages autorelease];
+        _inboundMessages = [[NSMutableArray alloc] initWithCapacity:4];
+    } else {
+        _isInboundDispatchScheduled = NO;
+    }
+    [_messagesLock unlock];
+    return messages;
+}
+
+// must be called with _messagesLock held
+- (NSUInteger)_indexOfOldestMessageOfKind:(NSString *)kind
+                                  inQueue:(NSArray *)queue {
+    NSUInteger count = [queue count];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSString *pendingKind = [[queue objectAtIndex:i] kind];
+        if (pendingKind == kind || [pendingKind isEqualToString:kind]) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// must be called with _messagesLock held; a dropped message is never delivered
+- (void)_removePendingMessageAtIndex:(NSUInteger)index {
+    BxMessage *message = [_pendingMessages objectAtIndex:index];
+    NSUInteger count = [_deliveryCallbacks count];
+    for (NSUInteger i = 0; i < count; i++) {
+        if ([[_deliveryCallbacks objectAtIndex:i] token] == message) {
+            [_deliveryCallbacks removeObjectAtIndex:i];
+            break;
+        }
+    }
+    [_pendingMessages removeObjectAtIndex:index];
+}
+
+// must be called with _messagesLock held; NO if the message is not to be queued, dropped is set to 0 or 1
+- (BOOL)_makeRoomInQueue:(NSMutableArray *)queue
+              forMessage:(BxMessage *)message
+                   limit:(NSUInteger)limit
+                  policy:(BxPendingMessagePolicy)policy
+                 dropped:(NSUInteger *)dropped {
+    BOOL isQueued = YES;
+    *dropped = 0;
+    if (limit > 0 && [queue count] >= limit) {
+        NSUInteger index = 0;
+        if (policy == BxPendingMessagePolicyInvalidateSession) {
+            return NO;
+        } else if (policy == BxPendingMessagePolicyDropNewest) {
+            isQueued = NO;
+        } else if (policy == BxPendingMessagePolicyCoalesceByKind) {
+            index = [self _indexOfOldestMessageOfKind:message.kind
+                                              inQueue:queue];
+        }
+        if (isQueued && queue == _pendingMessages) {
+            [self _removePendingMessageAtIndex:index];
+        } else if (isQueued) {
+            [queue removeObjectAtIndex:index];
+        }
+        *dropped = 1;
+        _droppedMessageCount++;
+    }
+    return isQueued;
+}
+
+// NO if the queue is full and the policy is to invalidate the session; dropped is set to 0 or 1
+- (BOOL)_enqueueMessage:(BxMessage *)message
+               callback:(BxCallback *)callback
+                  limit:(NSUInteger)limit
+                 policy:(BxPendingMessagePolicy)policy
+                dropped:(NSUInteger *)dropped {
+    [_messagesLock lock];
+    BOOL isQueued = [self _makeRoomInQueue:_pendingMessages
+                                forMessage:message
+                                     limit:limit
+                                    policy:policy
+                                   dropped:dropped];
+    if (isQueued) {
+        [_pendingMessages addObject:message];
+        if (callback) {
+            [_deliveryCallbacks addObject:callback];
+        }
+    }
+    BOOL hasParkedTransport = _parkedTransport != nil;
+    [_messagesLock unlock];
+    if (isQueued && hasParkedTransport) {
+        [_handler _completeLongPollForSession:self];
+    }
+    return isQueued || policy != BxPendingMessagePolicyInvalidateSession;
+}
+
+- (id)_removeAllPendingMessages {
+    [_messagesLock lock];
+    [_pendingMessages removeAllObjects];
+    [_deliveryCallbacks removeAllObjects];
+    [_messagesLock unlock];
+    return self;
+}
+
+- (unsigned long long)droppedMessageCount {
+    [_messagesLock lock];
+    unsigned long long droppedMessageCount = _droppedMessageCount;
+    [_messagesLock unlock];
+    return droppedMessageCount;
+}
+
+- (NSUInteger)pendingMessageCount {
+    [_messagesLock lock];
+    NSUInteger pendingMessageCount = [_pendingMessages count];
+    [_messagesLock unlock];
+    return pendingMessageCount;
+}
+
+// NO if messages are already waiting or another poll is parked, so the caller answers at once
+- (BOOL)_parkTransport:(BxTransport *)transport
+            wireFormat:(BOOL)useWireFormat
+              deadline:(NSTimeInterval)deadline
+          broadcastLog:(BxBroadcastLog *)broadcastLog {
+    BOOL isParked = NO;
+    [_messagesLock lock];
+    if ([_pendingMessages count] == 0 && _parkedTransport == nil &&
+        ! [broadcastLog hasMessagesFromCursor:_broadcastCursor]) {
+        _parkedTransport = [transport retain];
+        _parkedUsesWireFormat = useWireFormat;
+        _parkedDeadline = deadline;
+        isParked = YES;
+    }
+    [_messagesLock unlock];
+    return isParked;
+}
+
+// returns a retained transport if one is parked with a deadline at or before time
+- (BxTransport *)_takeParkedTransport:(BOOL *)useWireFormat
+                                dueBy:(NSTimeInterval)time {
+    BxTransport *transport = nil;
+    [_messagesLock lock];
+    if (_parkedTransport && _parkedDeadline <= time) {
+        transport = _parkedTransport;
+        *useWireFormat = _parkedUsesWireFormat;
+        _parkedTransport = nil;
+    }
+    [_messagesLock unlock];
+    return transport;
+}
+
+- (BOOL)_isParked {
+    [_messagesLock lock];
+    BOOL isParked = _parkedTransport != nil;
+    [_messagesLock unlock];
+    return isParked;
+}
+
+- (id)_setBroadcastCursor:(unsigned long long)broadcastCursor {
+    [_messagesLock lock];
+    _broadcastCursor = broadcastCursor;
+    [_messagesLock unlock];
+    return self;
+}
+
+- (BOOL)_hasBroadcastsInLog:(BxBroadcastLog *)broadcastLog {
+    [_messagesLock lock];
+    BOOL hasBroadcasts = [broadcastLog hasMessagesFromCursor:_broadcastCursor];
+    [_messagesLock unlock];
+    return hasBroadcasts;
+}
+
+// broadcast messages since the last delivery followed by messages sent to this session;
+// callbacks is set to the delivery callbacks of the dequeued messages, or nil
+- (NSArray *)_dequeueMessagesWithBroadcastLog:(BxBroadcastLog *)broadcastLog
+                                   overflowed:(BOOL *)overflowed
+                                    callbacks:(NSArray **)callbacks {
+    NSMutableArray *messages = nil;
+    [_messagesLock lock];
+    // every pending message is dequeued below, so all of their callbacks go with them
+    if ([_deliveryCallbacks count] > 0) {
+        *callbacks = [_deliveryCallbacks autorelease];
+        _deliveryCallbacks = [[NSMutableArray alloc] initWithCapacity:4];
+    } else {
+        *callbacks = nil;
+    }
+    NSArray *broadcastMessages = [broadcastLog messagesFromCursor:&_broadcastCursor
+                                                       overflowed:overflowed];
+    if (broadcastMessages) {
+        messages = [NSMutableArray arrayWithArray:broadcastMessages];
+        [messages addObjectsFromArray:_pendingMessages];
+        [_pendingMessages removeAllObjects];
+    } else if ([_pendingMessages count] > 0) {
+        messages = [_pendingMessages autorelease];
+        _pendingMessages = [[NSMutableArray alloc] initWithCapacity:4];
+    }
+    [_messagesLock unlock];
+    return messages;
+}
+
+- (NSString *)_addRemotedObject:(id)object
+                        binding:(BxClientLibClassBinding *)binding {
+    NSString *oid = [BxUtil randomAlphaNumericString:16];
+    [_remotedObjectsLock lock];
+    [_remotedObjects setObject:object
+                        forKey:oid];
+    [_remotedObjectBindings setObject:binding
+                               forKey:oid];
+    [_remotedObjectsLock unlock];
+    return oid;
+}
+
+- (id)_remotedObjectForOid:(NSString *)oid
+                   binding:(BxClientLibClassBinding **)binding {
+    [_remotedObjectsLock lock];
+    id object = [[_remotedObjects objectForKey:oid] retain];
+    *binding = [[[_remotedObjectBindings objectForKey:oid] retain] autorelease];
+    [_remotedObjectsLock unlock];
+    return [object autorelease];
+}
+
+- (id)_removeRemotedObjectForOid:(NSString *)oid {
+    [_remotedObjectsLock lock];
+    [_remotedObjects removeObjectForKey:oid];
+    [_remotedObjectBindings removeObjectForKey:oid];
+    [_remotedObjectsLock unlock];
+    return self;
+}
+
+- (id)_removeAllRemotedObjects {
+    [_remotedObjectsLock lock];
+    [_remotedObjects removeAllObjects];
+    [_remotedObjectBindings removeAllObjects];
+    [_remotedObjectsLock unlock];
+    return self;
+}
+
 - (void)dealloc {
+    [_remotedObjectsLock release];
+    [_remotedObjects release];
+    [_remotedObjectBindings release];
+    [_messagesLock release];
+    [_messageObservers release];
+    [_pendingMessages release];
+    [_deliveryCallbacks release];
+    [_inboundMessages release];
+    [_parkedTransport release];
     [_state release];
     [_handler release];
     [_ipAddress release];
@@ -0,0 +1,72 @@
+/**
+ \brief Stores BxSession state in the session cookie itself, authenticated with HMAC-SHA256
+ \class BxSessionCookieSigner
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ When a signer is given to BxClientLibHandler, sessions are no longer kept in a server side
+ table.  The session identifier, IP address, last activity time and state dictionary are
+ written as a binary property list into the cookie on every response and verified on every
+ request, so any process may serve any client without a lookup or a lock.  Since the state
+ travels with each request, it should be kept small and may only contain property list
+ objects (NSString, NSNumber, NSDate, NSData, NSArray and NSDictionary).  The state is
+ signed but not encrypted and is visible to the client.
+ 
+ Cookies are signed with the most recently added key.  Earlier keys are kept to verify
+ cookies issued before a rotation until they are removed.  Key identifiers must not contain
+ a period.
+ 
+ Each request gets its own BxSession instance, so session message observers and messages
+ queued with BxClientLibHandler sendMessage:toSession: only apply to the current request, and
+ broadcastMessage: only reaches sessions with a server side table.  Remote objects live in
+ the server side session as well, so BxClientLib remote object requests are answered with
+ an error while a signer is in use.
+ 
+ Example of rotating keys:
+ \code
+ BxSessionCookieSigner *signer = [[BxSessionCookieSigner alloc] initWithKey:oldKey
+                                                                      keyId:@"1"];
+ [signer addKey:newKey
+          keyId:@"2"];
+ [BxClientLibHandler setSessionCookieSigner:signer];
+ [signer release];
+ ...
+ // once every cookie signed with "1" has expired
+ [signer removeKeyId:@"1"];
+ \endcode
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+
+@class BxClientLibHandler;
+@class BxSession;
+
+@interface BxSessionCookieSigner : NSObject {
+    NSLock *_keysLock;
+    NSMutableDictionary *_keys; // key id -> NSData
+    NSString *_currentKeyId;
+    NSUInteger _maxCookieLength;
+}
+
+- (id)initWithKey:(NSData *)key
+            keyId:(NSString *)keyId;
+
+// the new key signs from now on; previous keys still verify
+- (BxSessionCookieSigner *)addKey:(NSData *)key
+                            keyId:(NSString *)keyId;
+
+- (BxSessionCookieSigner *)removeKeyId:(NSString *)keyId;
+
+// nil if the state cannot be written as a property list or the cookie exceeds maxCookieLength
+- (NSString *)cookieForSession:(BxSession *)session;
+
+// nil if the cookie is malformed, forged, signed with an unknown key or idle longer than timeout
+- (BxSession *)sessionForCookie:(NSString *)cookie
+                        handler:(BxClientLibHandler *)handler
+                        timeout:(NSTimeInterval)timeout;
+
+// defaults to 4000, leaving room in the 4096 bytes browsers allow for the cookie attributes
+@property (assign) NSUInteger maxCookieLength;
+
+@end
@@ -0,0 +1,159 @@
+#import "BxSessionCookieSigner.h"
+#import "BxSession_Private.h"
+#import "BxUtil.h"
+
+@implementation BxSessionCookieSigner
+
+@synthesize maxCookieLength = _maxCookieLength;
+
+- (id)initWithKey:(NSData *)key
+            keyId:(NSString *)keyId {
+    [super init];
+    _keysLock = [[NSLock alloc] init];
+    _keys = [[NSMutableDictionary alloc] initWithCapacity:4];
+    _currentKeyId = nil;
+    _maxCookieLength = 4000;
+    [self addKey:key
+           keyId:keyId];
+    return self;
+}
+
+- (BxSessionCookieSigner *)addKey:(NSData *)key
+                            keyId:(NSString *)keyId {
+    [_keysLock lock];
+    [_keys setObject:[[key copy] autorelease]
+              forKey:keyId];
+    if (_currentKeyId) {
+        [_currentKeyId release];
+    }
+    _currentKeyId = [keyId copy];
+    [_keysLock unlock];
+    return self;
+}
+
+- (BxSessionCookieSigner *)removeKeyId:(NSString *)keyId {
+    [_keysLock lock];
+    if (! [keyId isEqualToString:_currentKeyId]) {
+        [_keys removeObjectForKey:keyId];
+    }
+    [_keysLock unlock];
+    return self;
+}
+
+static BOOL _BX_isEqualDigest(NSData *a, NSData *b) {
+    if ([a length] != [b length]) {
+        return NO;
+    }
+    // compare every byte so the time taken does not reveal how much of a forged MAC matched
+    const unsigned char *aBytes = [a bytes];
+    const unsigned char *bBytes = [b bytes];
+    unsigned char diff = 0;
+    for (NSUInteger i = 0; i < [a length]; i++) {
+        diff |= aBytes[i] ^ bBytes[i];
+    }
+    return diff == 0;
+}
+
+- (NSString *)cookieForSession:(BxSession *)session {
+    NSArray *plist = [NSArray arrayWithObjects:
+                      session.cookie,
+                      session.ipAddress ? session.ipAddress : @"",
+                      [NSNumber numberWithDouble:session.lastActivated],
+                      session.state,
+                      nil];
+    NSString *errorDesc = nil;
+    NSData *payload = [NSPropertyListSerialization dataFromPropertyList:plist
+                                                                 format:NSPropertyListBinaryFormat_v1_0
+                                                       errorDescription:&errorDesc];
+    if (payload == nil) {
+        NSLog(@"Bombaxtic -> Session state cannot be stored in a cookie: %@", errorDesc);
+        [errorDesc release];
+        return nil;
+    }
+    [_keysLock lock];
+    NSString *keyId = [[_currentKeyId retain] autorelease];
+    NSData *key = [[[_keys objectForKey:keyId] retain] autorelease];
+    [_keysLock unlock];
+    NSString *signedPart = [NSString stringWithFormat:@"%@.%@", keyId, [BxUtil base64URLEncodeData:payload]];
+    NSData *mac = [BxUtil hmacSHA256Data:[signedPart dataUsingEncoding:NSUTF8StringEncoding]
+                                     key:key];
+    NSString *cookie = [NSString stringWithFormat:@"%@.%@", signedPart, [BxUtil base64URLEncodeData:mac]];
+    if ([cookie length] > _maxCookieLength) {
+        NSLog(@"Bombaxtic -> Session state too large for a cookie: %lu bytes", (unsigned long) [cookie length]);
+        return nil;
+    }
+    return cookie;
+}
+
+- (BxSession *)sessionForCookie:(NSString *)cookie
+                        handler:(BxClientLibHandler *)handler
+                        timeout:(NSTimeInterval)timeout {
+    if (cookie == nil || [cookie length] > _maxCookieLength) {
+        return nil;
+    }
+    NSArray *parts = [cookie componentsSeparatedByString:@"."];
+    if ([parts count] != 3) {
+        return nil;
+    }
+    NSString *keyId = [parts objectAtIndex:0];
+    [_keysLock lock];
+    NSData *key = [[[_keys objectForKey:keyId] retain] autorelease];
+    [_keysLock unlock];
+    if (key == nil) {
+        return nil;
+    }
+    NSString *signedPart = [NSString stringWithFormat:@"%@.%@", keyId, [parts objectAtIndex:1]];
+    NSData *mac = [BxUtil hmacSHA256Data:[signedPart dataUsingEncoding:NSUTF8StringEncoding]
+                                     key:key];
+    NSData *givenMac = [BxUtil base64URLDecodeString:[parts objectAtIndex:2]];
+    if (givenMac == nil || ! _BX_isEqualDigest(mac, givenMac)) {
+        return nil;
+    }
+    
+    // only authenticated payloads reach the property list parser
+    NSData *payload = [BxUtil base64URLDecodeString:[parts objectAtIndex:1]];
+    if (payload == nil) {
+        return nil;
+    }
+    NSString *errorDesc = nil;
+    NSArray *plist = [NSPropertyListSerialization propertyListFromData:payload
+                                                      mutabilityOption:NSPropertyListMutableContainers
+                                                                format:NULL
+                                                      errorDescription:&errorDesc];
+    if (errorDesc) {
+        [errorDesc release];
+    }
+    if (! [plist isKindOfClass:[NSArray class]] || [plist count] != 4) {
+        return nil;
+    }
+    NSString *sessionId = [plist objectAtIndex:0];
+    NSString *ipAddress = [plist objectAtIndex:1];
+    NSNumber *lastActivated = [plist objectAtIndex:2];
+    NSMutableDictionary *state = [plist objectAtIndex:3];
+    if (! [sessionId isKindOfClass:[NSString class]] ||
+        ! [ipAddress isKindOfClass:[NSString class]] ||
+        ! [lastActivated isKindOfClass:[NSNumber class]] ||
+        ! [state isKindOfClass:[NSMutableDictionary class]]) {
+        return nil;
+    }
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    if ([lastActivated doubleValue] + timeout <= now) {
+        return nil;
+    }
+    return [[[BxSession alloc] _initWithCookie:sessionId
+                                     ipAddress:ipAddress
+                                         state:state
+                                 lastActivated:now
+                                       handler:handler] autorelease];
+}
+
+- (void)dealloc {
+    [_keysLock release];
+    [_keys release];
+    if (_currentKeyId) {
+        [_currentKeyId release];
+    }
+    [super dealloc];
+}
+
+@end
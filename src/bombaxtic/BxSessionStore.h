@@ -0,0 +1,49 @@
+/**
+ \brief Persistence for BxSession instances shared between BxApp processes
+ \class BxSessionStore
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ A session store is consulted by BxClientLibHandler whenever a session cookie is not
+ known to the current process, which allows a location with several processes to use
+ round robin load balancing.  Implementations are expected to cache writes locally and
+ must be safe to call from multiple request threads.
+
+ A session that is already known to the current process is passed to \c refreshSession:
+ on every request, so that state saved by a sibling process replaces the local copy.  A
+ save made from a copy that has since been replaced by a sibling is discarded instead of
+ overwriting the newer state.
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+
+@class BxClientLibHandler;
+@class BxSession;
+
+@protocol BxSessionStore
+
+// written through immediately so that sibling processes see new sessions at once
+- (BOOL)addSession:(BxSession *)session;
+
+// returns nil if the cookie is unknown or the session has been idle longer than timeout
+- (BxSession *)loadSessionForCookie:(NSString *)cookie
+                            handler:(BxClientLibHandler *)handler;
+
+// the session is no longer held by this process, but stays stored for its siblings
+- (void)releaseSessionForCookie:(NSString *)cookie;
+
+- (BOOL)removeSessionForCookie:(NSString *)cookie;
+
+// reloads the state if a sibling process has saved a newer version since it was read
+- (BOOL)refreshSession:(BxSession *)session;
+
+// state and lastActivated
+- (BOOL)saveSession:(BxSession *)session;
+
+// lastActivated only
+- (BOOL)touchSession:(BxSession *)session;
+
+@property (assign) NSTimeInterval timeout;
+
+@end
@@ -0,0 +1,64 @@
+/**
+ \brief TBD
+ \class BxSessionTable
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+
+ */
+
+#import <Cocoa/Cocoa.h>
+
+@class BxCallback;
+@class BxSession;
+
+#define BX_SESSION_TABLE_SHARDS 16
+#define BX_SESSION_WHEEL_LEVELS 3
+#define BX_SESSION_WHEEL_BITS 6
+#define BX_SESSION_WHEEL_SLOTS (1 << BX_SESSION_WHEEL_BITS)
+
+/*
+ Sessions are indexed by cookie across BX_SESSION_TABLE_SHARDS independently locked
+ dictionaries so that a lookup only ever holds one shard lock for a single hash probe.
+
+ Expiry is driven by a hierarchical timer wheel with one second ticks, advanced by a
+ background thread.  Touching a session only updates its lastActivated time; when the
+ session's slot comes due it is either expired or rescheduled for its remaining time.
+ */
+@interface BxSessionTable : NSObject {
+    NSLock *_shardLocks[BX_SESSION_TABLE_SHARDS];
+    NSMutableDictionary *_shards[BX_SESSION_TABLE_SHARDS]; // cookie -> BxSession
+    NSLock *_wheelLock;
+    NSMutableArray *_wheel[BX_SESSION_WHEEL_LEVELS][BX_SESSION_WHEEL_SLOTS];
+    unsigned long long _currentTick;
+    NSTimeInterval _wheelStart;
+    NSTimeInterval _timeout;
+    BxCallback *_expiryCallback;
+}
+
+- (id)initWithTimeout:(NSTimeInterval)timeout;
+
+- (BxSessionTable *)addSession:(BxSession *)session;
+
+// returns the session already indexed under the same cookie, if any, instead of replacing it
+- (BxSession *)addSessionIfAbsent:(BxSession *)session;
+
+- (NSArray *)allSessions;
+
+- (NSUInteger)count;
+
+- (BxSessionTable *)removeSession:(BxSession *)session;
+
+// neither touches the session nor checks the ip address
+- (BxSession *)sessionForCookie:(NSString *)cookie;
+
+// touches the session on success
+- (BxSession *)sessionForCookie:(NSString *)cookie
+                      ipAddress:(NSString *)ipAddress;
+
+// callback session:
+- (BxSessionTable *)setExpiryCallback:(SEL)selector
+                               target:(id)target;
+
+@property (assign) NSTimeInterval timeout;
+
+@end
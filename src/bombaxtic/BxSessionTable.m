@@ -0,0 +1,260 @@
+#import "BxSessionTable.h"
+#import "BxCallback.h"
+#import "BxSession_Private.h"
+
+// the furthest a session may be scheduled ahead; anything later is rescheduled when it comes due
+#define BX_SESSION_WHEEL_MAX_DELTA ((1ULL << (BX_SESSION_WHEEL_BITS * BX_SESSION_WHEEL_LEVELS)) - \
+                                    (1ULL << (BX_SESSION_WHEEL_BITS * (BX_SESSION_WHEEL_LEVELS - 1))))
+
+@implementation BxSessionTable
+
+@synthesize timeout = _timeout;
+
+static inline NSUInteger _BX_shardForCookie(NSString *cookie) {
+    return [cookie hash] & (BX_SESSION_TABLE_SHARDS - 1);
+}
+
+- (id)initWithTimeout:(NSTimeInterval)timeout {
+    [super init];
+    for (int i = 0; i < BX_SESSION_TABLE_SHARDS; i++) {
+        _shardLocks[i] = [[NSLock alloc] init];
+        _shards[i] = [[NSMutableDictionary alloc] initWithCapacity:64];
+    }
+    _wheelLock = [[NSLock alloc] init];
+    for (int level = 0; level < BX_SESSION_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < BX_SESSION_WHEEL_SLOTS; slot++) {
+            _wheel[level][slot] = [[NSMutableArray alloc] initWithCapacity:4];
+        }
+    }
+    _currentTick = 0;
+    _wheelStart = [NSDate timeIntervalSinceReferenceDate];
+    _timeout = timeout;
+    _expiryCallback = nil;
+    [NSThread detachNewThreadSelector:@selector(_wheelThreadMain:)
+                             toTarget:self
+                           withObject:nil];
+    return self;
+}
+
+// must be called with _wheelLock held
+- (void)_scheduleSession:(BxSession *)session {
+    NSTimeInterval deadline = session.lastActivated + _timeout - _wheelStart;
+    unsigned long long expireTick = deadline > 0 ? (unsigned long long) ceil(deadline) : 0;
+    if (expireTick <= _currentTick) {
+        expireTick = _currentTick + 1;
+    } else if (expireTick - _currentTick > BX_SESSION_WHEEL_MAX_DELTA) {
+        expireTick = _currentTick + BX_SESSION_WHEEL_MAX_DELTA;
+    }
+    unsigned long long delta = expireTick - _currentTick;
+    int level = 0;
+    while (level < BX_SESSION_WHEEL_LEVELS - 1 &&
+           delta >= (1ULL << (BX_SESSION_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    NSUInteger slot = (expireTick >> (BX_SESSION_WHEEL_BITS * level)) & (BX_SESSION_WHEEL_SLOTS - 1);
+    [_wheel[level][slot] addObject:session];
+}
+
+- (NSMutableArray *)_takeSlot:(NSUInteger)slot
+                        level:(int)level {
+    NSMutableArray *entries = _wheel[level][slot];
+    _wheel[level][slot] = [[NSMutableArray alloc] initWithCapacity:4];
+    return entries;
+}
+
+- (void)_expireDueSessions:(NSArray *)sessions {
+    for (BxSession *session in sessions) {
+        NSUInteger shard = _BX_shardForCookie(session.cookie);
+        NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+        BOOL isPresent;
+        BOOL isExpired = NO;
+        [_shardLocks[shard] lock];
+        isPresent = [_shards[shard] objectForKey:session.cookie] == session;
+        if (isPresent && session.lastActivated + _timeout <= now) {
+            [_shards[shard] removeObjectForKey:session.cookie];
+            isExpired = YES;
+        }
+        [_shardLocks[shard] unlock];
+        if (isExpired) {
+            if (_expiryCallback) {
+                [_expiryCallback invokeWith:session];
+            }
+        } else if (isPresent) {
+            // touched since it was scheduled
+            [_wheelLock lock];
+            [self _scheduleSession:session];
+            [_wheelLock unlock];
+        }
+    }
+}
+
+- (void)_advanceToTick:(unsigned long long)targetTick {
+    while (_currentTick < targetTick) {
+        [_wheelLock lock];
+        _currentTick++;
+        [_wheelLock unlock];
+        for (int level = BX_SESSION_WHEEL_LEVELS - 1; level > 0; level--) {
+            if ((_currentTick & ((1ULL << (BX_SESSION_WHEEL_BITS * level)) - 1)) == 0) {
+                NSUInteger slot = (_currentTick >> (BX_SESSION_WHEEL_BITS * level)) & (BX_SESSION_WHEEL_SLOTS - 1);
+                [_wheelLock lock];
+                NSMutableArray *entries = [self _takeSlot:slot
+                                                    level:level];
+                [_wheelLock unlock];
+                // cascade one entry at a time so request threads adding sessions never wait on a whole slot
+                for (BxSession *session in entries) {
+                    [_wheelLock lock];
+                    [self _scheduleSession:session];
+                    [_wheelLock unlock];
+                }
+                [entries release];
+            }
+        }
+        [_wheelLock lock];
+        NSMutableArray *due = [self _takeSlot:_currentTick & (BX_SESSION_WHEEL_SLOTS - 1)
+                                        level:0];
+        [_wheelLock unlock];
+        [self _expireDueSessions:due];
+        [due release];
+    }
+}
+
+- (void)_wheelThreadMain:(id)arg {
+    while (YES) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        @try {
+            [NSThread sleepForTimeInterval:1];
+            NSTimeInterval elapsed = [NSDate timeIntervalSinceReferenceDate] - _wheelStart;
+            if (elapsed > 0) {
+                [self _advanceToTick:(unsigned long long) elapsed];
+            }
+        } @catch (id exc) {
+            NSLog(@"Bombaxtic -> Exception while expiring sessions: %@", [exc description]);
+        }
+        [pool release];
+    }
+}
+
+- (BxSessionTable *)addSession:(BxSession *)session {
+    NSUInteger shard = _BX_shardForCookie(session.cookie);
+    [_shardLocks[shard] lock];
+    [_shards[shard] setObject:session
+                       forKey:session.cookie];
+    [_shardLocks[shard] unlock];
+    [_wheelLock lock];
+    [self _scheduleSession:session];
+    [_wheelLock unlock];
+    return self;
+}
+
+- (BxSession *)addSessionIfAbsent:(BxSession *)session {
+    NSUInteger shard = _BX_shardForCookie(session.cookie);
+    [_shardLocks[shard] lock];
+    BxSession *existing = [[[_shards[shard] objectForKey:session.cookie] retain] autorelease];
+    if (existing == nil) {
+        [_shards[shard] setObject:session
+                           forKey:session.cookie];
+    }
+    [_shardLocks[shard] unlock];
+    if (existing != nil) {
+        return existing;
+    }
+    [_wheelLock lock];
+    [self _scheduleSession:session];
+    [_wheelLock unlock];
+    return session;
+}
+
+- (NSArray *)allSessions {
+    NSMutableArray *sessions = [NSMutableArray arrayWithCapacity:[self count]];
+    for (int i = 0; i < BX_SESSION_TABLE_SHARDS; i++) {
+        [_shardLocks[i] lock];
+        [sessions addObjectsFromArray:[_shards[i] allValues]];
+        [_shardLocks[i] unlock];
+    }
+    return sessions;
+}
+
+- (NSUInteger)count {
+    NSUInteger count = 0;
+    for (int i = 0; i < BX_SESSION_TABLE_SHARDS; i++) {
+        [_shardLocks[i] lock];
+        count += [_shards[i] count];
+        [_shardLocks[i] unlock];
+    }
+    return count;
+}
+
+- (BxSessionTable *)removeSession:(BxSession *)session {
+    NSUInteger shard = _BX_shardForCookie(session.cookie);
+    [_shardLocks[shard] lock];
+    if ([_shards[shard] objectForKey:session.cookie] == session) {
+        [_shards[shard] removeObjectForKey:session.cookie];
+    }
+    [_shardLocks[shard] unlock];
+    // the wheel drops the session when its slot comes due
+    return self;
+}
+
+- (BxSession *)sessionForCookie:(NSString *)cookie {
+    NSUInteger shard = _BX_shardForCookie(cookie);
+    [_shardLocks[shard] lock];
+    BxSession *session = [[_shards[shard] objectForKey:cookie] retain];
+    [_shardLocks[shard] unlock];
+    return [session autorelease];
+}
+
+- (BxSession *)sessionForCookie:(NSString *)cookie
+                      ipAddress:(NSString *)ipAddress {
+    if (cookie == nil) {
+        return nil;
+    }
+    NSUInteger shard = _BX_shardForCookie(cookie);
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    [_shardLocks[shard] lock];
+    BxSession *session = [_shards[shard] objectForKey:cookie];
+    if (session) {
+        if (session.lastActivated + _timeout <= now ||
+            ! [session.ipAddress isEqualToString:ipAddress]) {
+            session = nil;
+        } else {
+            [session _touch:now];
+            [session retain];
+        }
+    }
+    [_shardLocks[shard] unlock];
+    return [session autorelease];
+}
+
+- (BxSessionTable *)setExpiryCallback:(SEL)selector
+                               target:(id)target {
+    BxCallback *callback = nil;
+    if (target) {
+        callback = [[BxCallback alloc] initWithSelector:selector
+                                                 target:target];
+    }
+    if (_expiryCallback) {
+        [_expiryCallback release];
+    }
+    _expiryCallback = callback;
+    return self;
+}
+
+- (void)dealloc {
+    // not likely to reach here while the wheel thread is running...
+    for (int i = 0; i < BX_SESSION_TABLE_SHARDS; i++) {
+        [_shardLocks[i] release];
+        [_shards[i] release];
+    }
+    for (int level = 0; level < BX_SESSION_WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < BX_SESSION_WHEEL_SLOTS; slot++) {
+            [_wheel[level][slot] release];
+        }
+    }
+    [_wheelLock release];
+    if (_expiryCallback) {
+        [_expiryCallback release];
+    }
+    [super dealloc];
+}
+
+@end
@@ -0,0 +1,75 @@
+/**
+ \brief Methods of BxSession used by BxClientLibHandler and the session stores
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ Not part of the public API.  Anything that calls these must import this header so that
+ the compiler knows their return types.
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+#import <Bombaxtic/BxClientLibHandler.h>
+#import <Bombaxtic/BxSession.h>
+
+@class BxBroadcastLog;
+@class BxCallback;
+@class BxClientLibClassBinding;
+@class BxHandler;
+@class BxMessage;
+@class BxMessageDispatcher;
+@class BxTransport;
+
+@interface BxSession (Private)
+
+- (id)_initWithCookie:(NSString *)cookie
+            ipAddress:(NSString *)ipAddress
+                state:(NSMutableDictionary *)state
+        lastActivated:(NSTimeInterval)lastActivated
+              handler:(BxHandler *)handler;
+- (id)_touch:(NSTimeInterval)now;
+
+- (id)_addMessageObserver:(BxCallback *)callback
+                     kind:(NSString *)kind
+                  batched:(BOOL)isBatched;
+- (id)_removeMessageObserver:(id)observer
+                        kind:(NSString *)kind;
+- (id)_removeAllMessageObservers;
+- (id)_notifyMessageObservers:(NSArray *)messages
+                   dispatcher:(BxMessageDispatcher *)dispatcher;
+
+- (BOOL)_addInboundMessage:(BxMessage *)message
+                     limit:(NSUInteger)limit
+                    policy:(BxPendingMessagePolicy)policy
+                   dropped:(NSUInteger *)dropped
+                scheduling:(BOOL *)isScheduling;
+- (NSArray *)_takeInboundMessages;
+
+- (BOOL)_enqueueMessage:(BxMessage *)message
+               callback:(BxCallback *)callback
+                  limit:(NSUInteger)limit
+                 policy:(BxPendingMessagePolicy)policy
+                dropped:(NSUInteger *)dropped;
+- (id)_removeAllPendingMessages;
+- (NSArray *)_dequeueMessagesWithBroadcastLog:(BxBroadcastLog *)broadcastLog
+                                   overflowed:(BOOL *)overflowed
+                                    callbacks:(NSArray **)callbacks;
+
+- (BOOL)_parkTransport:(BxTransport *)transport
+            wireFormat:(BOOL)useWireFormat
+              deadline:(NSTimeInterval)deadline
+          broadcastLog:(BxBroadcastLog *)broadcastLog;
+- (BxTransport *)_takeParkedTransport:(BOOL *)useWireFormat
+                                dueBy:(NSTimeInterval)time;
+- (BOOL)_isParked;
+- (id)_setBroadcastCursor:(unsigned long long)broadcastCursor;
+- (BOOL)_hasBroadcastsInLog:(BxBroadcastLog *)broadcastLog;
+
+- (NSString *)_addRemotedObject:(id)object
+                        binding:(BxClientLibClassBinding *)binding;
+- (id)_remotedObjectForOid:(NSString *)oid
+                   binding:(BxClientLibClassBinding **)binding;
+- (id)_removeRemotedObjectForOid:(NSString *)oid;
+- (id)_removeAllRemotedObjects;
+
+@end
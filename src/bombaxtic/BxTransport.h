@@ -49,6 +49,7 @@
 
 @interface BxTransport : NSObject {
     BOOL _isClosed;
+    BOOL _isSuspended;
     NSMutableArray *_uploadedFiles;
     NSMutableData *_rawPostData;
     NSMutableDictionary *_postVars;
@@ -68,6 +69,10 @@
      place, this variable is set and no new headers will be written. */
     BOOL _hasWrittenHeaders;
     
+    /* Set once the request thread has handed the FastCGI request over to a suspended
+     transport, which then finishes and frees it when resumed. */
+    BOOL _isDetached;
+    
     /* The raw FastCGI request. It is unlikely that you will need to use this
      directly unless interfacing with existing FastCGI code. For more info
      about FastCGI please see http://www.fastcgi.com */
@@ -133,6 +138,27 @@
  */
 - (id)flush;
 
+/** \anchor resume
+ \brief Completes the response of a suspended transport
+ 
+ Sends any queued headers, flushes the response stream and finishes the request that
+ was put aside by \ref suspend.  The transport is closed afterwards.  Calling
+ \ref resume on a transport that is not suspended has no effect.
+ 
+ Since \ref resume is normally called from another thread, writes made before it
+ should be synchronized on the transport:
+ \code
+ @synchronized (transport) {
+     [transport write:@"Your turn"];
+     [transport resume];
+ }
+ [transport release];
+ \endcode
+ \return the BxTransport instance
+ \since 2.0
+ */
+- (id)resume;
+
 /** \anchor setCookie
  \brief Adds a session cookie to send to the client
  
@@ -333,6 +359,27 @@
  */
 - (id)setHttpStatusCode:(int)status;
 
+/** \anchor suspend
+ \brief Keeps the request open after renderWithTransport returns
+ 
+ Normally the response is completed as soon as the handler returns.  A suspended
+ transport instead releases the request thread to serve other clients and keeps the
+ connection open until \ref resume is called, e.g. when an event the client is
+ waiting for takes place.  The handler must retain the transport until then.
+ 
+ Example of answering a request once a job has finished:
+ \code
+ - (id)renderWithTransport:(BxTransport *)transport {
+     [transport suspend];
+     [_waitingTransports addObject:transport];
+     return self;
+ }
+ \endcode
+ \return the BxTransport instance
+ \since 2.0
+ */
+- (id)suspend;
+
 /** \anchor write
  \brief Writes the given NSString to the response stream
  
@@ -426,6 +473,13 @@
  */
 @property (nonatomic, readonly) BOOL isClosed;
 
+/** \anchor isSuspended
+ This variable indicates whether \ref suspend has been called and the transport
+ has not been resumed yet.
+ \since 2.0
+ */
+@property (readonly) BOOL isSuspended;
+
 /** \anchor uploadedFiles
  If any files were uploaded in POST variables, they are included here as BxFile instances.
  Example as BXML that allows uploading a file and then showing information about it:
@@ -1,4 +1,4 @@
-#import "BxTransport.h"
+#import "BxTransport_Private.h"
 #import <pthread.h>
 #import <Bombaxtic/BxFile.h>
 
@@ -6,6 +6,7 @@
 
 @synthesize serverVars = _serverVars;
 @synthesize isClosed = _isClosed;
+@synthesize isSuspended = _isSuspended;
 @synthesize queryVars = _queryVars;
 @synthesize postVars = _postVars;
 @synthesize cookies = _cookies;
@@ -37,6 +38,9 @@ typedef struct FCGX_Params {
     _rawPostData = nil;
     _hasWrittenHeaders = NO;
     _isClosed = NO;
+    _isSuspended = NO;
+    _isDetached = NO;
+    _requestPath = nil;
     [_outboundHeaders setObject:@"text/html" forKey:@"Content-Type"];
     
     for (int i = 0; i < params->length; i++) {
@@ -329,7 +333,31 @@ typedef struct FCGX_Params {
 }
 
 - (id)_setRequestPath:(NSString *)requestPath {
-    _requestPath = requestPath;
+    // retained since a suspended transport outlives the request's autorelease pool
+    [_requestPath release];
+    _requestPath = [requestPath retain];
+    return self;
+}
+
+// called on the request thread once the handler has returned; NO if the transport was
+// suspended, in which case it takes over the FastCGI request
+- (BOOL)_finishUnlessSuspended {
+    @synchronized (self) {
+        if (_isSuspended) {
+            _isDetached = YES;
+            return NO;
+        }
+        [self _writeHeaders];
+        return YES;
+    }
+}
+
+- (id)_finishDetachedRequest {
+    FCGX_Finish_r(_request);
+    free(_request);
+    _request = NULL;
+    _isDetached = NO;
+    _isClosed = YES;
     return self;
 }
 
@@ -436,6 +464,19 @@ typedef struct FCGX_Params {
     return self;
 }
 
+// straight into the FastCGI output buffer, for writers that encode their own bytes
+- (id)_writeBytes:(const char *)bytes
+           length:(int)length {
+    if (length > 0 && ! _isClosed) {
+        if (! _hasWrittenHeaders) {
+            [self _writeHeaders];
+        }
+        // xxx check for errors
+        FCGX_PutStr(bytes, length, _request->out);
+    }
+    return self;
+}
+
 - (id)writeFormat:(NSString *)format, ... {
     if (format == nil || _isClosed) {
         return self;
@@ -460,6 +501,30 @@ typedef struct FCGX_Params {
     return self;
 }
 
+- (id)resume {
+    @synchronized (self) {
+        if (! _isSuspended) {
+            return self;
+        }
+        _isSuspended = NO;
+        // otherwise the request thread has not returned yet and finishes the request itself
+        if (_isDetached) {
+            [self _writeHeaders];
+            [self _finishDetachedRequest];
+        }
+    }
+    return self;
+}
+
+- (id)suspend {
+    @synchronized (self) {
+        if (! _isClosed) {
+            _isSuspended = YES;
+        }
+    }
+    return self;
+}
+
 - (id)flush {
     if (! _isClosed) {
         FCGX_FFlush(_request->out);
@@ -468,6 +533,11 @@ typedef struct FCGX_Params {
 }
 
 - (void)dealloc {
+    if (_isDetached) {
+        // suspended and never resumed
+        [self _finishDetachedRequest];
+    }
+    [_requestPath release];
     if (_rawPostData) {
         [_rawPostData release];
     }
@@ -0,0 +1,27 @@
+/**
+ \brief Methods of BxTransport used by the request loop and other Bombaxtic classes
+ \author Bombaxtic LLC - http://www.bombaxtic.com
+ \since 2.0
+ 
+ Not part of the public API.  Anything that calls these must import this header so that
+ the compiler knows their return types.
+ 
+ */
+
+#import <Cocoa/Cocoa.h>
+#import <Bombaxtic/BxTransport.h>
+
+@interface BxTransport (Private)
+
+- (id)_setRequestPath:(NSString *)requestPath;
+
+// NO if the transport was suspended, in which case it takes over the FastCGI request
+- (BOOL)_finishUnlessSuspended;
+
+- (id)_finishDetachedRequest;
+- (FCGX_Request *)_rawRequest;
+- (id)_writeHeaders;
+- (id)_writeBytes:(const char *)bytes
+           length:(int)length;
+
+@end
@@ -19,8 +19,16 @@
 
 + (NSString *)base64EncodeString:(NSString *)str;
 
+// unpadded, single line, "-" and "_" in place of "+" and "/"; nil if malformed
++ (NSData *)base64URLDecodeString:(NSString *)str;
+
++ (NSString *)base64URLEncodeData:(NSData *)data;
+
 + (NSString *)extensionForMimeType:(NSString *)mimeType;
 
++ (NSData *)hmacSHA256Data:(NSData *)data
+                       key:(NSData *)key;
+
 + (NSString *)mimeTypeForExtension:(NSString *)extension;
 
 //+ (BOOL)isIpAddress:(NSString *)ipAddress
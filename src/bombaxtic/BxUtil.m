@@ -2,6 +2,7 @@
 #import <openssl/bio.h>
 #import <openssl/buffer.h>
 #import <openssl/evp.h>
+#import <openssl/hmac.h>
 #import <openssl/sha.h>
 
 static NSMutableDictionary *_extensionMimeTypes = nil;
@@ -75,6 +76,65 @@ static BOOL _hasSeededRandom = NO;
     return newStr;
 }
 
++ (NSData *)base64URLDecodeString:(NSString *)str {
+    NSMutableString *b64 = [[str mutableCopy] autorelease];
+    if ([b64 rangeOfCharacterFromSet:[[NSCharacterSet characterSetWithCharactersInString:@"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"] invertedSet]].location != NSNotFound ||
+        [b64 length] % 4 == 1) {
+        return nil;
+    }
+    [b64 replaceOccurrencesOfString:@"-"
+                         withString:@"+"
+                            options:0
+                              range:NSMakeRange(0, [b64 length])];
+    [b64 replaceOccurrencesOfString:@"_"
+                         withString:@"/"
+                            options:0
+                              range:NSMakeRange(0, [b64 length])];
+    int padding = (4 - [b64 length] % 4) % 4;
+    for (int i = 0; i < padding; i++) {
+        [b64 appendString:@"="];
+    }
+    NSData *data = [b64 dataUsingEncoding:NSASCIIStringEncoding];
+    NSMutableData *newData = [NSMutableData dataWithLength:[data length] / 4 * 3];
+    int len = EVP_DecodeBlock([newData mutableBytes], [data bytes], [data length]);
+    if (len < 0) {
+        return nil;
+    }
+    // EVP_DecodeBlock counts the padding as decoded zero bytes
+    [newData setLength:len - padding];
+    return newData;
+}
+
++ (NSString *)base64URLEncodeData:(NSData *)data {
+    NSMutableData *b64 = [NSMutableData dataWithLength:([data length] + 2) / 3 * 4 + 1];
+    int len = EVP_EncodeBlock([b64 mutableBytes], [data bytes], [data length]);
+    NSMutableString *str = [[[NSMutableString alloc] initWithBytes:[b64 bytes]
+                                                            length:len
+                                                          encoding:NSASCIIStringEncoding] autorelease];
+    [str replaceOccurrencesOfString:@"+"
+                         withString:@"-"
+                            options:0
+                              range:NSMakeRange(0, [str length])];
+    [str replaceOccurrencesOfString:@"/"
+                         withString:@"_"
+                            options:0
+                              range:NSMakeRange(0, [str length])];
+    [str replaceOccurrencesOfString:@"="
+                         withString:@""
+                            options:0
+                              range:NSMakeRange(0, [str length])];
+    return str;
+}
+
++ (NSData *)hmacSHA256Data:(NSData *)data
+                       key:(NSData *)key {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int len = 0;
+    HMAC(EVP_sha256(), [key bytes], [key length], [data bytes], [data length], digest, &len);
+    return [NSData dataWithBytes:digest
+                          length:len];
+}
+
 + (void)_setupMimeExtensions {
     if (_extensionMimeTypes == nil) {
         _extensionMimeTypes = [[NSMutableDictionary alloc] initWithCapacity:72];
@@ -0,0 +1,209 @@
+#import "BxWireFormat.h"
+#import <zlib.h>
+
+@implementation BxWireDataSlice
+
+- (id)initWithData:(NSData *)data
+             range:(NSRange)range {
+    [super init];
+    _backingData = [data retain];
+    _bytes = (const char *) [data bytes] + range.location;
+    _length = range.length;
+    return self;
+}
+
+- (const void *)bytes {
+    return _bytes;
+}
+
+- (NSUInteger)length {
+    return _length;
+}
+
+- (void)dealloc {
+    [_backingData release];
+    [super dealloc];
+}
+
+@end
+
+void _BX_wireAppendHeader(NSMutableData *data, char type) {
+    char header[BX_WIRE_HEADER_LENGTH] = {'B', 'X', 'W', BX_WIRE_VERSION, type};
+    [data appendBytes:header
+               length:BX_WIRE_HEADER_LENGTH];
+}
+
+void _BX_wireAppendUInt32(NSMutableData *data, uint32_t value) {
+    uint32_t bigValue = NSSwapHostIntToBig(value);
+    [data appendBytes:&bigValue
+               length:4];
+}
+
+void _BX_wireAppendDouble(NSMutableData *data, double value) {
+    NSSwappedDouble bigValue = NSSwapHostDoubleToBig(value);
+    [data appendBytes:&bigValue
+               length:8];
+}
+
+void _BX_wireAppendData(NSMutableData *data, NSData *value) {
+    if (value == nil) {
+        _BX_wireAppendUInt32(data, BX_WIRE_NIL);
+    } else {
+        _BX_wireAppendUInt32(data, [value length]);
+        [data appendData:value];
+    }
+}
+
+void _BX_wireAppendString(NSMutableData *data, NSString *value) {
+    if (value == nil) {
+        _BX_wireAppendUInt32(data, BX_WIRE_NIL);
+    } else {
+        const char *utf8 = [value UTF8String];
+        uint32_t len = strlen(utf8);
+        _BX_wireAppendUInt32(data, len);
+        [data appendBytes:utf8
+                   length:len];
+    }
+}
+
+void _BX_wireAppendObject(NSMutableData *data, id value) {
+    char tag = [value isKindOfClass:[NSString class]] ? BX_WIRE_TAG_STRING : BX_WIRE_TAG_ARCHIVE;
+    [data appendBytes:&tag
+               length:1];
+    if (tag == BX_WIRE_TAG_STRING) {
+        _BX_wireAppendString(data, value);
+    } else {
+        _BX_wireAppendData(data, [NSKeyedArchiver archivedDataWithRootObject:value]);
+    }
+}
+
+BOOL _BX_wireHasHeader(NSData *data, char type) {
+    if ([data length] < BX_WIRE_HEADER_LENGTH) {
+        return NO;
+    }
+    const char *bytes = [data bytes];
+    return bytes[0] == 'B' && bytes[1] == 'X' && bytes[2] == 'W' &&
+           bytes[3] == BX_WIRE_VERSION && bytes[4] == type;
+}
+
+BOOL _BX_wireReadUInt32(NSData *data, NSUInteger *offset, uint32_t *value) {
+    if ([data length] < *offset + 4) {
+        return NO;
+    }
+    uint32_t bigValue;
+    memcpy(&bigValue, (const char *) [data bytes] + *offset, 4);
+    *value = NSSwapBigIntToHost(bigValue);
+    *offset += 4;
+    return YES;
+}
+
+BOOL _BX_wireReadDouble(NSData *data, NSUInteger *offset, double *value) {
+    if ([data length] < *offset + 8) {
+        return NO;
+    }
+    NSSwappedDouble bigValue;
+    memcpy(&bigValue, (const char *) [data bytes] + *offset, 8);
+    *value = NSSwapBigDoubleToHost(bigValue);
+    *offset += 8;
+    return YES;
+}
+
+// the returned data shares the buffer of the data being read
+BOOL _BX_wireReadData(NSData *data, NSUInteger *offset, NSData **value) {
+    NSUInteger start = *offset;
+    uint32_t len;
+    if (! _BX_wireReadUInt32(data, offset, &len)) {
+        return NO;
+    }
+    if (len == BX_WIRE_NIL) {
+        *value = nil;
+        return YES;
+    }
+    if ([data length] - *offset < len) {
+        *offset = start;
+        return NO;
+    }
+    *value = [[[BxWireDataSlice alloc] initWithData:data
+                                              range:NSMakeRange(*offset, len)] autorelease];
+    *offset += len;
+    return YES;
+}
+
+BOOL _BX_wireReadString(NSData *data, NSUInteger *offset, NSString **value) {
+    NSUInteger start = *offset;
+    uint32_t len;
+    if (! _BX_wireReadUInt32(data, offset, &len)) {
+        return NO;
+    }
+    if (len == BX_WIRE_NIL) {
+        *value = nil;
+        return YES;
+    }
+    if ([data length] - *offset < len) {
+        *offset = start;
+        return NO;
+    }
+    *value = [[[NSString alloc] initWithBytes:(const char *) [data bytes] + *offset
+                                       length:len
+                                     encoding:NSUTF8StringEncoding] autorelease];
+    if (*value == nil) {
+        *offset = start;
+        return NO;
+    }
+    *offset += len;
+    return YES;
+}
+
+BOOL _BX_wireReadObject(NSData *data, NSUInteger *offset, id *value) {
+    NSUInteger start = *offset;
+    if ([data length] < *offset + 1) {
+        return NO;
+    }
+    char tag = ((const char *) [data bytes])[*offset];
+    *offset += 1;
+    if (tag == BX_WIRE_TAG_STRING && _BX_wireReadString(data, offset, value)) {
+        return YES;
+    }
+    NSData *archive;
+    if (tag == BX_WIRE_TAG_ARCHIVE && _BX_wireReadData(data, offset, &archive) && archive != nil) {
+        @try {
+            *value = [NSKeyedUnarchiver unarchiveObjectWithData:archive];
+        } @catch (id exc) {
+            *value = nil;
+        }
+        if (*value != nil) {
+            return YES;
+        }
+    }
+    *offset = start;
+    return NO;
+}
+
+NSData *_BX_wireDeflate(NSData *data) {
+    uLongf deflatedLength = compressBound([data length]);
+    NSMutableData *deflated = [NSMutableData dataWithLength:4 + deflatedLength];
+    uint32_t bigLength = NSSwapHostIntToBig([data length]);
+    memcpy([deflated mutableBytes], &bigLength, 4);
+    if (compress2((Bytef *) [deflated mutableBytes] + 4, &deflatedLength,
+                  [data bytes], [data length], Z_DEFAULT_COMPRESSION) != Z_OK) {
+        return nil;
+    }
+    [deflated setLength:4 + deflatedLength];
+    return deflated;
+}
+
+NSData *_BX_wireInflate(NSData *data) {
+    NSUInteger offset = 0;
+    uint32_t length;
+    if (! _BX_wireReadUInt32(data, &offset, &length) || length > BX_WIRE_MAX_INFLATED_LENGTH) {
+        return nil;
+    }
+    NSMutableData *inflated = [NSMutableData dataWithLength:length];
+    uLongf inflatedLength = length;
+    if (uncompress([inflated mutableBytes], &inflatedLength,
+                   (const Bytef *) [data bytes] + offset, [data length] - offset) != Z_OK ||
+        inflatedLength != length) {
+        return nil;
+    }
+    return inflated;
+}
@@ -3,6 +3,7 @@
 #import <signal.h>
 #import "fcgiapp.h"
 #import <Bombaxtic/Bombaxtic.h>
+#import "BxTransport_Private.h"
 
 NSString *BX_ERROR_DOMAIN_STRING;
 
@@ -44,23 +45,25 @@ static BOOL isTerminating = NO;
 void * BxMain_requestLoop(void *p)
 {    
     BOOL continueRunning = YES;
-    FCGX_Request request;
-    if (FCGX_InitRequest(&request, fcgiSock, 0)) {
+    // allocated per request since a suspended BxTransport keeps its request after the loop moves on
+    FCGX_Request *request = malloc(sizeof(FCGX_Request));
+    if (FCGX_InitRequest(request, fcgiSock, 0)) {
         printf("Could not initialize FastCGI request in thread %ld.\n", (long) p);
         return NULL;
     }
     
     while (continueRunning) {
-        int rc = FCGX_Accept_r(&request);
+        int rc = FCGX_Accept_r(request);
         if (rc < 0) {
             printf("Error accepting FastCGI connection in thread %ld.\n", (long) p);
             return NULL;
         }
         NSAutoreleasePool *transportPool = [[NSAutoreleasePool alloc] init];
         BxTransport *transport;
+        BOOL isSuspended = NO;
         
         @try {
-            transport = [[BxTransport alloc] initWithRequest:&request];
+            transport = [[BxTransport alloc] initWithRequest:request];
             
             NSString *requestPath = [transport.serverVars objectForKey:@"DOCUMENT_URI"]; // xxx - the starting location, this way it is relocatable
             if (_BX_urlRoot != nil) {
@@ -81,7 +84,7 @@ void * BxMain_requestLoop(void *p)
                 [transport _writeHeaders];
             } else {
                 [handler renderWithTransport:transport];            
-                [transport _writeHeaders];
+                isSuspended = ! [transport _finishUnlessSuspended];
             }
             
             [transport release];        
@@ -92,7 +95,7 @@ void * BxMain_requestLoop(void *p)
                 [transport _writeHeaders];
                 [transport release];
             }
-            FCGX_Finish_r(&request);
+            FCGX_Finish_r(request);
             NSLog(@"%@", exc);
             if (! isTerminating) {
                 isTerminating = YES;
@@ -101,7 +104,13 @@ void * BxMain_requestLoop(void *p)
             }
         }
         [transportPool drain];
-        FCGX_Finish_r(&request);
+        if (isSuspended) {
+            // the transport finishes and frees the request when it is resumed
+            request = malloc(sizeof(FCGX_Request));
+            FCGX_InitRequest(request, fcgiSock, 0);
+        } else {
+            FCGX_Finish_r(request);
+        }
     }
     return NULL;
 }
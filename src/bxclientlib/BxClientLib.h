@@ -1,6 +1,8 @@
 #import "BxCallback.h"
 #import "BxMessage.h"
 #import "BxMessageManager.h"
+#import "BxRemoteInvocationBatch.h"
+#import "BxRemoteInvocationFuture.h"
 #import "BxRemoteObject.h"
 #import "BxRemoteObjectManager.h"
 #import "BxServerSession.h"
@@ -1,4 +1,5 @@
 #import "BxMessage.h"
+#import "BxWireFormat.h"
 
 @implementation BxMessage
 
@@ -59,6 +60,74 @@
     return 1;
 }
 
+- (NSMutableData *)_appendWireFormat:(NSMutableData *)data {
+    _BX_wireAppendString(data, _kind);
+    _BX_wireAppendDouble(data, _createdDate);
+    if (_labels == nil) {
+        _BX_wireAppendUInt32(data, BX_WIRE_NIL);
+    } else {
+        // tagged, so labels arrive with the classes they were sent with as in an archive
+        _BX_wireAppendUInt32(data, [_labels count]);
+        for (id key in _labels) {
+            _BX_wireAppendObject(data, key);
+            _BX_wireAppendObject(data, [_labels objectForKey:key]);
+        }
+    }
+    _BX_wireAppendData(data, _data);
+    return data;
+}
+
+- (NSData *)_wireData {
+    NSMutableData *data = [NSMutableData dataWithCapacity:[_data length] + 64];
+    _BX_wireAppendHeader(data, BX_WIRE_TYPE_MESSAGE);
+    return [self _appendWireFormat:data];
+}
+
++ (BxMessage *)_messageWithWireData:(NSData *)data
+                             offset:(NSUInteger *)offset {
+    NSString *kind;
+    double createdDate;
+    uint32_t labelCount;
+    NSMutableDictionary *labels = nil;
+    NSData *messageData;
+    if (! _BX_wireReadString(data, offset, &kind) ||
+        ! _BX_wireReadDouble(data, offset, &createdDate) ||
+        ! _BX_wireReadUInt32(data, offset, &labelCount)) {
+        return nil;
+    }
+    if (labelCount != BX_WIRE_NIL) {
+        labels = [NSMutableDictionary dictionaryWithCapacity:MIN(labelCount, 16)];
+        for (uint32_t i = 0; i < labelCount; i++) {
+            id key;
+            id value;
+            if (! _BX_wireReadObject(data, offset, &key) ||
+                ! _BX_wireReadObject(data, offset, &value) ||
+                key == nil || value == nil) {
+                return nil;
+            }
+            [labels setObject:value
+                       forKey:key];
+        }
+    }
+    // the message data shares the buffer it was read from
+    if (! _BX_wireReadData(data, offset, &messageData)) {
+        return nil;
+    }
+    return [[[BxMessage alloc] initWithData:messageData
+                                       kind:kind
+                                     labels:labels
+                                createdDate:createdDate] autorelease];
+}
+
++ (BxMessage *)_messageWithWireData:(NSData *)data {
+    if (! _BX_wireHasHeader(data, BX_WIRE_TYPE_MESSAGE)) {
+        return nil;
+    }
+    NSUInteger offset = BX_WIRE_HEADER_LENGTH;
+    return [self _messageWithWireData:data
+                               offset:&offset];
+}
+
 + (BxMessage *)messageWithData:(NSData *)data
                           kind:(NSString *)kind
                         labels:(NSDictionary *)labels {
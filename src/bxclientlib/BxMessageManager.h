@@ -6,6 +6,8 @@
 
 @interface BxMessageManager : NSObject <BxRequestOperationCallback> {
     BOOL _keepMessages;
+    BOOL _useLongPolling;
+    BOOL _lastLongPollFailed;
     BOOL *_isValidPtr;
     BxServerSession *_serverSession;
     NSLock *_messageLock;
@@ -15,6 +17,7 @@
     NSMutableDictionary *_observers;
     NSTimeInterval _maxCheckInterval;
     NSTimeInterval _lastCheck;
+    NSTimeInterval _longPollInterval;
     NSUInteger _maxMessages;
 }
 
@@ -47,5 +50,8 @@
 @property (assign, nonatomic) BOOL keepMessages;
 @property (assign, nonatomic) NSUInteger maxMessages;
 @property (assign, nonatomic) NSTimeInterval maxCheckInterval;
+// the server holds each poll open until a message arrives, instead of polling every maxCheckInterval
+@property (assign, nonatomic) BOOL useLongPolling;
+@property (assign, nonatomic) NSTimeInterval longPollInterval;
 
 @end
@@ -9,12 +9,17 @@
 @synthesize keepMessages = _keepMessages;
 @synthesize maxMessages = _maxMessages;
 @synthesize maxCheckInterval = _maxCheckInterval;
+@synthesize useLongPolling = _useLongPolling;
+@synthesize longPollInterval = _longPollInterval;
 
 - (id)init {
     [super init];
     _keepMessages = NO;
     _maxMessages = 0;
     _maxCheckInterval = 10;
+    _useLongPolling = NO;
+    _lastLongPollFailed = NO;
+    _longPollInterval = 30;
     _incomingMessages = [[NSMutableArray alloc] initWithCapacity:32];
     _observers = [[NSMutableDictionary alloc] initWithCapacity:16];
     _universalObservers = [[NSMutableArray alloc] initWithCapacity:8];
@@ -36,11 +41,27 @@
         _isValidPtr = myValidPtr;
         _lastCheck = [NSDate timeIntervalSinceReferenceDate];
         while (YES) {
+            if (_useLongPolling) {
+                if (! *myValidPtr || _serverSession.isClosed) {
+                    free(myValidPtr);
+                    break;
+                }
+                NSAutoreleasePool *pollPool = [[NSAutoreleasePool alloc] init];
+                [self _longPoll];
+                [pollPool release];
+                if (! _lastLongPollFailed) {
+                    // reconnect at once so the server can deliver the next message
+                    continue;
+                }
+            }
             [NSThread sleepForTimeInterval:_maxCheckInterval];
             if (! *myValidPtr || _serverSession.isClosed) {
                 free(myValidPtr);
                 break;
             }
+            if (_useLongPolling) {
+                continue;
+            }
             NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
             if (now - _lastCheck > _maxCheckInterval) {
                 [_serverSession _waitForOperationQueue];
@@ -50,7 +71,9 @@
                                                                                serverSession:_serverSession
                                                                                     callback:nil
                                                                                        token:nil];
-                    [_serverSession _addRequestOperation:operation];
+                    [_serverSession _addRequestOperation:operation
+                                                priority:NSOperationQueuePriorityLow
+                                                 ordered:NO];
                 }
             }
         }
@@ -60,6 +83,27 @@
     [pool release];
 }
 
+- (id)_longPoll {
+    NSMutableURLRequest *request = [[[_serverSession _createRequest:[NSData data]] mutableCopy] autorelease];
+    [request setValue:[NSString stringWithFormat:@"%d", (int) _longPollInterval]
+   forHTTPHeaderField:@"BxClientLib-LongPoll"];
+    [request setTimeoutInterval:MAX([request timeoutInterval], _longPollInterval + 15)];
+    BxCallback *callback = [BxCallback callbackWithSelector:@selector(_longPollFinished:)
+                                                     target:self];
+    BxRequestOperation *operation = [BxRequestOperation operationWithRequest:request
+                                                               serverSession:_serverSession
+                                                                    callback:self
+                                                                       token:callback];
+    // run here instead of on the session's serial queue, which it would hold up for the whole poll
+    _lastLongPollFailed = NO;
+    [operation start];
+    return self;
+}
+
+- (void)_longPollFinished:(NSError *)error {
+    _lastLongPollFailed = error != nil;
+}
+
 - (id)_initWithServerSession:(BxServerSession *)serverSession {
     [self init];
     _serverSession = [serverSession retain];
@@ -101,7 +145,13 @@
                                        error:(NSError *)error {
     if (token != nil &&
         [token isMemberOfClass:[BxCallback class]]) {
-            [token invokeWith:error];
+        if (error == nil && [response statusCode] >= 400) {
+            // e.g. a server that predates long polling rejects the empty request
+            error = [NSError errorWithDomain:@"BxClientLib"
+                                        code:[response statusCode]
+                                    userInfo:nil];
+        }
+        [token invokeWith:error];
     }
 }
 
@@ -184,7 +234,7 @@
 
 - (id)sendSynchronousMessage:(BxMessage *)message
                        error:(NSError **)error {
-    NSData *messageArchive = [NSKeyedArchiver archivedDataWithRootObject:message];
+    NSData *messageArchive = [_serverSession _encodeMessage:message];
     NSURLRequest *request = [_serverSession _createRequest:messageArchive];
     NSConditionLock *lock = [[[NSConditionLock alloc] initWithCondition:0] autorelease];
     BxRequestOperation *operation = [BxRequestOperation operationWithRequest:request
@@ -199,20 +249,22 @@
 }
 
 - (id)sendMessage:(BxMessage *)message {
-    NSData *messageArchive = [NSKeyedArchiver archivedDataWithRootObject:message];
+    NSData *messageArchive = [_serverSession _encodeMessage:message];
     NSURLRequest *request = [_serverSession _createRequest:messageArchive];
     BxRequestOperation *operation = [BxRequestOperation operationWithRequest:request
                                                                serverSession:_serverSession
                                                                     callback:nil
                                                                        token:nil];
-    [_serverSession _addRequestOperation:operation];
+    [_serverSession _addRequestOperation:operation
+                                priority:NSOperationQueuePriorityNormal
+                                 ordered:YES];
     return self;
 }
 
 - (id)sendMessage:(BxMessage *)message
          callback:(SEL)selector
            target:(id)target {
-    NSData *messageArchive = [NSKeyedArchiver archivedDataWithRootObject:message];
+    NSData *messageArchive = [_serverSession _encodeMessage:message];
     NSURLRequest *request = [_serverSession _createRequest:messageArchive];
     BxCallback *callback = [BxCallback callbackWithSelector:selector
                                                      target:target
@@ -221,7 +273,9 @@
                                                                serverSession:_serverSession
                                                                     callback:self
                                                                        token:callback];
-    [_serverSession _addRequestOperation:operation];
+    [_serverSession _addRequestOperation:operation
+                                priority:NSOperationQueuePriorityNormal
+                                 ordered:YES];
     return self;
 }
 
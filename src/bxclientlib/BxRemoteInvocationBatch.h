@@ -0,0 +1,32 @@
+#import <Foundation/Foundation.h>
+
+@class BxRemoteInvocationFuture;
+@class BxRemoteObjectManager;
+
+/*
+ Collects the remote invocations made on one thread between -[BxRemoteObjectManager beginBatch]
+ and -send.  Each queued call returns at once with a zero result and gets a future; -send
+ delivers every call in one request, the server runs them in order and the futures resolve.
+ */
+@interface BxRemoteInvocationBatch : NSObject {
+    BOOL _isSent;
+    BxRemoteObjectManager *_remoteObjectManager;
+    NSMutableArray *_futures;
+    NSMutableArray *_requests;
+}
+
+// in call order
+- (NSArray *)futures;
+
+// the future of the call just made through a BxRemoteObject
+- (BxRemoteInvocationFuture *)lastFuture;
+
+// ends the batch; must be called on the thread that began it and blocks for the round trip
+- (id)send;
+
+// like send but returns at once; callback batch: is invoked on queue, or the main thread if nil
+- (id)sendAsyncWithCallback:(SEL)selector
+                     target:(id)target
+                      queue:(NSOperationQueue *)queue;
+
+@end
@@ -0,0 +1,77 @@
+#import "BxRemoteInvocationBatch.h"
+#import "BxRemoteInvocationFuture.h"
+#import "BxRemoteObjectManager.h"
+#import "BxCallback.h"
+
+@implementation BxRemoteInvocationBatch
+
+- (id)_initWithRemoteObjectManager:(BxRemoteObjectManager *)remoteObjectManager {
+    [self init];
+    _isSent = NO;
+    _remoteObjectManager = [remoteObjectManager retain];
+    _futures = [[NSMutableArray alloc] initWithCapacity:16];
+    _requests = [[NSMutableArray alloc] initWithCapacity:16];
+    return self;
+}
+
+- (BxRemoteInvocationFuture *)_addRequest:(NSData *)request
+                               invocation:(NSInvocation *)invocation {
+    NSUInteger returnLength = [[invocation methodSignature] methodReturnLength];
+    if (returnLength > 0) {
+        void *blank = calloc(1, returnLength);
+        [invocation setReturnValue:blank];
+        free(blank);
+    }
+    BxRemoteInvocationFuture *future = [[BxRemoteInvocationFuture alloc] _initWithInvocation:invocation];
+    [_requests addObject:request];
+    [_futures addObject:future];
+    [future release];
+    return future;
+}
+
+- (NSArray *)futures {
+    return [[_futures copy] autorelease];
+}
+
+- (BxRemoteInvocationFuture *)lastFuture {
+    return [_futures lastObject];
+}
+
+- (id)send {
+    if (_isSent) {
+        return self;
+    }
+    _isSent = YES;
+    [_remoteObjectManager _endBatch:self];
+    if ([_requests count] > 0) {
+        [_remoteObjectManager _sendBatchRequests:_requests
+                                         futures:_futures];
+    }
+    return self;
+}
+
+- (id)sendAsyncWithCallback:(SEL)selector
+                     target:(id)target
+                      queue:(NSOperationQueue *)queue {
+    if (_isSent) {
+        return self;
+    }
+    _isSent = YES;
+    [_remoteObjectManager _endBatch:self];
+    [_remoteObjectManager _sendBatchRequests:_requests
+                                     futures:_futures
+                                    callback:[BxCallback callbackWithSelector:selector
+                                                                       target:target]
+                                      result:self
+                                       queue:queue];
+    return self;
+}
+
+- (void)dealloc {
+    [_remoteObjectManager release];
+    [_futures release];
+    [_requests release];
+    [super dealloc];
+}
+
+@end
@@ -0,0 +1,20 @@
+#import <Foundation/Foundation.h>
+
+// the result of a remote invocation that was queued rather than sent right away
+@interface BxRemoteInvocationFuture : NSObject {
+    BOOL _isResolved;
+    NSLock *_lock; // resolved on the request operation's thread, read on any other
+    NSError *_error;
+    NSInvocation *_invocation;
+    id _resultOwner; // keeps the object or C string the return value points to alive
+}
+
+// nil unless the method returns an object and the invocation succeeded
+- (id)objectResult;
+
+@property (nonatomic, readonly) BOOL isResolved;
+@property (nonatomic, readonly) NSError *error;
+// once resolved without an error, holds the remote return value
+@property (nonatomic, readonly) NSInvocation *invocation;
+
+@end
@@ -0,0 +1,73 @@
+#import "BxRemoteInvocationFuture.h"
+
+@implementation BxRemoteInvocationFuture
+
+@synthesize invocation = _invocation;
+
+- (id)_initWithInvocation:(NSInvocation *)invocation {
+    [self init];
+    // the invocation outlives the call that made it
+    [invocation retainArguments];
+    _invocation = [invocation retain];
+    _lock = [[NSLock alloc] init];
+    _error = nil;
+    _resultOwner = nil;
+    _isResolved = NO;
+    return self;
+}
+
+// resultOwner is whatever the invocation's return value points into
+- (id)_resolveWithResultOwner:(id)resultOwner
+                        error:(NSError *)error {
+    [_lock lock];
+    _resultOwner = [resultOwner retain];
+    _error = [error retain];
+    _isResolved = YES;
+    [_lock unlock];
+    return self;
+}
+
+- (id)_resolveWithError:(NSError *)error {
+    return [self _resolveWithResultOwner:nil
+                                   error:error];
+}
+
+- (BOOL)isResolved {
+    [_lock lock];
+    BOOL isResolved = _isResolved;
+    [_lock unlock];
+    return isResolved;
+}
+
+- (NSError *)error {
+    [_lock lock];
+    NSError *error = [[_error retain] autorelease];
+    [_lock unlock];
+    return error;
+}
+
+- (id)objectResult {
+    if ([[_invocation methodSignature] methodReturnType][0] != '@') {
+        return nil;
+    }
+    id result = nil;
+    [_lock lock];
+    if (_isResolved && _error == nil) {
+        [_invocation getReturnValue:&result];
+        [[result retain] autorelease];
+    }
+    [_lock unlock];
+    return result;
+}
+
+- (void)dealloc {
+    [_invocation release];
+    [_lock release];
+    if (_error) {
+        [_error release];
+    }
+    [_resultOwner release];
+    [super dealloc];
+}
+
+@end
@@ -1,6 +1,8 @@
 #import <Foundation/Foundation.h>
 #import "BxRequestOperationCallback.h"
 
+@class BxRemoteInvocationBatch;
+@class BxRemoteInvocationFuture;
 @class BxServerSession;
 
 @interface BxRemoteObjectManager : NSObject <BxRequestOperationCallback> {
@@ -8,10 +10,23 @@
     NSLock *_instanceLock;
     NSLock *_signatureLock;
     NSMutableDictionary *_instanceOids;
-    NSMutableDictionary *_classSignatures;
-    NSMutableDictionary *_requestResponseContents;
+    NSMutableDictionary *_classSignatures; // class name -> selector name -> type encoding
+    NSLock *_pendingRequestsLock;
+    NSMutableDictionary *_pendingRequests; // request id -> BxCallback handling the response
+    unsigned long long _nextRequestId;
+    NSString *_batchKey; // this manager's open batch in a thread dictionary
 }
 
+// until the batch is sent, remote invocations made on this thread are queued instead of sent
+- (BxRemoteInvocationBatch *)beginBatch;
+
 - (id)createRemoteInstance:(NSString *)className;
 
+// sends an invocation whose target is a BxRemoteObject without blocking; callback future: is
+// invoked on queue, or the main thread if queue is nil, once the future has resolved
+- (BxRemoteInvocationFuture *)invokeAsync:(NSInvocation *)invocation
+                                 callback:(SEL)selector
+                                   target:(id)target
+                                    queue:(NSOperationQueue *)queue;
+
 @end
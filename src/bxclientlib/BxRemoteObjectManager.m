@@ -1,14 +1,18 @@
 #import "BxRemoteObjectManager.h"
+#import "BxCallback.h"
 #import "BxRemoteObject.h"
 #import "BxServerSession.h"
 #import "BxRequestOperation.h"
+#import "BxRemoteInvocationBatch.h"
+#import "BxRemoteInvocationFuture.h"
 
 enum BxRemoteObjectRequestType_enum {
     BxRemoteObjectRequestTypeInit,
     BxRemoteObjectRequestTypeInitWithSigs,
     BxRemoteObjectRequestTypeInvoke,
     BxRemoteObjectRequestTypeRelease,
-    BxRemoteObjectRequestTypeReleaseAll
+    BxRemoteObjectRequestTypeReleaseAll,
+    BxRemoteObjectRequestTypeBatch
 } typedef BxRemoteObjectRequestType;
 
 
@@ -19,16 +23,19 @@ enum BxRemoteObjectRequestType_enum {
     _serverSession = [serverSession retain];
     _instanceOids = [[NSMutableDictionary alloc] initWithCapacity:32];
     _classSignatures = [[NSMutableDictionary alloc] initWithCapacity:32];
-    _requestResponseContents = [[NSMutableDictionary alloc] initWithCapacity:16];
+    _pendingRequestsLock = [[NSLock alloc] init];
+    _pendingRequests = [[NSMutableDictionary alloc] initWithCapacity:16];
+    _nextRequestId = 0;
     _instanceLock = [[NSLock alloc] init];
     _signatureLock = [[NSLock alloc] init];
+    _batchKey = [[NSString alloc] initWithFormat:@"BxRemoteInvocationBatch-%p", self];
     return self;
 }
 
 - (NSMethodSignature *)_signatureForClassName:(NSString *)className
                                      selector:(SEL)selector {
     [_signatureLock lock];
-    NSString *signatureStr = [_classSignatures objectForKey:className];
+    NSString *signatureStr = [[_classSignatures objectForKey:className] objectForKey:NSStringFromSelector(selector)];
     [_signatureLock unlock];
     if (signatureStr) {
         return [NSMethodSignature signatureWithObjCTypes:[signatureStr UTF8String]];
@@ -37,122 +44,334 @@ enum BxRemoteObjectRequestType_enum {
     }
 }
 
+- (NSData *)_requestDataForOid:(NSString *)oid
+                     invocation:(NSInvocation *)invocation
+                      signature:(NSString *)signatureStr {
+    NSMethodSignature *signature = [invocation methodSignature];
+    NSMutableData *data = [NSMutableData dataWithCapacity:512];
+    NSKeyedArchiver *archiver = [[[NSKeyedArchiver alloc] initForWritingWithMutableData:data] autorelease];
+    [archiver encodeInt32:BxRemoteObjectRequestTypeInvoke
+                   forKey:@"cmd"];
+    [archiver encodeObject:oid
+                    forKey:@"oid"];
+    [archiver encodeObject:NSStringFromSelector([invocation selector])
+                    forKey:@"selector"];
+    [archiver encodeObject:signatureStr
+                    forKey:@"signature"];
+    for (int i = 2; i < [signature numberOfArguments]; i++) {
+        char argType = [signature getArgumentTypeAtIndex:i][0];
+        NSString *argName = [NSString stringWithFormat:@"arg%d", i - 1];
+        if (argType == '@') {  // object
+            NSObject *x;
+            [invocation getArgument:&x atIndex:i];
+            if ([x conformsToProtocol:@protocol(NSCoding)]) {
+                [archiver encodeObject:x forKey:argName];
+            }
+        } else if (argType == '*') {  // c string
+            char *x;
+            [invocation getArgument:&x atIndex:i];
+            if (x) {
+                [archiver encodeBytes:(uint8_t *) x
+                               length:strlen(x)
+                               forKey:argName];
+            }
+        } else if (argType == 'd') {  // double
+            double x;
+            [invocation getArgument:&x atIndex:i];
+            [archiver encodeDouble:x forKey:argName];
+        } else if (argType == 'f') {  // float
+            float x;
+            [invocation getArgument:&x atIndex:i];
+            [archiver encodeFloat:x forKey:argName];
+        } else if (argType == 'i' || argType == 's' || argType == 'l' ||
+                   argType == 'c' || argType == 'C' || argType == 'I' ||
+                   argType == 'S' || argType == 'L' || argType == 'B') {  // int
+            int x;
+            [invocation getArgument:&x atIndex:i];
+            [archiver encodeInt32:x forKey:argName];
+        } else if (argType == 'q' || argType == 'Q') {  // long long
+            long long x;
+            [invocation getArgument:&x atIndex:i];
+            [archiver encodeInt64:x forKey:argName];
+        } else {
+            // other type, unsupported
+        }            
+    }
+    [archiver finishEncoding];
+    return data;
+}
+
+// returns the server's error, if any, after setting the invocation's return value; the return
+// value of an object or C string method points into resultOwner, which is autoreleased
+- (NSError *)_setResultFromData:(NSData *)contents
+                     invocation:(NSInvocation *)invocation
+                    resultOwner:(id *)resultOwner {
+    NSKeyedUnarchiver *unarchiver = [[[NSKeyedUnarchiver alloc] initForReadingWithData:contents] autorelease];
+    NSString *errorDescription = [unarchiver decodeObjectForKey:@"error"];
+    if (errorDescription) {
+        return [NSError errorWithDomain:@"BxClientLib"
+                                   code:102
+                               userInfo:[NSDictionary dictionaryWithObject:errorDescription
+                                                                    forKey:NSLocalizedDescriptionKey]];
+    }
+    char returnType = [[invocation methodSignature] methodReturnType][0];
+    if (returnType == '@') {  // object
+        NSObject *x = [unarchiver decodeObjectForKey:@"result"];
+        if (x) {
+            [invocation setReturnValue:&x];
+            *resultOwner = x;
+        }
+    } else if (returnType == '*') {  // c string
+        NSUInteger len = 0;
+        const uint8_t *bytes = [unarchiver decodeBytesForKey:@"result"
+                                              returnedLength:&len];
+        uint8_t *x = NULL;
+        if (bytes) {
+            // copied out of the unarchiver, with the terminator the server did not send
+            NSMutableData *str = [NSMutableData dataWithBytes:bytes
+                                                       length:len];
+            [str appendBytes:""
+                      length:1];
+            x = [str mutableBytes];
+            *resultOwner = str;
+        }
+        [invocation setReturnValue:&x];
+    } else if (returnType == 'd') {  // double
+        double x = [unarchiver decodeDoubleForKey:@"result"];
+        [invocation setReturnValue:&x];
+    } else if (returnType == 'f') {  // float
+        float x = [unarchiver decodeFloatForKey:@"result"];
+        [invocation setReturnValue:&x];
+    } else if (returnType == 'i' || returnType == 's' || returnType == 'l' ||
+               returnType == 'c' || returnType == 'C' || returnType == 'I' ||
+               returnType == 'S' || returnType == 'L' || returnType == 'B') {  // int
+        int x = [unarchiver decodeInt32ForKey:@"result"];
+        [invocation setReturnValue:&x];  // tbd: test this works for char...
+    } else if (returnType == 'q' || returnType == 'Q') {  // long long
+        long long x = [unarchiver decodeInt64ForKey:@"result"];
+        [invocation setReturnValue:&x];
+    } else {
+        // other type, unsupported
+    }
+    return nil;
+}
+
+// responses are matched to their handler by the request id passed as the operation's token
+- (id)_sendRequestData:(NSData *)data
+               handler:(BxCallback *)handler {
+    [_pendingRequestsLock lock];
+    NSNumber *requestId = [NSNumber numberWithUnsignedLongLong:_nextRequestId++];
+    [_pendingRequests setObject:handler
+                         forKey:requestId];
+    [_pendingRequestsLock unlock];
+    NSURLRequest *request = [_serverSession _createRequest:data];
+    BxRequestOperation *operation = [BxRequestOperation operationWithRequest:request
+                                                               serverSession:_serverSession
+                                                                    callback:self
+                                                                       token:requestId];
+    // someone is usually waiting on an invocation
+    @try {
+        [_serverSession _addRequestOperation:operation
+                                    priority:NSOperationQueuePriorityHigh
+                                     ordered:NO];
+    } @catch (id exc) {
+        // closed meanwhile, so no callback will ever remove the handler
+        [_pendingRequestsLock lock];
+        [_pendingRequests removeObjectForKey:requestId];
+        [_pendingRequestsLock unlock];
+        @throw;
+    }
+    return self;
+}
+
+- (void)_finishSynchronousRequest:(NSMutableDictionary *)state
+                         contents:(id)contents {
+    NSConditionLock *lock = [state objectForKey:@"lock"];
+    [lock lock];
+    if (contents) {
+        [state setObject:contents
+                  forKey:@"contents"];
+    }
+    [lock unlockWithCondition:1];
+}
+
+// one blocking round trip; returns the response contents, an NSError or nil
+- (id)_sendRequestData:(NSData *)data {
+    NSConditionLock *lock = [[[NSConditionLock alloc] initWithCondition:0] autorelease];
+    NSMutableDictionary *state = [NSMutableDictionary dictionaryWithObject:lock
+                                                                    forKey:@"lock"];
+    [self _sendRequestData:data
+                   handler:[BxCallback callbackWithSelector:@selector(_finishSynchronousRequest:contents:)
+                                                     target:self
+                                                      token:state]];
+    [lock lockWhenCondition:1];
+    id contents = [[[state objectForKey:@"contents"] retain] autorelease];
+    [lock unlock];
+    return contents;
+}
+
+- (void)_deliverCallback:(BxCallback *)callback
+                  result:(id)result
+                   queue:(NSOperationQueue *)queue {
+    if (queue) {
+        NSInvocationOperation *operation = [[NSInvocationOperation alloc] initWithTarget:callback
+                                                                                selector:@selector(invokeWith:)
+                                                                                  object:result];
+        [queue addOperation:operation];
+        [operation release];
+    } else {
+        [callback performSelectorOnMainThread:@selector(invokeWith:)
+                                   withObject:result
+                                waitUntilDone:NO];
+    }
+}
+
+- (BxRemoteInvocationBatch *)_openBatch {
+    return [[[NSThread currentThread] threadDictionary] objectForKey:_batchKey];
+}
+
+- (id)_endBatch:(BxRemoteInvocationBatch *)batch {
+    NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+    if ([threadDictionary objectForKey:_batchKey] == batch) {
+        [threadDictionary removeObjectForKey:_batchKey];
+    }
+    return self;
+}
+
+- (NSData *)_batchDataForRequests:(NSArray *)requests {
+    NSMutableData *data = [NSMutableData dataWithCapacity:512 * [requests count]];
+    NSKeyedArchiver *archiver = [[[NSKeyedArchiver alloc] initForWritingWithMutableData:data] autorelease];
+    [archiver encodeInt32:BxRemoteObjectRequestTypeBatch
+                   forKey:@"cmd"];
+    [archiver encodeObject:requests
+                    forKey:@"requests"];
+    [archiver finishEncoding];
+    return data;
+}
+
+- (id)_resolveFutures:(NSArray *)futures
+         withContents:(id)contents {
+    NSArray *results = nil;
+    NSError *error = nil;
+    if ([contents isKindOfClass:[NSError class]]) {
+        error = contents;
+    } else if (contents) {
+        NSKeyedUnarchiver *unarchiver = [[[NSKeyedUnarchiver alloc] initForReadingWithData:contents] autorelease];
+        results = [unarchiver decodeObjectForKey:@"results"];
+    }
+    if (error == nil && [results count] != [futures count]) {
+        error = [NSError errorWithDomain:@"BxClientLib"
+                                    code:103
+                                userInfo:[NSDictionary dictionaryWithObject:@"The BxClientLib batch was not answered in full"
+                                                                     forKey:NSLocalizedDescriptionKey]];
+    }
+    for (NSUInteger i = 0; i < [futures count]; i++) {
+        BxRemoteInvocationFuture *future = [futures objectAtIndex:i];
+        if (error) {
+            [future _resolveWithError:error];
+        } else {
+            id resultOwner = nil;
+            NSError *resultError = [self _setResultFromData:[results objectAtIndex:i]
+                                                 invocation:future.invocation
+                                                resultOwner:&resultOwner];
+            [future _resolveWithResultOwner:resultOwner
+                                      error:resultError];
+        }
+    }
+    return self;
+}
+
+- (id)_sendBatchRequests:(NSArray *)requests
+                 futures:(NSArray *)futures {
+    id contents = _serverSession.isClosed ? nil : [self _sendRequestData:[self _batchDataForRequests:requests]];
+    return [self _resolveFutures:futures
+                    withContents:contents];
+}
+
+- (void)_finishAsynchronousBatch:(NSDictionary *)state
+                        contents:(id)contents {
+    [self _resolveFutures:[state objectForKey:@"futures"]
+             withContents:contents];
+    [self _deliverCallback:[state objectForKey:@"callback"]
+                    result:[state objectForKey:@"result"]
+                     queue:[state objectForKey:@"queue"]];
+}
+
+// returns at once; callback is invoked with result once the futures have resolved
+- (id)_sendBatchRequests:(NSArray *)requests
+                 futures:(NSArray *)futures
+                callback:(BxCallback *)callback
+                  result:(id)result
+                   queue:(NSOperationQueue *)queue {
+    NSMutableDictionary *state = [NSMutableDictionary dictionaryWithObjectsAndKeys:
+                                  futures, @"futures",
+                                  callback, @"callback",
+                                  result, @"result",
+                                  nil];
+    if (queue) {
+        [state setObject:queue
+                  forKey:@"queue"];
+    }
+    if (_serverSession.isClosed) {
+        [self _finishAsynchronousBatch:state
+                              contents:nil];
+        return self;
+    }
+    return [self _sendRequestData:[self _batchDataForRequests:requests]
+                          handler:[BxCallback callbackWithSelector:@selector(_finishAsynchronousBatch:contents:)
+                                                            target:self
+                                                             token:state]];
+}
+
+- (NSData *)_requestDataForInvocation:(NSInvocation *)invocation
+                                  oid:(NSString *)oid {
+    [_instanceLock lock];
+    BxRemoteObject *remoteObject = [[[_instanceOids objectForKey:oid] retain] autorelease];
+    [_instanceLock unlock];
+    if (remoteObject == nil) {
+        return nil;
+    }
+    [_signatureLock lock];
+    NSString *signatureStr = [[_classSignatures objectForKey:remoteObject._BX_className] objectForKey:NSStringFromSelector([invocation selector])];
+    [_signatureLock unlock];
+    if (! signatureStr) {
+        return nil;
+    }
+    return [self _requestDataForOid:oid
+                         invocation:invocation
+                          signature:signatureStr];
+}
+
 - (id)_sendInvocationRequest:(NSString *)oid
                   invocation:(NSInvocation *)invocation {
     if (_serverSession.isClosed) {
         return nil;
     }
-    [_instanceLock lock];
-    BxRemoteObject *remoteObject = [_instanceOids objectForKey:oid];
-    [_instanceLock unlock];
-    if (remoteObject) {
-        [_signatureLock lock];
-        NSString *signatureStr = [_classSignatures objectForKey:remoteObject._BX_className];
-        [_signatureLock unlock];
-        if (! signatureStr) {
-            return nil;
-        }
-        NSMethodSignature *signature = [NSMethodSignature signatureWithObjCTypes:[signatureStr UTF8String]];;
-        NSMutableData *data = [NSMutableData dataWithCapacity:512];
-        NSKeyedArchiver *archiver = [[[NSKeyedArchiver alloc] initForWritingWithMutableData:data] autorelease];
-        [archiver encodeInt32:BxRemoteObjectRequestTypeInvoke
-                       forKey:@"cmd"];
-        [archiver encodeObject:oid
-                        forKey:@"oid"];
-        [archiver encodeObject:NSStringFromSelector([invocation selector])
-                        forKey:@"selector"];
-        [archiver encodeObject:signatureStr
-                        forKey:@"signature"];
-        for (int i = 2; i < [signature numberOfArguments]; i++) {
-            char argType = [signature getArgumentTypeAtIndex:i][0];
-            NSString *argName = [NSString stringWithFormat:@"arg%d", i - 1];
-            if (argType == '@') {  // object
-                NSObject *x;
-                [invocation getArgument:&x atIndex:i];
-                if ([x conformsToProtocol:@protocol(NSCoding)]) {
-                    [archiver encodeObject:x forKey:argName];
-                }
-            } else if (argType == '*') {  // c string
-                uint8_t x[65336];
-                [invocation getArgument:x atIndex:i];
-                x[65535] = 0;
-                [archiver encodeBytes:x
-                               length:strlen((char *) x)
-                               forKey:argName];
-            } else if (argType == 'd') {  // double
-                double x;
-                [invocation getArgument:&x atIndex:i];
-                [archiver encodeDouble:x forKey:argName];
-            } else if (argType == 'f') {  // float
-                float x;
-                [invocation getArgument:&x atIndex:i];
-                [archiver encodeFloat:x forKey:argName];
-            } else if (argType == 'i' || argType == 's' || argType == 'l' ||
-                       argType == 'c' || argType == 'C' || argType == 'I' ||
-                       argType == 'S' || argType == 'L' || argType == 'B') {  // int
-                int x;
-                [invocation getArgument:&x atIndex:i];
-                [archiver encodeInt32:x forKey:argName];
-            } else if (argType == 'q' || argType == 'Q') {  // long long
-                long long x;
-                [invocation getArgument:&x atIndex:i];
-                [archiver encodeInt64:x forKey:argName];
-            } else {
-                // other type, unsupported
-            }            
+    NSData *data = [self _requestDataForInvocation:invocation
+                                               oid:oid];
+    if (data) {
+        BxRemoteInvocationBatch *batch = [self _openBatch];
+        if (batch) {
+            [batch _addRequest:data
+                    invocation:invocation];
+            return self;
         }
-        
-        [archiver finishEncoding];
-        NSURLRequest *request = [_serverSession _createRequest:data];
-        [_requestResponseContents setObject:[NSNull null]
-                                     forKey:request];
-        NSLock *lock = [[[NSLock alloc] init] autorelease];
-        BxRequestOperation *operation = [BxRequestOperation operationWithRequest:request
-                                                                   serverSession:_serverSession
-                                                                        callback:self
-                                                                           token:lock];
-        [_serverSession _addRequestOperation:operation];
-        [lock lock];
-        [lock unlock];
-        
-        id contents = [_requestResponseContents objectForKey:request];
+        id contents = [self _sendRequestData:data];
         if (contents == nil) {
             return self;
         } else if ([contents isKindOfClass:[NSError class]]) {
             [NSException raise:@"Error invoking remote object"
-                        format:[contents localizedDescription]];
+                        format:@"%@", [contents localizedDescription]];
         } else {
-            NSKeyedUnarchiver *unarchiver = [[[NSKeyedUnarchiver alloc] initForReadingWithData:contents] autorelease];
-            int blank = 0;
-            [invocation setReturnValue:&blank]; // test
-            char returnType = [signature methodReturnType][0];
-            if (returnType == '@') {  // object
-                NSObject *x = [unarchiver decodeObjectForKey:@"result"];
-                if (x) {
-                    [invocation setReturnValue:&x];
-                }
-            } else if (returnType == '*') {  // c string
-                NSUInteger len = 0;
-                uint8_t *x = (uint8_t *) [unarchiver decodeBytesForKey:@"result"
-                                            returnedLength:&len];
-                [invocation setReturnValue:&x];
-            } else if (returnType == 'd') {  // double
-                double x = [unarchiver decodeDoubleForKey:@"result"];
-                [invocation setReturnValue:&x];
-            } else if (returnType == 'f') {  // float
-                float x = [unarchiver decodeFloatForKey:@"result"];
-                [invocation setReturnValue:&x];
-            } else if (returnType == 'i' || returnType == 's' || returnType == 'l' ||
-                       returnType == 'c' || returnType == 'C' || returnType == 'I' ||
-                       returnType == 'S' || returnType == 'L' || returnType == 'B') {  // int
-                int x = [unarchiver decodeInt32ForKey:@"result"];
-                [invocation setReturnValue:&x];  // tbd: test this works for char...
-            } else if (returnType == 'q' || returnType == 'Q') {  // long long
-                long long x = [unarchiver decodeInt64ForKey:@"result"];
-                [invocation setReturnValue:&x];
-            } else {
-                // other type, unsupported
-            }            
+            // the caller reads the return value before its autorelease pool drains
+            id resultOwner = nil;
+            NSError *error = [self _setResultFromData:contents
+                                           invocation:invocation
+                                          resultOwner:&resultOwner];
+            if (error) {
+                [NSException raise:@"Error invoking remote object"
+                            format:@"%@", [error localizedDescription]];
+            }
             return self;
         }
     }
@@ -178,27 +397,19 @@ enum BxRemoteObjectRequestType_enum {
     [archiver encodeObject:className
                     forKey:@"className"];
     [archiver finishEncoding];
-    NSURLRequest *request = [_serverSession _createRequest:data];
-    [_requestResponseContents setObject:[NSNull null]
-                                 forKey:request];
-    NSLock *lock = [[[NSLock alloc] init] autorelease];
-    BxRequestOperation *operation = [BxRequestOperation operationWithRequest:request
-                                                               serverSession:_serverSession
-                                                                    callback:self
-                                                                       token:lock];
-    [_serverSession _addRequestOperation:operation];
-    [lock lock];
-    [lock unlock];
-    
-    id contents = [_requestResponseContents objectForKey:request];
+    id contents = [self _sendRequestData:data];
     if (contents == nil) {
         return self;
     } else if ([contents isKindOfClass:[NSError class]]) {
         [NSException raise:@"Error initializing remote object"
-                    format:[contents localizedDescription]];
+                    format:@"%@", [contents localizedDescription]];
     } else { // contents is data
         NSKeyedUnarchiver *unarchiver = [[[NSKeyedUnarchiver alloc] initForReadingWithData:contents] autorelease];
         NSString *oid = [unarchiver decodeObjectForKey:@"oid"];
+        if (oid == nil) {
+            [NSException raise:@"Error initializing remote object"
+                        format:@"%@", [unarchiver decodeObjectForKey:@"error"]];
+        }
         BxRemoteObject *remoteObject = [[BxRemoteObject alloc] initWithOid:oid
                                                                  className:className
                                                              objectManager:self];
@@ -206,7 +417,7 @@ enum BxRemoteObjectRequestType_enum {
         [_instanceOids setObject:remoteObject
                           forKey:oid];
         [_instanceLock unlock];
-        if (signatures) {
+        if (! signatures) {
             signatures = [unarchiver decodeObjectForKey:@"signatures"];
             [_signatureLock lock];
             [_classSignatures setObject:signatures
@@ -241,7 +452,9 @@ enum BxRemoteObjectRequestType_enum {
                                                                    serverSession:_serverSession
                                                                         callback:self
                                                                            token:nil];
-        [_serverSession _addRequestOperation:operation];        
+        [_serverSession _addRequestOperation:operation
+                                    priority:NSOperationQueuePriorityLow
+                                     ordered:NO];
     }
     return self;
 }
@@ -267,7 +480,9 @@ enum BxRemoteObjectRequestType_enum {
                                                                serverSession:_serverSession
                                                                     callback:self
                                                                        token:nil];
-    [_serverSession _addRequestOperation:operation];        
+    [_serverSession _addRequestOperation:operation
+                                priority:NSOperationQueuePriorityLow
+                                 ordered:NO];
     return self;
 }
 
@@ -276,16 +491,52 @@ enum BxRemoteObjectRequestType_enum {
                                      request:(NSURLRequest *)request
                                     response:(NSHTTPURLResponse *)response
                                        error:(NSError *)error {
-    id result = [_requestResponseContents objectForKey:request];
-    if (result) {
-        if (error) {
-            [_requestResponseContents setObject:error
-                                         forKey:request];
-        } else {
-            [_requestResponseContents setObject:contents
-                                         forKey:request];
-        }
+    if (token == nil) {
+        return;
+    }
+    [_pendingRequestsLock lock];
+    BxCallback *handler = [[[_pendingRequests objectForKey:token] retain] autorelease];
+    [_pendingRequests removeObjectForKey:token];
+    [_pendingRequestsLock unlock];
+    if (error) {
+        [handler invokeWith:error];
+    } else {
+        [handler invokeWith:contents];
+    }
+}
+
+- (BxRemoteInvocationBatch *)beginBatch {
+    BxRemoteInvocationBatch *batch = [self _openBatch];
+    if (batch == nil) {
+        batch = [[[BxRemoteInvocationBatch alloc] _initWithRemoteObjectManager:self] autorelease];
+        [[[NSThread currentThread] threadDictionary] setObject:batch
+                                                        forKey:_batchKey];
+    }
+    return batch;
+}
+
+- (BxRemoteInvocationFuture *)invokeAsync:(NSInvocation *)invocation
+                                  callback:(SEL)selector
+                                    target:(id)target
+                                     queue:(NSOperationQueue *)queue {
+    NSData *data = nil;
+    if ([[invocation target] isKindOfClass:[BxRemoteObject class]]) {
+        data = [self _requestDataForInvocation:invocation
+                                           oid:[[invocation target] _BX_oid]];
+    }
+    if (data == nil) {
+        [NSException raise:@"Error invoking remote object"
+                    format:@"%@ is not a remote object of this manager or has no method %@",
+                           [invocation target], NSStringFromSelector([invocation selector])];
     }
+    BxRemoteInvocationFuture *future = [[[BxRemoteInvocationFuture alloc] _initWithInvocation:invocation] autorelease];
+    [self _sendBatchRequests:[NSArray arrayWithObject:data]
+                     futures:[NSArray arrayWithObject:future]
+                    callback:[BxCallback callbackWithSelector:selector
+                                                       target:target]
+                      result:future
+                       queue:queue];
+    return future;
 }
 
 - (id)createRemoteInstance:(NSString *)className {
@@ -300,7 +551,9 @@ enum BxRemoteObjectRequestType_enum {
     [_instanceOids release];
     [_classSignatures release];
     [_serverSession release];
-    [_requestResponseContents release];
+    [_pendingRequestsLock release];
+    [_pendingRequests release];
+    [_batchKey release];
     [super dealloc];
 }
 
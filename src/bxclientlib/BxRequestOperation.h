@@ -3,7 +3,10 @@
 
 @class BxServerSession;
 
+// the callback is invoked exactly once, with an error if the operation is cancelled before it runs
 @interface BxRequestOperation : NSOperation {
+    BOOL _isStarted;
+    BOOL _hasFinished;
     BxServerSession *_serverSession;
     NSObject *_token;
     NSObject <BxRequestOperationCallback> *_callback;
@@ -4,6 +4,7 @@
 #import "BxServerSession.h"
 #import "BxRequestOperationCallback.h"
 #import "BxArchiveEnvelope.h"
+#import "BxWireFormat.h"
 
 @implementation BxRequestOperation
 
@@ -27,6 +28,8 @@
     } else {
         _token = nil;
     }             
+    _isStarted = NO;
+    _hasFinished = NO;
     return self;
 }
 
@@ -40,15 +43,65 @@
                                                   token:token] autorelease];
 }
 
+// sends the callback and releases a waiting NSConditionLock token, only the first time
+- (void)_finishWithContents:(NSData *)contents
+                   response:(NSHTTPURLResponse *)response
+                      error:(NSError *)error {
+    @synchronized (self) {
+        if (_hasFinished) {
+            return;
+        }
+        _hasFinished = YES;
+    }
+    if (_callback) {
+        [_callback requestOperationCallbackWithContents:contents
+                                                  token:_token
+                                                request:_request
+                                               response:response
+                                                  error:error];
+    }
+    if (_token && [_token isMemberOfClass:[NSConditionLock class]]) {
+        [_token lock];
+        [_token unlockWithCondition:1];
+    }
+}
+
+- (id)_finishCancelled {
+    [self _finishWithContents:nil
+                     response:nil
+                        error:[NSError errorWithDomain:@"BxClientLib"
+                                                  code:104
+                                              userInfo:[NSDictionary dictionaryWithObject:@"The BxClientLib request was cancelled"
+                                                                                   forKey:NSLocalizedDescriptionKey]]];
+    return self;
+}
+
+// an operation cancelled in the queue may never reach main, so it finishes here
+- (void)cancel {
+    BOOL isStarted;
+    @synchronized (self) {
+        [super cancel];
+        isStarted = _isStarted;
+    }
+    if (! isStarted) {
+        [self _finishCancelled];
+    }
+}
+
 - (void)main {
-    if (! [self isCancelled]) {
+    BOOL isCancelled;
+    @synchronized (self) {
+        isCancelled = [self isCancelled];
+        _isStarted = YES;
+    }
+    if (isCancelled) {
+        [self _finishCancelled];
+    } else {
         NSHTTPURLResponse *response = nil;
         NSError *error = nil;
         NSData *data = [NSURLConnection sendSynchronousRequest:_request
                                              returningResponse:&response
                                                          error:&error];
-        NSLog(@"data=%@ datalen=%d error=%@", data, [data length], error); // xxx
-        
         if ([response statusCode] == 409) {
             [_serverSession _invalidateSession];
             error = [NSError errorWithDomain:@"BxClientLib"
@@ -57,32 +110,39 @@
                                                                          forKey:NSLocalizedDescriptionKey]];
         }
         if (! error && [data length] > 0) {
-            BxArchiveEnvelope *envelope = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+            NSDictionary *headers = [response allHeaderFields];
+            [_serverSession _setServerProtocol:[headers objectForKey:@"BxClientLib-Protocol"]];
+            [_serverSession _setServerAcceptCompression:[headers objectForKey:@"BxClientLib-Accept-Compression"]];
+            if ([[headers objectForKey:@"BxClientLib-Compression"] isEqualToString:BX_WIRE_COMPRESSION_DEFLATE]) {
+                data = _BX_wireInflate(data);
+            }
+            BxArchiveEnvelope *envelope;
+            if (data == nil) {
+                envelope = nil;
+                error = [NSError errorWithDomain:@"BxClientLib"
+                                            code:101
+                                        userInfo:[NSDictionary dictionaryWithObject:@"The BxClientLib response could not be decompressed"
+                                                                             forKey:NSLocalizedDescriptionKey]];
+            } else if (_BX_wireHasHeader(data, BX_WIRE_TYPE_ENVELOPE)) {
+                envelope = [BxArchiveEnvelope _envelopeWithWireData:data];
+            } else {
+                envelope = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+            }
             if (envelope.messages) {
                 BxMessageManager *messageManager = [_serverSession messageManager];
                 for (BxMessage *message in envelope.messages) {
                     [messageManager _receiveMessage:message];
                 }
             }
-            if (_callback) {
-                [_callback requestOperationCallbackWithContents:envelope.contents
-                                                          token:_token
-                                                        request:_request
-                                                       response:response
-                                                          error:error];
-            }
-        } else if (_callback) {
-            [_callback requestOperationCallbackWithContents:data
-                                                      token:_token
-                                                    request:_request
-                                                   response:response
-                                                      error:error];
+            [self _finishWithContents:envelope.contents
+                             response:response
+                                error:error];
+        } else {
+            [self _finishWithContents:data
+                             response:response
+                                error:error];
         }
     }
-    if (_token && [_token isMemberOfClass:[NSConditionLock class]]) {
-        [_token lock];
-        [_token unlockWithCondition:1];
-    }
 }
 
 
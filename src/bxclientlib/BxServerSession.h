@@ -2,14 +2,22 @@
 
 @class BxRemoteObjectManager;
 @class BxMessageManager;
+@class BxRequestOperation;
 
 @interface BxServerSession : NSObject {
     BOOL _isClosed;
+    BOOL _isEstablished;
+    BOOL _serverAcceptsCompression;
+    BOOL _serverUsesWireFormat;
     BOOL _sessionValid;
     BOOL _useCompression;
+    NSUInteger _compressionThreshold;
+    NSInteger _maxConcurrentRequests;
     BxMessageManager *_messageManager;
     BxRemoteObjectManager *_remoteObjectManager;
     NSOperationQueue *_requestQueue;
+    NSLock *_orderedRequestLock;
+    BxRequestOperation *_lastOrderedRequest; // message sends go out one after the other
     NSString *_sessionId;
     NSTimeInterval _timeoutInterval;
     NSURL *_url;
@@ -29,7 +37,13 @@
 
 @property (nonatomic, readonly) BOOL isClosed;
 @property (nonatomic, readonly) BOOL sessionValid;
+// deflates request bodies of at least compressionThreshold bytes once the server has said it
+// accepts them and asks for deflated responses; applications must link libz
 @property (nonatomic, assign) BOOL useCompression;
+@property (nonatomic, assign) NSUInteger compressionThreshold;
+// requests in flight at once, defaults to 4; remote invocations are sent ahead of message
+// sends, which keep their order, and ahead of polls
+@property (nonatomic, assign) NSInteger maxConcurrentRequests;
 @property (nonatomic, assign) NSTimeInterval timeoutInterval;
 
 @end
@@ -3,23 +3,32 @@
 #import "BxMessageManager.h"
 #import "BxRemoteObjectManager.h"
 #import "BxArchiveEnvelope.h"
+#import "BxMessage.h"
+#import "BxWireFormat.h"
 
 @implementation BxServerSession
 
 @synthesize sessionValid = _sessionValid;
 @synthesize timeoutInterval = _timeoutInterval;
 @synthesize useCompression = _useCompression;
+@synthesize compressionThreshold = _compressionThreshold;
+@synthesize maxConcurrentRequests = _maxConcurrentRequests;
 @synthesize isClosed = _isClosed;
 
-NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
+NSString *_BX_CLIENTLIB_PROTOCOL = @"2.0";
 
 
 - (NSURLRequest *)_createRequest:(NSData *)data {
     NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:_url
                                                            cachePolicy:NSURLRequestReloadIgnoringLocalAndRemoteCacheData
                                                        timeoutInterval:_timeoutInterval];
-    if (_useCompression) {
-        
+    BOOL isCompressed = NO;
+    if (_useCompression && _serverAcceptsCompression && [data length] >= _compressionThreshold) {
+        NSData *deflated = _BX_wireDeflate(data);
+        if (deflated && [deflated length] < [data length]) {
+            data = deflated;
+            isCompressed = YES;
+        }
     }
     [request setHTTPBody:data];
     [request setHTTPMethod:@"POST"];
@@ -27,25 +36,78 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
     [request setValue:[NSString stringWithFormat:@"%ld", [data length]] forHTTPHeaderField:@"Content-Length"];
     [request setValue:_BX_CLIENTLIB_PROTOCOL forHTTPHeaderField:@"BxClientLib-Protocol"];
     if (_useCompression) {
-        [request setValue:@"LZMA" forHTTPHeaderField:@"BxClientLib-Compression"];
+        [request setValue:BX_WIRE_COMPRESSION_DEFLATE forHTTPHeaderField:@"BxClientLib-Accept-Compression"];
+    }
+    if (isCompressed) {
+        [request setValue:BX_WIRE_COMPRESSION_DEFLATE forHTTPHeaderField:@"BxClientLib-Compression"];
     }
     return request;
 }
 
+// messages go out as keyed archives until the server has answered with protocol 2.0 or later
+- (NSData *)_encodeMessage:(BxMessage *)message {
+    if (_serverUsesWireFormat) {
+        return [message _wireData];
+    } else {
+        return [NSKeyedArchiver archivedDataWithRootObject:message];
+    }
+}
+
+- (id)_setServerProtocol:(NSString *)serverProtocol {
+    _serverUsesWireFormat = [serverProtocol doubleValue] >= 2;
+    if (! _isEstablished) {
+        // the session cookie is set now, so parallel requests no longer each start a session
+        _isEstablished = YES;
+        [_requestQueue setMaxConcurrentOperationCount:_maxConcurrentRequests];
+    }
+    return self;
+}
+
+- (id)_setServerAcceptCompression:(NSString *)serverAcceptCompression {
+    _serverAcceptsCompression = [[serverAcceptCompression componentsSeparatedByString:@","] containsObject:BX_WIRE_COMPRESSION_DEFLATE];
+    return self;
+}
+
 - (id)_invalidateSession {
     _sessionValid = NO;
     return self;
 }
 
-- (id)_addRequestOperation:(BxRequestOperation *)operation {
+// ordered operations wait for the previous ordered operation to finish
+- (id)_addRequestOperation:(BxRequestOperation *)operation
+                  priority:(NSOperationQueuePriority)priority
+                   ordered:(BOOL)isOrdered {
     if (_isClosed) {
         [NSException raise:@"BxServerSession Closed"
                     format:@"This BxServerSession has already been closed. No new operations may be added."];
     }
+    [operation setQueuePriority:priority];
+    if (isOrdered) {
+        [_orderedRequestLock lock];
+        if (_lastOrderedRequest && ! [_lastOrderedRequest isFinished]) {
+            [operation addDependency:_lastOrderedRequest];
+        }
+        [_lastOrderedRequest release];
+        _lastOrderedRequest = [operation retain];
+        [_orderedRequestLock unlock];
+    }
     [_requestQueue addOperation:operation];
     return self;
 }
 
+- (id)_addRequestOperation:(BxRequestOperation *)operation {
+    return [self _addRequestOperation:operation
+                             priority:NSOperationQueuePriorityNormal
+                              ordered:NO];
+}
+
+- (void)setMaxConcurrentRequests:(NSInteger)maxConcurrentRequests {
+    _maxConcurrentRequests = MAX(maxConcurrentRequests, 1);
+    if (_isEstablished) {
+        [_requestQueue setMaxConcurrentOperationCount:_maxConcurrentRequests];
+    }
+}
+
 - (id)_waitForOperationQueue {
     [_requestQueue waitUntilAllOperationsAreFinished];
     return self;
@@ -57,10 +119,17 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
     _remoteObjectManager = nil;
     _messageManager = nil;
     _requestQueue = [[NSOperationQueue alloc] init];
+    _maxConcurrentRequests = 4;
+    _isEstablished = NO;
     [_requestQueue setMaxConcurrentOperationCount:1];
+    _orderedRequestLock = [[NSLock alloc] init];
+    _lastOrderedRequest = nil;
+    _serverAcceptsCompression = NO;
+    _serverUsesWireFormat = NO;
     _sessionValid = YES;
     _timeoutInterval = 60;
     _useCompression = NO;
+    _compressionThreshold = 512;
     _isClosed = NO;
     return self;
 }
@@ -121,6 +190,8 @@ NSString *_BX_CLIENTLIB_PROTOCOL = @"1.0";
     [_url release];
     [_requestQueue cancelAllOperations];
     [_requestQueue release];
+    [_orderedRequestLock release];
+    [_lastOrderedRequest release];
     if (_remoteObjectManager) {
         [_remoteObjectManager release];
     }
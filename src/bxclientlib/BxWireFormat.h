@@ -0,0 +1,58 @@
+/*
+ Compact binary encoding for BxMessage and BxArchiveEnvelope, used instead of NSKeyedArchiver once both ends speak BxClientLib-Protocol 2.0 or later.
+ Every encoded object starts with the bytes "BXW", a format version and a type byte.
+ All integers are big endian; strings are UTF-8 and both strings and data are prefixed
+ with a 32 bit length, where BX_WIRE_NIL stands for nil.
+ 
+ Message: kind, createdDate (64 bit IEEE double), label count followed by key/value
+ pairs, data.  Label keys and values are each a tag byte followed by either a string ('S')
+ or, for any other class, data holding the object archived with NSKeyedArchiver ('A').
+ 
+ Envelope: contents, message count followed by messages without their own header.
+ 
+ */
+
+#import <Foundation/Foundation.h>
+
+#define BX_WIRE_VERSION 2
+#define BX_WIRE_TYPE_MESSAGE 'M'
+#define BX_WIRE_TYPE_ENVELOPE 'E'
+#define BX_WIRE_HEADER_LENGTH 5
+#define BX_WIRE_NIL 0xFFFFFFFF
+#define BX_WIRE_TAG_STRING 'S'
+#define BX_WIRE_TAG_ARCHIVE 'A'
+#define BX_WIRE_COMPRESSION_DEFLATE @"deflate"
+#define BX_WIRE_MAX_INFLATED_LENGTH (64 * 1024 * 1024)
+
+// an NSData pointing into a larger buffer, which it keeps alive, without copying
+@interface BxWireDataSlice : NSData {
+    NSData *_backingData;
+    const void *_bytes;
+    NSUInteger _length;
+}
+
+- (id)initWithData:(NSData *)data
+             range:(NSRange)range;
+
+@end
+
+void _BX_wireAppendHeader(NSMutableData *data, char type);
+void _BX_wireAppendUInt32(NSMutableData *data, uint32_t value);
+void _BX_wireAppendDouble(NSMutableData *data, double value);
+void _BX_wireAppendData(NSMutableData *data, NSData *value);
+void _BX_wireAppendString(NSMutableData *data, NSString *value);
+// a tagged string, or a tagged keyed archive of any other NSCoding object
+void _BX_wireAppendObject(NSMutableData *data, id value);
+
+// the read functions return NO and leave offset alone if the data is too short
+BOOL _BX_wireHasHeader(NSData *data, char type);
+BOOL _BX_wireReadUInt32(NSData *data, NSUInteger *offset, uint32_t *value);
+BOOL _BX_wireReadDouble(NSData *data, NSUInteger *offset, double *value);
+BOOL _BX_wireReadData(NSData *data, NSUInteger *offset, NSData **value);
+BOOL _BX_wireReadString(NSData *data, NSUInteger *offset, NSString **value);
+BOOL _BX_wireReadObject(NSData *data, NSUInteger *offset, id *value);
+
+// a zlib stream prefixed with the 32 bit inflated length, sent as BxClientLib-Compression: deflate
+NSData *_BX_wireDeflate(NSData *data);
+// nil if the data is corrupt or would inflate beyond BX_WIRE_MAX_INFLATED_LENGTH
+NSData *_BX_wireInflate(NSData *data);
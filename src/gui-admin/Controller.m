@@ -5,6 +5,7 @@
 static Controller *_singleton = nil;
 static NSString *_defaultLogPath = nil;
 static NSCharacterSet *_quoteCharacterSet = nil;
+static NSCharacterSet *_slashCharacterSet = nil;
 
 @implementation Controller
 
@@ -35,6 +36,9 @@ static NSCharacterSet *_quoteCharacterSet = nil;
     if (_quoteCharacterSet == nil) {
         _quoteCharacterSet = [[NSCharacterSet characterSetWithCharactersInString:@"\"'"] retain];
     }
+    if (_slashCharacterSet == nil) {
+        _slashCharacterSet = [[NSCharacterSet characterSetWithCharactersInString:@"/"] retain];
+    }
     
     // tbd set Urls
     _defaultStaticPath = [NSHomeDirectory() retain];
@@ -431,6 +435,9 @@ static NSCharacterSet *_quoteCharacterSet = nil;
     int keepAliveTimeout = 5;
     NSString *charset = @"utf-8";
     NSString *defaultIndex = @"index.html index.htm";
+    NSString *staticFileCache = @"max=1000 inactive=60s";
+    NSString *staticFileCacheValid = @"30s";
+    NSString *staticExpires = @"7d";
     NSString *debugSocket = [NSTemporaryDirectory() stringByAppendingPathComponent:@"bombax-debug.sock"];
     
     [conf appendFormat:@"user %@ %@;\n", runningUser, runningGroup];
@@ -586,6 +593,9 @@ static NSCharacterSet *_quoteCharacterSet = nil;
             [conf appendString:@"  }\n"];
             if (location.locationType == BX_LOCATION_BXAPP &&
                 location.patternStyle == BX_PATTERN_START) {
+                // serve the BxApp's static resources directly so they never reach the BxApp
+                // itself; this mirrors the web path built by BxApp's staticWebPath: and the
+                // resource path resolved by BxStaticFileHandler
                 NSString *infoPath = [location.path stringByAppendingPathComponent:@"Contents/Info.plist"];
                 NSDictionary *info;
                 if ([[NSFileManager defaultManager] fileExistsAtPath:infoPath] &&
@@ -594,13 +604,30 @@ static NSCharacterSet *_quoteCharacterSet = nil;
                     if (webPath == nil) {
                         webPath = @"static";
                     }
-                    [conf appendFormat:@"  location \"/%@/%@/\" {\n", location.pattern, webPath];
+                    webPath = [webPath stringByTrimmingCharactersInSet:_slashCharacterSet];
+                    NSString *root = [location.pattern stringByTrimmingCharactersInSet:_slashCharacterSet];
                     NSString *resourcePath = [info objectForKey:@"BxApp Static Resource Path"];
                     if (resourcePath == nil) {
                         resourcePath = @"static";
                     }
-                    [conf appendFormat:@"   alias \"%@/Contents/Resources/%@/\";\n", location.path, resourcePath];
-                    [conf appendString:@"  }\n"]; // server
+                    if (! [resourcePath hasPrefix:@"/"]) {
+                        resourcePath = [NSString stringWithFormat:@"%@/Contents/Resources/%@", location.path, resourcePath];
+                    }
+                    resourcePath = [resourcePath stringByTrimmingCharactersInSet:_slashCharacterSet];
+                    // an empty web path would shadow the whole BxApp location
+                    if ([webPath length] > 0) {
+                        if ([root length] > 0) {
+                            [conf appendFormat:@"  location ^~ \"/%@/%@/\" {\n", root, webPath];
+                        } else {
+                            [conf appendFormat:@"  location ^~ \"/%@/\" {\n", webPath];
+                        }
+                        [conf appendFormat:@"   alias \"/%@/\";\n", resourcePath];
+                        [conf appendFormat:@"   open_file_cache %@;\n", staticFileCache];
+                        [conf appendFormat:@"   open_file_cache_valid %@;\n", staticFileCacheValid];
+                        [conf appendString:@"   open_file_cache_errors on;\n"];
+                        [conf appendFormat:@"   expires %@;\n", staticExpires];
+                        [conf appendString:@"  }\n"];
+                    }
                 }
             }
         }